@@ -0,0 +1,131 @@
+#include "assets.h"
+#include "filemap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "The asset directory and data are mapped as-is and assume a little-endian host"
+#endif
+
+static_assert(sizeof(AssetEntry) == 64, "Asset entries are 64 bytes on disk");
+
+static size_t align_up(size_t value) { // Next multiple of ASSET_ALIGN.
+    return (value + ASSET_ALIGN - 1) & ~(size_t)(ASSET_ALIGN - 1);
+}
+
+bool asset_open(AssetArchive* archive, const char* fileName) { // Maps the file and points the directory straight into it.
+    memset(archive, 0, sizeof(*archive));
+
+    void* view = NULL;
+    size_t size = 0;
+    if (!file_map(fileName, &view, &size)) return false;
+
+    const uint8_t* bytes = (const uint8_t*)view;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    bool ok = size >= ASSET_FILE_HEADER_SIZE && memcmp(bytes, ASSET_FILE_MAGIC, 4) == 0;
+    if (ok) {
+        memcpy(&version, bytes + 4, sizeof(version));
+        memcpy(&count, bytes + 8, sizeof(count));
+        ok = version == ASSET_FILE_VERSION && count <= (size - ASSET_FILE_HEADER_SIZE) / sizeof(AssetEntry);
+    }
+
+    const AssetEntry* entries = (const AssetEntry*)(bytes + ASSET_FILE_HEADER_SIZE);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const AssetEntry* entry = &entries[i];
+        ok = entry->name[ASSET_NAME_LENGTH - 1] == '\0' && entry->offset <= size && entry->size <= size - entry->offset;
+    }
+
+    if (!ok) {
+        file_unmap(view, size);
+        return false;
+    }
+    archive->view = view;
+    archive->size = size;
+    archive->entries = entries;
+    archive->entryCount = (int)count;
+    return true;
+}
+
+void asset_close(AssetArchive* archive) { // Unmaps the file; nothing may still point into it.
+    if (archive->view) file_unmap(archive->view, archive->size);
+    memset(archive, 0, sizeof(*archive));
+}
+
+const AssetEntry* asset_find(const AssetArchive* archive, const char* name, AssetType type) { // Linear scan; archives hold a handful of entries.
+    for (int i = 0; i < archive->entryCount; i++) {
+        const AssetEntry* entry = &archive->entries[i];
+        if (entry->type == (uint32_t)type && strncmp(entry->name, name, ASSET_NAME_LENGTH) == 0) return entry;
+    }
+    return NULL;
+}
+
+void asset_writer_init(AssetWriter* writer) { // Starts an empty archive.
+    memset(writer, 0, sizeof(*writer));
+}
+
+void asset_writer_free(AssetWriter* writer) { // Releases the collected entries and data.
+    free(writer->entries);
+    free(writer->data);
+    memset(writer, 0, sizeof(*writer));
+}
+
+bool asset_writer_add(AssetWriter* writer, const char* name, AssetType type, const uint32_t* info, const void* data, size_t size) { // Appends an entry, its data aligned in the data block.
+    if (strlen(name) >= ASSET_NAME_LENGTH) return false;
+
+    if (writer->entryCount == writer->entryCapacity) {
+        int capacity = writer->entryCapacity ? writer->entryCapacity * 2 : 16;
+        AssetEntry* entries = (AssetEntry*)realloc(writer->entries, (size_t)capacity * sizeof(AssetEntry));
+        if (!entries) return false;
+        writer->entries = entries;
+        writer->entryCapacity = capacity;
+    }
+
+    size_t offset = align_up(writer->dataSize);
+    if (offset + size > writer->dataCapacity || !writer->data) {
+        size_t capacity = writer->dataCapacity ? writer->dataCapacity : (size_t)1 << 16;
+        while (capacity < offset + size) capacity *= 2;
+        uint8_t* grown = (uint8_t*)realloc(writer->data, capacity);
+        if (!grown) return false;
+        writer->data = grown;
+        writer->dataCapacity = capacity;
+    }
+    memset(writer->data + writer->dataSize, 0, offset - writer->dataSize);
+    if (size) memcpy(writer->data + offset, data, size);
+    writer->dataSize = offset + size;
+
+    AssetEntry* entry = &writer->entries[writer->entryCount++];
+    memset(entry, 0, sizeof(*entry));
+    strcpy(entry->name, name);
+    entry->type = (uint32_t)type;
+    if (info) memcpy(entry->info, info, sizeof(entry->info));
+    entry->offset = offset;
+    entry->size = size;
+    return true;
+}
+
+bool asset_writer_save(const AssetWriter* writer, const char* fileName) { // Header, directory with absolute offsets, then the data block.
+    FILE* file = fopen(fileName, "wb");
+    if (!file) return false;
+
+    uint8_t header[ASSET_FILE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, ASSET_FILE_MAGIC, 4);
+    uint32_t version = ASSET_FILE_VERSION;
+    uint32_t count = (uint32_t)writer->entryCount;
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, &count, sizeof(count));
+
+    // Header and entries are both multiples of ASSET_ALIGN, so the data block keeps its alignment.
+    size_t dataStart = ASSET_FILE_HEADER_SIZE + (size_t)writer->entryCount * sizeof(AssetEntry);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int i = 0; ok && i < writer->entryCount; i++) {
+        AssetEntry entry = writer->entries[i];
+        entry.offset += dataStart;
+        ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+    ok = ok && fwrite(writer->data, 1, writer->dataSize, file) == writer->dataSize;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
@@ -0,0 +1,78 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Packed assets.
+// Everything the game loads at startup lives in one archive, built from resources/ by the packer
+// (`make assets`). The sprites are stored as the finished atlas in raw RGBA8 and every sound, the music
+// included, as decoded PCM, so startup maps one file and hands raylib pointers into it: nothing is read,
+// decoded or converted on the way, and the texture upload and the voices' audio buffers are the only copies.
+// Pages of the archive come in as they're touched; the music's are only touched as it streams.
+// Without an archive the game loads the loose files under resources/ as before. Both are looked for next to
+// the executable, not in the working directory.
+//
+// .pma layout (little-endian): "PMAA", u32 version, u32 entry count, zero padding to 64 bytes, then the
+// entries (AssetEntry, 64 bytes each, as they sit in memory), then each entry's data at a 64-byte aligned
+// offset from the start of the file.
+
+#define ASSET_FILE_MAGIC "PMAA"
+#define ASSET_FILE_VERSION 1
+#define ASSET_FILE_HEADER_SIZE 64
+#define ASSET_ALIGN 64
+#define ASSET_NAME_LENGTH 24
+#define ASSET_ARCHIVE_NAME "pacman.pma"
+#define ASSET_RESOURCE_DIR "resources/"
+
+typedef enum {
+    ASSET_TEXTURE = 1, // info: width, height; data: RGBA8 rows, top row first
+    ASSET_REGION,      // info: x, y, width, height of a sprite in the atlas; no data
+    ASSET_WAVE,        // info: frame count, sample rate, sample size in bits, channels; data: interleaved PCM
+    ASSET_STREAM       // A whole file to stream from memory, named with its extension; info unused
+} AssetType;
+
+typedef struct AssetEntry {
+    char name[ASSET_NAME_LENGTH]; // NUL-padded
+    uint32_t type;                // AssetType
+    uint32_t info[4];
+    uint32_t reserved;
+    uint64_t offset;              // Data position in the file
+    uint64_t size;                // Data bytes
+} AssetEntry;
+
+typedef struct AssetArchive {
+    void* view;                   // The mapped file; entries and data point into it
+    size_t size;
+    const AssetEntry* entries;
+    int entryCount;
+} AssetArchive;
+
+// Maps an archive and checks that every entry lies inside it. False when it's missing or damaged.
+bool asset_open(AssetArchive* archive, const char* fileName);
+void asset_close(AssetArchive* archive);
+// The entry with this name and type, or NULL.
+const AssetEntry* asset_find(const AssetArchive* archive, const char* name, AssetType type);
+
+inline const void* asset_data(const AssetArchive* archive, const AssetEntry* entry) { // An entry's bytes inside the mapping.
+    return (const uint8_t*)archive->view + entry->offset;
+}
+
+// Packer side: entries are collected in memory and written in one go.
+typedef struct AssetWriter {
+    AssetEntry* entries;          // Offsets are relative to the data block until asset_writer_save
+    int entryCount;
+    int entryCapacity;
+    uint8_t* data;
+    size_t dataSize;
+    size_t dataCapacity;
+} AssetWriter;
+
+void asset_writer_init(AssetWriter* writer);
+void asset_writer_free(AssetWriter* writer);
+// Copies data in; info may be NULL. False when out of memory or the name is too long.
+bool asset_writer_add(AssetWriter* writer, const char* name, AssetType type, const uint32_t* info, const void* data, size_t size);
+bool asset_writer_save(const AssetWriter* writer, const char* fileName);
+
+#endif
@@ -0,0 +1,227 @@
+#include "audio.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SoundFile {
+    const char* fileName;
+    int voices;
+} SoundFile;
+
+// Under the resource directory; archived sounds take the file names.
+static const SoundFile soundFiles[GAME_SOUND_COUNT] = {
+    { "audio/start.mp3", 1 },
+    { "audio/death.mp3", 1 },
+    { "audio/eat.wav", AUDIO_MAX_VOICES }
+};
+
+static const char* MUSIC_FILE = "audio/music.mp3";
+static const char* MUSIC_ASSET = "music.wav"; // Decoded to 16-bit PCM; the extension tells raylib how to stream it
+
+static bool push_command(AudioSystem* audio, AudioCommand command) { // Producer side of the ring.
+    uint32_t head = audio->head.load(std::memory_order_relaxed);
+    if (head - audio->tail.load(std::memory_order_acquire) >= AUDIO_QUEUE_SIZE) {
+        audio->dropped++;
+        return false;
+    }
+    audio->commands[head & (AUDIO_QUEUE_SIZE - 1)] = command;
+    audio->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+static const Sound* start_voice(SoundVoices* sound) { // Plays on the first idle voice, or steals the next one in turn.
+    int pick = sound->next;
+    for (int i = 0; i < sound->count; i++) {
+        int v = (sound->next + i) % sound->count;
+        if (!IsSoundPlaying(sound->voices[v])) {
+            pick = v;
+            break;
+        }
+    }
+    sound->next = (pick + 1) % sound->count;
+    PlaySound(sound->voices[pick]);
+    return &sound->voices[pick];
+}
+
+static void run_command(AudioSystem* audio, const AudioCommand* command) { // Applies one command on the audio thread.
+    switch (command->type) {
+        case AUDIO_COMMAND_PLAY:
+            start_voice(&audio->sounds[command->sound]);
+            break;
+        case AUDIO_COMMAND_PLAY_OVER_MUSIC:
+            PauseMusicStream(audio->music);
+            audio->musicHeldBy = start_voice(&audio->sounds[command->sound]);
+            break;
+        case AUDIO_COMMAND_SOUND_VOLUME:
+            for (int s = 0; s < GAME_SOUND_COUNT; s++) {
+                for (int v = 0; v < audio->sounds[s].count; v++) SetSoundVolume(audio->sounds[s].voices[v], command->value);
+            }
+            break;
+        case AUDIO_COMMAND_MUSIC_VOLUME:
+            SetMusicVolume(audio->music, command->value);
+            break;
+    }
+}
+
+static void audio_thread(AudioSystem* audio) { // Drains commands and feeds the music stream until told to quit.
+    while (!audio->quit.load(std::memory_order_acquire)) {
+        uint32_t tail = audio->tail.load(std::memory_order_relaxed);
+        uint32_t head = audio->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            run_command(audio, &audio->commands[tail & (AUDIO_QUEUE_SIZE - 1)]);
+        }
+        audio->tail.store(tail, std::memory_order_release);
+
+        UpdateMusicStream(audio->music);
+        if (audio->musicHeldBy && !IsSoundPlaying(*audio->musicHeldBy)) {
+            PlayMusicStream(audio->music);
+            audio->musicHeldBy = NULL;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_THREAD_PERIOD_MS));
+    }
+}
+
+static size_t wave_bytes(const Wave* wave) { // Size of a wave's interleaved samples.
+    return (size_t)wave->frameCount * wave->channels * (wave->sampleSize / 8);
+}
+
+static bool find_packed_wave(const AssetArchive* archive, const char* name, Wave* wave) { // Points a wave at archived PCM.
+    const AssetEntry* entry = asset_find(archive, name, ASSET_WAVE);
+    if (!entry) return false;
+    wave->frameCount = entry->info[0];
+    wave->sampleRate = entry->info[1];
+    wave->sampleSize = entry->info[2];
+    wave->channels = entry->info[3];
+    wave->data = (void*)asset_data(archive, entry);
+    return wave_bytes(wave) == entry->size;
+}
+
+bool StartAudioSystem(AudioSystem* audio, const AssetArchive* archive, const char* directory) { // Gets each sound's PCM once, copies it into its voices, then hands over to the thread.
+    audio->head.store(0);
+    audio->tail.store(0);
+    audio->quit.store(false);
+    audio->dropped = 0;
+    audio->sentSoundVolume = 1.0f;
+    audio->sentMusicVolume = 1.0f;
+    audio->musicHeldBy = NULL;
+
+    bool ok = true;
+    for (int s = 0; s < GAME_SOUND_COUNT; s++) {
+        SoundVoices* sound = &audio->sounds[s];
+        sound->count = 0;
+        sound->next = 0;
+
+        // Archived PCM is used where it lies; only loose files are decoded here.
+        Wave wave = { 0 };
+        bool packed = archive && find_packed_wave(archive, GetFileName(soundFiles[s].fileName), &wave);
+        if (!packed) wave = LoadWave(TextFormat("%s%s", directory, soundFiles[s].fileName));
+        if (wave.data == NULL) ok = false;
+        for (int v = 0; v < soundFiles[s].voices; v++) {
+            sound->voices[sound->count++] = LoadSoundFromWave(wave);
+        }
+        if (!packed) UnloadWave(wave);
+    }
+
+    const AssetEntry* music = archive ? asset_find(archive, MUSIC_ASSET, ASSET_STREAM) : NULL;
+    if (music) {
+        audio->music = LoadMusicStreamFromMemory(GetFileExtension(MUSIC_ASSET), (const unsigned char*)asset_data(archive, music), (int)music->size);
+    } else {
+        audio->music = LoadMusicStream(TextFormat("%s%s", directory, MUSIC_FILE));
+    }
+    if (audio->music.stream.buffer == NULL) ok = false;
+    PlayMusicStream(audio->music);
+
+    audio->thread = std::thread(audio_thread, audio);
+    return ok;
+}
+
+void StopAudioSystem(AudioSystem* audio) { // Joins the thread; afterwards everything is touched from this thread again.
+    audio->quit.store(true, std::memory_order_release);
+    if (audio->thread.joinable()) audio->thread.join();
+
+    for (int s = 0; s < GAME_SOUND_COUNT; s++) {
+        for (int v = 0; v < audio->sounds[s].count; v++) UnloadSound(audio->sounds[s].voices[v]);
+        audio->sounds[s].count = 0;
+    }
+    UnloadMusicStream(audio->music);
+}
+
+void PlayGameSound(AudioSystem* audio, GameSound sound) { // Queues a one-shot sound.
+    push_command(audio, (AudioCommand){ AUDIO_COMMAND_PLAY, sound, 0.0f });
+}
+
+void PlayGameSoundOverMusic(AudioSystem* audio, GameSound sound) { // Queues a jingle that holds the music until it ends.
+    push_command(audio, (AudioCommand){ AUDIO_COMMAND_PLAY_OVER_MUSIC, sound, 0.0f });
+}
+
+void PlayEventSounds(void* context, const SimEvent* events, int count) { // Queues at most one command per sound for the batch.
+    AudioSystem* audio = (AudioSystem*)context;
+    bool ate = false;
+    bool died = false;
+    for (int i = 0; i < count; i++) {
+        if (events[i].type == SIM_EVENT_TYPE_PELLET_EATEN) ate = true;
+        if (events[i].type == SIM_EVENT_TYPE_PACMAN_DIED) died = true;
+    }
+    if (ate) PlayGameSound(audio, GAME_SOUND_EAT);
+    if (died) PlayGameSoundOverMusic(audio, GAME_SOUND_DEATH);
+}
+
+void SetAudioVolumes(AudioSystem* audio, float soundVolume, float musicVolume) { // Queues volume changes, skipping values already sent.
+    if (soundVolume != audio->sentSoundVolume && push_command(audio, (AudioCommand){ AUDIO_COMMAND_SOUND_VOLUME, GAME_SOUND_COUNT, soundVolume })) {
+        audio->sentSoundVolume = soundVolume;
+    }
+    if (musicVolume != audio->sentMusicVolume && push_command(audio, (AudioCommand){ AUDIO_COMMAND_MUSIC_VOLUME, GAME_SOUND_COUNT, musicVolume })) {
+        audio->sentMusicVolume = musicVolume;
+    }
+}
+
+static void put_u32(uint8_t* out, uint32_t value) { // Little-endian store.
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static bool pack_music(AssetWriter* writer, const char* directory) { // Decodes the whole track once and stores it as a 16-bit PCM .wav.
+    Wave wave = LoadWave(TextFormat("%s%s", directory, MUSIC_FILE));
+    if (wave.data == NULL) return false;
+    WaveFormat(&wave, (int)wave.sampleRate, 16, (int)wave.channels);
+
+    const uint32_t headerSize = 44;
+    uint32_t dataSize = (uint32_t)wave_bytes(&wave);
+    uint8_t* file = (uint8_t*)malloc(headerSize + dataSize);
+    if (!file) {
+        UnloadWave(wave);
+        return false;
+    }
+    uint32_t blockAlign = wave.channels * 2;
+    memcpy(file, "RIFF", 4);
+    put_u32(file + 4, headerSize - 8 + dataSize);
+    memcpy(file + 8, "WAVEfmt ", 8);
+    put_u32(file + 16, 16);
+    put_u32(file + 20, 1 | (wave.channels << 16));          // PCM, channels
+    put_u32(file + 24, wave.sampleRate);
+    put_u32(file + 28, wave.sampleRate * blockAlign);
+    put_u32(file + 32, blockAlign | (16u << 16));            // Block align, bits per sample
+    memcpy(file + 36, "data", 4);
+    put_u32(file + 40, dataSize);
+    memcpy(file + headerSize, wave.data, dataSize);
+
+    bool ok = asset_writer_add(writer, MUSIC_ASSET, ASSET_STREAM, NULL, file, headerSize + dataSize);
+    free(file);
+    UnloadWave(wave);
+    return ok;
+}
+
+bool PackAudioAssets(AssetWriter* writer, const char* directory) { // Decodes every sound and the music into the archive.
+    bool ok = true;
+    for (int s = 0; ok && s < GAME_SOUND_COUNT; s++) {
+        Wave wave = LoadWave(TextFormat("%s%s", directory, soundFiles[s].fileName));
+        if (wave.data == NULL) return false;
+        uint32_t format[4] = { wave.frameCount, wave.sampleRate, wave.sampleSize, wave.channels };
+        ok = asset_writer_add(writer, GetFileName(soundFiles[s].fileName), ASSET_WAVE, format, wave.data, wave_bytes(&wave));
+        UnloadWave(wave);
+    }
+    return ok && pack_music(writer, directory);
+}
@@ -0,0 +1,81 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "raylib.h"
+#include "events.h"
+#include "assets.h"
+#include <atomic>
+#include <thread>
+#include <stdint.h>
+
+// Audio runs on its own thread so music decoding never lands in a frame.
+// The game thread only pushes small commands into a single-producer/single-consumer ring; the audio thread
+// drains it, keeps the music stream fed and owns every raylib audio call after startup.
+// Each sound has a few voices loaded from one decoded wave, so rapid pellet eats overlap instead of
+// restarting a single voice; when every voice is busy the one started longest ago is reused.
+
+#define AUDIO_QUEUE_SIZE 64        // Commands in flight; must be a power of two
+#define AUDIO_MAX_VOICES 4
+#define AUDIO_THREAD_PERIOD_MS 4   // Audio thread wake-up interval; the music buffer holds far more than this
+
+typedef enum {
+    GAME_SOUND_START,
+    GAME_SOUND_DEATH,
+    GAME_SOUND_EAT,
+    GAME_SOUND_COUNT
+} GameSound;
+
+typedef enum {
+    AUDIO_COMMAND_PLAY,            // Play a sound on a free voice
+    AUDIO_COMMAND_PLAY_OVER_MUSIC, // Pause the music, play a sound, resume the music once it ends
+    AUDIO_COMMAND_SOUND_VOLUME,
+    AUDIO_COMMAND_MUSIC_VOLUME
+} AudioCommandType;
+
+typedef struct AudioCommand {
+    AudioCommandType type;
+    GameSound sound;
+    float value;
+} AudioCommand;
+
+typedef struct SoundVoices {
+    Sound voices[AUDIO_MAX_VOICES];
+    int count;
+    int next;                  // Round-robin start for the free-voice search
+} SoundVoices;
+
+typedef struct AudioSystem {
+    alignas(64) std::atomic<uint32_t> head; // Written by the game thread only
+    alignas(64) std::atomic<uint32_t> tail; // Written by the audio thread only
+    alignas(64) AudioCommand commands[AUDIO_QUEUE_SIZE];
+    std::atomic<bool> quit;
+    uint32_t dropped;          // Commands the game thread found no room for
+    float sentSoundVolume;     // Last volumes queued, so unchanged settings send nothing
+    float sentMusicVolume;
+
+    // Owned by the audio thread while it runs.
+    SoundVoices sounds[GAME_SOUND_COUNT];
+    Music music;
+    const Sound* musicHeldBy;  // Voice the music is paused for, NULL when the music plays
+    std::thread thread;
+} AudioSystem;
+
+// Loads every sound and the music on the calling thread, starts the music and the audio thread. Sounds and
+// music come from the archive when it has them (archive may be NULL), otherwise from the files under
+// directory. The music streams straight out of the archive, so it must stay open until StopAudioSystem.
+bool StartAudioSystem(AudioSystem* audio, const AssetArchive* archive, const char* directory);
+// Stops the thread and unloads everything; call before CloseAudioDevice.
+void StopAudioSystem(AudioSystem* audio);
+
+// Game-thread side. Never blocks: a full queue drops the command.
+void PlayGameSound(AudioSystem* audio, GameSound sound);
+void PlayGameSoundOverMusic(AudioSystem* audio, GameSound sound);
+void SetAudioVolumes(AudioSystem* audio, float soundVolume, float musicVolume);
+// EventConsumer for a frame's gameplay events (context is the AudioSystem): one eat sound however many
+// pellets went, and the death jingle over the music.
+void PlayEventSounds(void* context, const SimEvent* events, int count);
+
+// Packer side: decodes every sound and the music under directory into the archive.
+bool PackAudioAssets(AssetWriter* writer, const char* directory);
+
+#endif
@@ -0,0 +1,176 @@
+#include "batch.h"
+#include "bot.h"
+#include <limits.h>
+#include <string.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Games are handed out in chunks; each worker drains its own deque from the back
+// and, once empty, steals chunks from the front of other workers' deques.
+const int BATCH_CHUNK_GAMES = 16;
+
+typedef struct BatchTask {
+    Difficulty difficulty;
+    int firstGame;
+    int count;
+} BatchTask;
+
+struct alignas(64) WorkerQueue {
+    std::mutex lock;
+    std::deque<BatchTask> tasks;
+};
+
+struct alignas(64) WorkerResult {
+    BatchStats stats[DIFFICULTY_COUNT];
+};
+
+static uint32_t game_seed(uint32_t baseSeed, Difficulty difficulty, int gameIndex) { // Mixes the batch seed with the game's identity so results do not depend on scheduling.
+    uint64_t x = ((uint64_t)baseSeed << 32) ^ ((uint64_t)difficulty << 24) ^ (uint64_t)gameIndex;
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return (uint32_t)x;
+}
+
+static void reset_stats(BatchStats* stats) { // Clears a stats block, priming min/max for the first game.
+    memset(stats, 0, sizeof(*stats));
+    stats->scoreMin = INT_MAX;
+    stats->scoreMax = INT_MIN;
+}
+
+static void record_game(BatchStats* stats, const SimState* state) { // Folds one finished game into a stats block.
+    stats->games++;
+    if (state->status == SIM_WON) stats->wins++;
+    else if (state->status == SIM_DEAD) stats->deaths++;
+    else stats->timeouts++;
+    stats->scoreSum += state->score;
+    if (state->score < stats->scoreMin) stats->scoreMin = state->score;
+    if (state->score > stats->scoreMax) stats->scoreMax = state->score;
+    stats->survivalTicksSum += state->tick;
+    stats->pelletsLeftSum += sim_pellets_left(state);
+    stats->levelsClearedSum += state->level - 1 + (state->status == SIM_WON ? 1 : 0);
+}
+
+static void merge_stats(BatchStats* into, const BatchStats* from) { // Adds one worker's totals into the final stats.
+    into->games += from->games;
+    into->wins += from->wins;
+    into->deaths += from->deaths;
+    into->timeouts += from->timeouts;
+    into->scoreSum += from->scoreSum;
+    if (from->scoreMin < into->scoreMin) into->scoreMin = from->scoreMin;
+    if (from->scoreMax > into->scoreMax) into->scoreMax = from->scoreMax;
+    into->survivalTicksSum += from->survivalTicksSum;
+    into->pelletsLeftSum += from->pelletsLeftSum;
+    into->levelsClearedSum += from->levelsClearedSum;
+}
+
+static void run_task(const BatchTask* task, const BatchConfig* config, NavCache* nav, WorkerResult* result) { // Plays every game of a chunk to completion.
+    SimState state;
+    BotState bot;
+
+    for (int i = 0; i < task->count; i++) {
+        uint32_t seed = game_seed(config->seed, task->difficulty, task->firstGame + i);
+        if (!sim_init(&state, config->map, task->difficulty, seed, nav)) continue;
+        bot_init(&bot, seed ^ 0x5BD1E995u);
+
+        for (;;) {
+            while (state.status == SIM_PLAYING && state.tick < config->maxTicks) {
+                sim_step_ticks(&state, bot_random_walk(&bot, &state), config->stepTicks);
+            }
+            if (!config->levels || state.status != SIM_WON || state.tick >= config->maxTicks || !sim_next_level(&state)) break;
+        }
+
+        record_game(&result->stats[task->difficulty], &state);
+        // Every game owns its slot, so workers write scores without locking and the order never depends on scheduling.
+        if (config->scores) config->scores[(size_t)task->difficulty * config->gamesPerDifficulty + task->firstGame + i] = state.score;
+        sim_free(&state);
+    }
+}
+
+static bool pop_own_task(WorkerQueue* queue, BatchTask* task) { // Takes the most recently queued chunk from the worker's own deque.
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if (queue->tasks.empty()) return false;
+    *task = queue->tasks.back();
+    queue->tasks.pop_back();
+    return true;
+}
+
+static bool steal_task(WorkerQueue* queue, BatchTask* task) { // Takes the oldest chunk from another worker's deque.
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if (queue->tasks.empty()) return false;
+    *task = queue->tasks.front();
+    queue->tasks.pop_front();
+    return true;
+}
+
+static void worker_main(int workerId, int workerCount, WorkerQueue* queues, WorkerResult* result, const BatchConfig* config) { // Runs tasks until every deque is empty.
+    BatchTask task;
+
+    // Each worker owns its distance cache, so lazily built fields never need locking.
+    NavCache nav;
+    NavCache* workerNav = sim_init_nav(&nav, config->map) ? &nav : NULL;
+
+    for (;;) {
+        if (pop_own_task(&queues[workerId], &task)) {
+            run_task(&task, config, workerNav, result);
+            continue;
+        }
+
+        // No tasks are created after start-up, so one empty sweep over all victims means the batch is done.
+        bool stole = false;
+        for (int offset = 1; offset < workerCount && !stole; offset++) {
+            stole = steal_task(&queues[(workerId + offset) % workerCount], &task);
+        }
+        if (!stole) break;
+
+        run_task(&task, config, workerNav, result);
+    }
+
+    nav_free(&nav);
+}
+
+void batch_run(const BatchConfig* config, BatchStats stats[DIFFICULTY_COUNT]) { // Plays config->gamesPerDifficulty games per Difficulty across a work-stealing pool.
+    int workerCount = config->threads;
+    if (workerCount <= 0) workerCount = (int)std::thread::hardware_concurrency();
+    if (workerCount <= 0) workerCount = 1;
+
+    std::vector<WorkerQueue> queues(workerCount);
+    std::vector<WorkerResult> results(workerCount);
+
+    int nextWorker = 0;
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        for (int first = 0; first < config->gamesPerDifficulty; first += BATCH_CHUNK_GAMES) {
+            BatchTask task;
+            task.difficulty = (Difficulty)d;
+            task.firstGame = first;
+            task.count = config->gamesPerDifficulty - first < BATCH_CHUNK_GAMES ? config->gamesPerDifficulty - first : BATCH_CHUNK_GAMES;
+            queues[nextWorker].tasks.push_back(task);
+            nextWorker = (nextWorker + 1) % workerCount;
+        }
+    }
+
+    for (int w = 0; w < workerCount; w++) {
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            reset_stats(&results[w].stats[d]);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (int w = 1; w < workerCount; w++) {
+        workers.emplace_back(worker_main, w, workerCount, queues.data(), &results[w], config);
+    }
+    worker_main(0, workerCount, queues.data(), &results[0], config);
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        reset_stats(&stats[d]);
+        for (int w = 0; w < workerCount; w++) {
+            merge_stats(&stats[d], &results[w].stats[d]);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "sim.h"
+
+// Runs many independent games across all cores and aggregates the results per Difficulty.
+// Every game owns its SimState and bot, so workers share nothing mutable except the task queues.
+
+typedef struct BatchConfig {
+    int gamesPerDifficulty;
+    int threads;          // 0 picks one worker per hardware thread
+    uint32_t seed;        // Game i of a difficulty always gets the same seed, whatever the thread count
+    uint32_t maxTicks;    // Games still running after this many ticks are counted as timeouts
+    const MazeMap* map;   // Maze every game starts on
+    bool levels;          // Won games carry on through generated levels instead of ending
+    int stepTicks;        // Ticks per sim step; 1 plays at the game's own rate
+    int* scores;          // Optional: game i of difficulty d leaves its final score in scores[d * gamesPerDifficulty + i]
+} BatchConfig;
+
+typedef struct BatchStats {
+    long long games;
+    long long wins;
+    long long deaths;
+    long long timeouts;
+    long long scoreSum;
+    int scoreMin;
+    int scoreMax;
+    long long survivalTicksSum;
+    long long pelletsLeftSum;
+    long long levelsClearedSum;
+} BatchStats;
+
+void batch_run(const BatchConfig* config, BatchStats stats[DIFFICULTY_COUNT]);
+
+#endif
@@ -0,0 +1,208 @@
+#include "bot.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t bot_rand(BotState* bot) { // Bot-side xorshift32, kept apart from the game's own generator.
+    uint32_t x = bot->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bot->rng = x;
+    return x;
+}
+
+void bot_init(BotState* bot, uint32_t seed) { // Seeds a bot; every seed (including 0) gives a valid generator.
+    bot->rng = seed * 2654435761u + 1;
+    if (bot->rng == 0) bot->rng = 1;
+}
+
+SimInput bot_random_walk(BotState* bot, const SimState* state) { // Holds the current heading most ticks and occasionally picks a new one.
+    (void)state;
+    SimInput input = { SIM_DIR_NONE };
+    if (bot_rand(bot) % 16 == 0) {
+        input.direction = (SimDir)(SIM_DIR_RIGHT + bot_rand(bot) % 4);
+    }
+    return input;
+}
+
+static const float SEARCH_DEAD = -1e9f;
+static const float SEARCH_WON = 1e9f;
+static const int SEARCH_GHOST_RADIUS = 4;     // Tiles within which a ghost lowers a state's value
+static const float SEARCH_GHOST_PENALTY = 20.0f;
+
+SearchConfig bot_search_defaults(void) { // One tile per move at Pac-Man's speed, ten moves ahead.
+    SearchConfig config;
+    config.beamWidth = 24;
+    config.depth = 10;
+    config.actionTicks = 10;
+    config.stepTicks = 10;
+    return config;
+}
+
+bool bot_search_init(SearchBot* bot, const SearchConfig* config, const SimState* shape) { // Allocates arenas, table and the scratch state.
+    memset(bot, 0, sizeof(*bot));
+    bot->config = *config;
+    if (bot->config.beamWidth < 1) bot->config.beamWidth = 1;
+    if (bot->config.actionTicks < 1) bot->config.actionTicks = 1;
+    if (bot->config.stepTicks < 1 || bot->config.stepTicks > bot->config.actionTicks) bot->config.stepTicks = bot->config.actionTicks;
+
+    int children = bot->config.beamWidth * 4;
+    uint32_t tableSize = 1024;
+    while (tableSize < (uint32_t)children * (bot->config.depth + 1) * 2) tableSize *= 2;
+    bot->tableMask = tableSize - 1;
+
+    bool ok = sim_arena_init(&bot->arenas[0], shape, children) && sim_arena_init(&bot->arenas[1], shape, children) &&
+              sim_clone(&bot->scratch, shape);
+    bot->firstMove[0] = (uint8_t*)malloc(children);
+    bot->firstMove[1] = (uint8_t*)malloc(children);
+    bot->values = (float*)malloc(children * sizeof(float));
+    bot->beam = (int*)malloc(children * sizeof(int));
+    bot->tableKeys = (uint64_t*)malloc(tableSize * sizeof(uint64_t));
+    bot->tableStamps = (uint32_t*)calloc(tableSize, sizeof(uint32_t));
+    if (!ok || !bot->firstMove[0] || !bot->firstMove[1] || !bot->values || !bot->beam || !bot->tableKeys || !bot->tableStamps) {
+        bot_search_free(bot);
+        return false;
+    }
+    return true;
+}
+
+void bot_search_free(SearchBot* bot) { // Releases everything bot_search_init allocated.
+    sim_arena_free(&bot->arenas[0]);
+    sim_arena_free(&bot->arenas[1]);
+    sim_free(&bot->scratch);
+    free(bot->firstMove[0]);
+    free(bot->firstMove[1]);
+    free(bot->values);
+    free(bot->beam);
+    free(bot->tableKeys);
+    free(bot->tableStamps);
+    memset(bot, 0, sizeof(*bot));
+}
+
+static bool table_insert(SearchBot* bot, uint64_t key) { // False when the key was already reached this search.
+    uint32_t index = (uint32_t)key & bot->tableMask;
+    while (bot->tableStamps[index] == bot->stamp) {
+        if (bot->tableKeys[index] == key) return false;
+        index = (index + 1) & bot->tableMask;
+    }
+    bot->tableStamps[index] = bot->stamp;
+    bot->tableKeys[index] = key;
+    return true;
+}
+
+static float evaluate(const SimState* state) { // Score, minus the path distance to the nearest pellet and a penalty for nearby ghosts.
+    if (state->status == SIM_DEAD) return SEARCH_DEAD;
+    if (state->status == SIM_WON) return SEARCH_WON;
+
+    int width = state->maze.width;
+    int pacmanX = sim_tile(state->pacman.position.x);
+    int pacmanY = sim_tile(state->pacman.position.y);
+    // Distances are symmetric, so the field towards Pac-Man's tile gives the path length from every tile.
+    const uint32_t* field = state->nav ? nav_field(state->nav, pacmanX, pacmanY) : NULL;
+
+    uint32_t nearest = NAV_UNREACHABLE;
+    for (int y = 0; y < state->maze.height; y++) {
+        for (int w = 0; w < state->maze.rowWords; w++) {
+            uint64_t bits = state->maze.pellets[(size_t)y * state->maze.rowWords + w];
+            while (bits) {
+                int x = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                uint32_t distance = field ? field[(size_t)y * width + x] : (uint32_t)(abs(x - pacmanX) + abs(y - pacmanY));
+                if (distance < nearest) nearest = distance;
+            }
+        }
+    }
+
+    float value = (float)state->score;
+    if (nearest != NAV_UNREACHABLE) value -= (float)nearest;
+
+    for (int i = 0; i < state->activeGhostsCount; i++) {
+        int ghostX = sim_tile(state->ghosts[i].position.x);
+        int ghostY = sim_tile(state->ghosts[i].position.y);
+        uint32_t distance = field ? field[(size_t)ghostY * width + ghostX] : (uint32_t)(abs(ghostX - pacmanX) + abs(ghostY - pacmanY));
+        if (distance < (uint32_t)SEARCH_GHOST_RADIUS) value -= (SEARCH_GHOST_RADIUS - distance) * SEARCH_GHOST_PENALTY;
+    }
+    return value;
+}
+
+static void play_move(SearchBot* bot, SimDir move) { // Holds one direction on the scratch state for a move's ticks.
+    SimInput input = { move };
+    for (int t = 0; t < bot->config.actionTicks && bot->scratch.status == SIM_PLAYING; t += bot->config.stepTicks) {
+        int ticks = bot->config.actionTicks - t;
+        if (ticks > bot->config.stepTicks) ticks = bot->config.stepTicks;
+        sim_step_ticks(&bot->scratch, input, ticks);
+        bot->searchTicks += ticks;
+    }
+}
+
+static void keep_best(SearchBot* bot, int count) { // Insertion-sorts the best beamWidth child slots into the beam.
+    bot->beamCount = 0;
+    for (int slot = 0; slot < count; slot++) {
+        float value = bot->values[slot];
+        if (bot->beamCount == bot->config.beamWidth && value <= bot->values[bot->beam[bot->beamCount - 1]]) continue;
+        int k = (bot->beamCount < bot->config.beamWidth) ? bot->beamCount++ : bot->beamCount - 1;
+        while (k > 0 && bot->values[bot->beam[k - 1]] < value) {
+            bot->beam[k] = bot->beam[k - 1];
+            k--;
+        }
+        bot->beam[k] = slot;
+    }
+}
+
+static SimDir plan(SearchBot* bot, const SimState* root) { // One beam search from root; returns the first move of the best line.
+    if (++bot->stamp == 0) {
+        memset(bot->tableStamps, 0, (bot->tableMask + 1) * sizeof(uint32_t));
+        bot->stamp = 1;
+    }
+    bot->searches++;
+
+    SimArena* from = &bot->arenas[0];
+    sim_arena_clear(from);
+    bot->beam[0] = sim_arena_save(from, root);
+    bot->beamCount = 1;
+    bot->firstMove[0][0] = SIM_DIR_NONE;
+    table_insert(bot, sim_state_hash(root));
+
+    SimDir best = SIM_DIR_NONE;
+    for (int depth = 0; depth < bot->config.depth; depth++) {
+        int side = depth & 1;
+        from = &bot->arenas[side];
+        SimArena* to = &bot->arenas[side ^ 1];
+        sim_arena_clear(to);
+
+        for (int b = 0; b < bot->beamCount; b++) {
+            int parent = bot->beam[b];
+            for (int move = SIM_DIR_RIGHT; move <= SIM_DIR_DOWN; move++) {
+                sim_arena_load(from, parent, &bot->scratch);
+                if (bot->scratch.status != SIM_PLAYING) break;
+                play_move(bot, (SimDir)move);
+                if (!table_insert(bot, sim_state_hash(&bot->scratch))) continue;
+
+                int slot = sim_arena_save(to, &bot->scratch);
+                if (slot < 0) break;
+                bot->firstMove[side ^ 1][slot] = depth == 0 ? (uint8_t)move : bot->firstMove[side][parent];
+                bot->values[slot] = evaluate(&bot->scratch);
+                if (bot->values[slot] == SEARCH_WON) return (SimDir)bot->firstMove[side ^ 1][slot];
+            }
+        }
+
+        if (to->count == 0) break;
+        keep_best(bot, to->count);
+        best = (SimDir)bot->firstMove[side ^ 1][bot->beam[0]];
+    }
+    return best;
+}
+
+SimInput bot_search(SearchBot* bot, const SimState* state) { // Keeps holding the planned move until it runs out, then searches again.
+    SimInput input = { SIM_DIR_NONE };
+    if (state->status != SIM_PLAYING) return input;
+
+    // A tick outside the held move's range means the game moved on without us (restart, new level, skipped ticks).
+    if (bot->move == SIM_DIR_NONE || state->tick < bot->moveStart || state->tick >= bot->moveEnd) {
+        bot->move = plan(bot, state);
+        bot->moveStart = state->tick;
+        bot->moveEnd = state->tick + bot->config.actionTicks;
+    }
+    input.direction = bot->move;
+    return input;
+}
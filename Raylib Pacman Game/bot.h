@@ -0,0 +1,54 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "sim.h"
+
+// Scripted players that drive the simulation core without a keyboard.
+
+typedef struct BotState {
+    uint32_t rng;
+} BotState;
+
+void bot_init(BotState* bot, uint32_t seed);
+SimInput bot_random_walk(BotState* bot, const SimState* state);
+
+// Lookahead autopilot.
+// A beam search over moves that each hold one direction for actionTicks ticks. Moves are played on the real
+// simulation (ghost targeting, steering and collisions included) from snapshots in two ping-pong arenas, so
+// the forward model is the game itself. Each depth keeps the beamWidth best states, and a transposition
+// table keyed on sim_state_hash drops states another move order already reached. The first move of the best
+// line at the deepest level is held for actionTicks ticks, then the search runs again.
+
+typedef struct SearchConfig {
+    int beamWidth;
+    int depth;          // Moves looked ahead
+    int actionTicks;    // Ticks each move holds its direction
+    int stepTicks;      // Ticks per forward-model sim step; equal to actionTicks, a move is one swept step
+} SearchConfig;
+
+typedef struct SearchBot {
+    SearchConfig config;
+    SimArena arenas[2];     // Beam of one depth and the children of the next
+    uint8_t* firstMove[2];  // Root move each snapshot descends from, per arena slot
+    float* values;          // Evaluation of each child slot
+    int* beam;              // Slots kept at the current depth, best first
+    int beamCount;
+    uint64_t* tableKeys;    // Open-addressed transposition table, valid where tableStamps == stamp
+    uint32_t* tableStamps;
+    uint32_t tableMask;
+    uint32_t stamp;
+    SimState scratch;       // Working state the snapshots are restored into
+    SimDir move;            // Move being held
+    uint32_t moveStart;     // Tick range the move covers
+    uint32_t moveEnd;
+    long long searches;
+    long long searchTicks;  // Ticks simulated by the forward model
+} SearchBot;
+
+SearchConfig bot_search_defaults(void);
+// Sizes the arenas for shape's maze; any level of the same size can be searched afterwards.
+bool bot_search_init(SearchBot* bot, const SearchConfig* config, const SimState* shape);
+void bot_search_free(SearchBot* bot);
+SimInput bot_search(SearchBot* bot, const SimState* state);
+
+#endif
@@ -0,0 +1,61 @@
+#include "events.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool event_bus_init(EventBus* bus, int capacity) { // Allocates the buffer; no consumers yet.
+    memset(bus, 0, sizeof(*bus));
+    if (capacity < 1) capacity = 1;
+    bus->buffer.events = (SimEvent*)malloc((size_t)capacity * sizeof(SimEvent));
+    if (!bus->buffer.events) return false;
+    bus->buffer.capacity = capacity;
+    return true;
+}
+
+void event_bus_free(EventBus* bus) { // Releases the buffer.
+    free(bus->buffer.events);
+    memset(bus, 0, sizeof(*bus));
+}
+
+int event_bus_subscribe(EventBus* bus, EventConsumer consumer, void* context) { // Appends a consumer.
+    if (bus->consumerCount >= EVENT_BUS_MAX_CONSUMERS) return -1;
+    bus->consumers[bus->consumerCount] = consumer;
+    bus->contexts[bus->consumerCount] = context;
+    bus->enabled[bus->consumerCount] = true;
+    return bus->consumerCount++;
+}
+
+void event_bus_enable(EventBus* bus, int id, bool enabled) { // Ids that were never handed out are ignored.
+    if (id >= 0 && id < bus->consumerCount) bus->enabled[id] = enabled;
+}
+
+void event_bus_dispatch(EventBus* bus) { // One call per consumer per batch, none for an empty one.
+    if (bus->buffer.count > 0) {
+        for (int i = 0; i < bus->consumerCount; i++) {
+            if (bus->enabled[i]) bus->consumers[i](bus->contexts[i], bus->buffer.events, bus->buffer.count);
+        }
+    }
+    bus->buffer.count = 0;
+}
+
+void event_bus_clear(EventBus* bus) { // Drops the batch.
+    bus->buffer.count = 0;
+}
+
+void event_tally_consume(void* context, const SimEvent* events, int count) { // Adds a batch to the counts.
+    EventTally* tally = (EventTally*)context;
+    for (int i = 0; i < count; i++) {
+        tally->counts[events[i].type]++;
+        tally->points += events[i].points;
+    }
+    tally->batches++;
+}
+
+const char* sim_event_type_name(SimEventType type) { // Short label for reports.
+    switch (type) {
+        case SIM_EVENT_TYPE_PELLET_EATEN: return "pellets";
+        case SIM_EVENT_TYPE_GHOST_REVERSED: return "reversals";
+        case SIM_EVENT_TYPE_PACMAN_DIED: return "deaths";
+        case SIM_EVENT_TYPE_LEVEL_CLEARED: return "clears";
+        default: return "?";
+    }
+}
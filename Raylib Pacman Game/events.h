@@ -0,0 +1,89 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "sim.h"
+
+// Gameplay events.
+// While a SimState has an event buffer attached, sim_step pushes one typed event per thing that happened
+// (each pellet, each ghost forced to turn back, a death, a cleared board) into it; the step itself has no
+// side effects either way. The buffer is preallocated and never grows: once full, further events are only
+// counted in `dropped`. Stepping without a buffer, as the headless runs, bot searches and rewind do, costs
+// one pointer test per would-be event.
+//
+// An EventBus owns a buffer and a list of consumers. After the frame's ticks have run, event_bus_dispatch
+// hands the whole batch to every enabled consumer in subscription order and empties the buffer, so sounds,
+// telemetry and the like can be switched on and off without touching the update loop.
+
+#define EVENT_BUS_CAPACITY 256 // Events per batch; a frame of normal play raises a handful
+#define EVENT_BUS_MAX_CONSUMERS 8
+
+typedef enum {
+    SIM_EVENT_TYPE_PELLET_EATEN,
+    SIM_EVENT_TYPE_GHOST_REVERSED, // A ghost hit a dead end and had to turn back
+    SIM_EVENT_TYPE_PACMAN_DIED,
+    SIM_EVENT_TYPE_LEVEL_CLEARED,
+    SIM_EVENT_TYPE_COUNT
+} SimEventType;
+
+typedef struct SimEvent {
+    SimEventType type;
+    uint32_t tick;      // Tick the step that raised it ended on
+    int actor;          // Player index for Pac-Man events, ghost index for ghost events, -1 for a shared board cleared
+    int tileX;          // Where it happened
+    int tileY;
+    int points;         // Score gained
+} SimEvent;
+
+typedef struct SimEventBuffer {
+    SimEvent* events;
+    int count;
+    int capacity;
+    uint32_t tick;      // Set by the step before it raises anything
+    long long dropped;  // Events that found the buffer full
+} SimEventBuffer;
+
+inline void sim_event_push(SimEventBuffer* buffer, SimEventType type, int actor, int tileX, int tileY, int points) { // Appends one event, or counts it as dropped.
+    if (buffer->count >= buffer->capacity) {
+        buffer->dropped++;
+        return;
+    }
+    SimEvent* event = &buffer->events[buffer->count++];
+    event->type = type;
+    event->tick = buffer->tick;
+    event->actor = actor;
+    event->tileX = tileX;
+    event->tileY = tileY;
+    event->points = points;
+}
+
+typedef void (*EventConsumer)(void* context, const SimEvent* events, int count);
+
+typedef struct EventBus {
+    SimEventBuffer buffer;          // Attach with state->events = &bus.buffer
+    EventConsumer consumers[EVENT_BUS_MAX_CONSUMERS];
+    void* contexts[EVENT_BUS_MAX_CONSUMERS];
+    bool enabled[EVENT_BUS_MAX_CONSUMERS];
+    int consumerCount;
+} EventBus;
+
+bool event_bus_init(EventBus* bus, int capacity);
+void event_bus_free(EventBus* bus);
+// Returns the consumer's id for event_bus_enable, or -1 when the bus is full. Consumers start enabled.
+int event_bus_subscribe(EventBus* bus, EventConsumer consumer, void* context);
+void event_bus_enable(EventBus* bus, int id, bool enabled);
+// Hands the pending events to every enabled consumer, then empties the buffer.
+void event_bus_dispatch(EventBus* bus);
+// Forgets the pending events without delivering them.
+void event_bus_clear(EventBus* bus);
+
+// A consumer that counts events by type, for telemetry and the headless reports.
+typedef struct EventTally {
+    long long counts[SIM_EVENT_TYPE_COUNT];
+    long long points;
+    long long batches;
+} EventTally;
+
+void event_tally_consume(void* context, const SimEvent* events, int count);
+const char* sim_event_type_name(SimEventType type);
+
+#endif
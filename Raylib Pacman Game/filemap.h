@@ -0,0 +1,14 @@
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Read-only memory mapping of whole files, for data that is used in place rather than read and parsed
+// (.pmz mazes, the asset archive). Pages come in from the OS cache as they're first touched.
+
+// False for missing or empty files.
+bool file_map(const char* fileName, void** view, size_t* size);
+void file_unmap(void* view, size_t size);
+
+#endif
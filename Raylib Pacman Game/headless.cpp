@@ -0,0 +1,777 @@
+#include "sim.h"
+#include "mazegen.h"
+#include "bot.h"
+#include "batch.h"
+#include "replay.h"
+#include "swarm.h"
+#include "leaderboard.h"
+#include "net.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Window-free driver for the simulation core.
+// Plays games back to back with a random-walk bot and reports how many ticks per second the core sustains,
+// or with --batch plays N games per difficulty across all cores and prints aggregate stats.
+// --record FILE saves one bot game as a replay; --replay FILE (repeatable) plays replays back at full speed,
+// checks each ends in its recorded state and exits non-zero on any mismatch.
+// --swarm N adds an N-ghost stress swarm to the tick benchmark (harmless unless --swarm-lethal).
+// --maze FILE plays on a .pmz map instead of the built-in maze, --maze-tile N repeats the maze N x N times,
+// and --write-maze FILE saves the resulting map and exits.
+// --levels lets won games carry on through generated levels; --generate N times generating and validating N
+// levels the size of the current maze (with --write-maze, the first one is saved).
+// --leaderboard FILE stores every finished bot game in a persistent leaderboard and reports load/insert cost;
+// with --batch, every batch game is entered once the workers are done.
+// --step N advances the tick benchmark and batches N ticks per sim step (the bot decides once per step).
+// --check-step N plays --batch games per difficulty (default 64) both tick by tick and N ticks per sim_step_ticks
+// call, and exits non-zero if the state hashes ever differ.
+// --autopilot N plays N games with the lookahead search bot and reports its score and simulation throughput.
+// --serve PORT runs a multiplayer server on a UDP port; --connect HOST:PORT joins one as a random-walk bot
+// (start several to share a board), with --net-loss P dropping P% of its snapshots on purpose. Both run for
+// --net-seconds S (0 serves until killed). --net-bench N plays N full sessions against one server in-process
+// over loopback, unthrottled, and reports the server's cost per session and the bandwidth per client.
+// --events attaches a gameplay event bus with a counting consumer to the tick benchmark and reports the counts.
+// Usage: pacman_headless [--ticks N] [--difficulty easy|normal|hard] [--seed S] [--batch N] [--threads T]
+//                        [--record FILE] [--replay FILE]... [--repeat N] [--swarm N] [--swarm-lethal]
+//                        [--maze FILE] [--maze-tile N] [--write-maze FILE] [--levels] [--generate N]
+//                        [--leaderboard FILE] [--step N] [--check-step N] [--autopilot N] [--serve PORT]
+//                        [--connect HOST:PORT] [--net-bench N] [--net-seconds S] [--net-loss P] [--events]
+
+const uint32_t MAX_GAME_TICKS = SIM_TICKS_PER_SECOND * 60 * 5;
+
+static bool parse_difficulty(const char* text, Difficulty* out) { // Maps a command line word to a Difficulty.
+    if (strcmp(text, "easy") == 0) { *out = EASY; return true; }
+    if (strcmp(text, "normal") == 0) { *out = NORMAL; return true; }
+    if (strcmp(text, "hard") == 0) { *out = HARD; return true; }
+    return false;
+}
+
+static void play_bot_game(SimState* state, BotState* bot, EventBus* events, bool levels, int step, long long* ticksRun, long long tickLimit) { // Steps a bot game until it ends, optionally moving on to generated levels.
+    for (;;) {
+        while (state->status == SIM_PLAYING && state->tick < MAX_GAME_TICKS && *ticksRun < tickLimit) {
+            sim_step_ticks(state, bot_random_walk(bot, state), step);
+            if (events) event_bus_dispatch(events);
+            *ticksRun += step;
+        }
+        if (!levels || state->status != SIM_WON || state->tick >= MAX_GAME_TICKS || *ticksRun >= tickLimit || !sim_next_level(state)) break;
+    }
+}
+
+static int run_batch(const MazeMap* map, int gamesPerDifficulty, int threads, uint32_t seed, bool levels, int step, const char* leaderboardFile) { // Runs a parallel batch and prints one stats row per difficulty.
+    // Scores are collected per game and entered after the workers join, so the board is only touched by one thread.
+    std::vector<int> scores;
+    if (leaderboardFile) scores.resize((size_t)gamesPerDifficulty * DIFFICULTY_COUNT);
+
+    BatchConfig config;
+    config.map = map;
+    config.levels = levels;
+    config.stepTicks = step;
+    config.gamesPerDifficulty = gamesPerDifficulty;
+    config.threads = threads;
+    config.seed = seed;
+    config.maxTicks = MAX_GAME_TICKS;
+    config.scores = leaderboardFile ? scores.data() : NULL;
+
+    BatchStats stats[DIFFICULTY_COUNT];
+
+    auto startTime = std::chrono::steady_clock::now();
+    batch_run(&config, stats);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    const char* names[DIFFICULTY_COUNT] = { "EASY", "NORMAL", "HARD" };
+    long long totalGames = 0;
+    long long totalTicks = 0;
+
+    printf("%-8s %8s %10s %8s %8s %12s %12s %8s %8s\n", "diff", "games", "avg score", "min", "max", "avg ticks", "avg pellets", "win %", "levels");
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        const BatchStats* s = &stats[d];
+        if (s->games == 0) continue;
+        printf("%-8s %8lld %10.1f %8d %8d %12.1f %12.1f %7.2f%% %8lld\n", names[d], s->games,
+            (double)s->scoreSum / s->games, s->scoreMin, s->scoreMax,
+            (double)s->survivalTicksSum / s->games, (double)s->pelletsLeftSum / s->games,
+            100.0 * s->wins / s->games, s->levelsClearedSum);
+        totalGames += s->games;
+        totalTicks += s->survivalTicksSum;
+    }
+
+    printf("time: %.3f s  games/s: %.0f  ticks/s: %.0f\n", seconds,
+        seconds > 0.0 ? totalGames / seconds : 0.0, seconds > 0.0 ? totalTicks / seconds : 0.0);
+
+    if (leaderboardFile) {
+        Leaderboard leaderboard;
+        auto openStart = std::chrono::steady_clock::now();
+        if (!leaderboard_open(&leaderboard, leaderboardFile)) {
+            fprintf(stderr, "Failed to open leaderboard %s\n", leaderboardFile);
+            return 1;
+        }
+        double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStart).count();
+
+        auto insertStart = std::chrono::steady_clock::now();
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+            for (int g = 0; g < gamesPerDifficulty; g++) leaderboard_insert(&leaderboard, (Difficulty)d, "bot", scores[(size_t)d * gamesPerDifficulty + g]);
+        }
+        double insertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - insertStart).count();
+
+        int stored = leaderboard_count(&leaderboard, EASY) + leaderboard_count(&leaderboard, NORMAL) + leaderboard_count(&leaderboard, HARD);
+        auto closeStart = std::chrono::steady_clock::now();
+        leaderboard_close(&leaderboard);
+        double closeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - closeStart).count();
+        printf("leaderboard %s: opened in %.1f ms, %zu inserts at %.2f us each, %d stored, closed in %.1f ms\n", leaderboardFile,
+            openSeconds * 1000.0, scores.size(), scores.empty() ? 0.0 : insertSeconds * 1e6 / scores.size(), stored, closeSeconds * 1000.0);
+    }
+    return 0;
+}
+
+static int record_game(const char* fileName, const MazeMap* map, Difficulty difficulty, uint32_t seed, bool levels, NavCache* nav) { // Plays one bot game and writes it out as a replay.
+    ReplayWriter writer;
+    if (!replay_writer_open(&writer, fileName, difficulty, seed)) {
+        fprintf(stderr, "Failed to open %s\n", fileName);
+        return 1;
+    }
+
+    SimState state;
+    BotState bot;
+    if (!sim_init(&state, map, difficulty, seed, nav)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    bot_init(&bot, seed);
+    for (;;) {
+        while (state.status == SIM_PLAYING && state.tick < MAX_GAME_TICKS) {
+            SimInput input = bot_random_walk(&bot, &state);
+            replay_writer_record(&writer, input);
+            sim_step(&state, input);
+        }
+        if (!levels || state.status != SIM_WON || state.tick >= MAX_GAME_TICKS || !sim_next_level(&state)) break;
+    }
+
+    bool written = replay_writer_close(&writer, &state);
+    if (written) {
+        printf("recorded %s: %u ticks, %d runs, level %d, score %d, state hash %016llx\n", fileName, writer.tickCount, (int)writer.runCount,
+            state.level, state.score, (unsigned long long)sim_state_hash(&state));
+    } else {
+        fprintf(stderr, "Failed to write %s\n", fileName);
+    }
+    sim_free(&state);
+    return written ? 0 : 1;
+}
+
+static int play_replays(const std::vector<const char*>& fileNames, const MazeMap* map, int repeat, NavCache* nav) { // Plays every replay `repeat` times and reports mismatches and throughput.
+    std::vector<Replay> replays(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        if (!replay_load(&replays[i], fileNames[i])) {
+            fprintf(stderr, "Failed to load replay %s\n", fileNames[i]);
+            for (size_t j = 0; j < i; j++) replay_free(&replays[j]);
+            return 1;
+        }
+    }
+
+    int mismatches = 0;
+    long long ticksRun = 0;
+    SimState state;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < replays.size(); i++) {
+            bool match = replay_play(&replays[i], map, nav, &state);
+            ticksRun += state.tick;
+            if (r == 0) {
+                printf("%s: %u ticks, level %d, score %d, %s\n", fileNames[i], state.tick, state.level, state.score, match ? "ok" : "MISMATCH");
+            }
+            if (!match) mismatches++;
+            sim_free(&state);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    printf("replays: %d  ticks: %lld  mismatches: %d\n", (int)replays.size() * repeat, ticksRun, mismatches);
+    printf("time: %.3f s  throughput: %.0f ticks/s\n", seconds, seconds > 0.0 ? ticksRun / seconds : 0.0);
+
+    for (size_t i = 0; i < replays.size(); i++) replay_free(&replays[i]);
+    return mismatches ? 1 : 0;
+}
+
+static int check_step(const MazeMap* map, uint32_t seed, int games, int step, bool levels) { // Plays each game twice, tick by tick and in step-tick chunks, and compares state hashes after every chunk.
+    // One nav cache per copy: sim_next_level rebuilds it in place for the state that owns it.
+    NavCache navs[2];
+    if (!sim_init_nav(&navs[0], map)) {
+        fprintf(stderr, "Failed to build ghost distance fields\n");
+        return 1;
+    }
+    if (!sim_init_nav(&navs[1], map)) {
+        fprintf(stderr, "Failed to build ghost distance fields\n");
+        nav_free(&navs[0]);
+        return 1;
+    }
+
+    static const Difficulty difficulties[] = { EASY, NORMAL, HARD };
+    int mismatches = 0;
+    long long ticksRun = 0;
+    for (int d = 0; d < 3; d++) {
+        for (int g = 0; g < games; g++) {
+            uint32_t gameSeed = seed + (uint32_t)g;
+            SimState ticked;
+            SimState chunked;
+            if (!sim_init(&ticked, map, difficulties[d], gameSeed, &navs[0])) {
+                fprintf(stderr, "Out of memory\n");
+                nav_free(&navs[0]);
+                nav_free(&navs[1]);
+                return 1;
+            }
+            if (!sim_init(&chunked, map, difficulties[d], gameSeed, &navs[1])) {
+                fprintf(stderr, "Out of memory\n");
+                sim_free(&ticked);
+                nav_free(&navs[0]);
+                nav_free(&navs[1]);
+                return 1;
+            }
+            BotState bot;
+            bot_init(&bot, gameSeed);
+
+            bool same = true;
+            for (;;) {
+                while (same && ticked.status == SIM_PLAYING && ticked.tick < MAX_GAME_TICKS) {
+                    SimInput input = bot_random_walk(&bot, &ticked);
+                    for (int t = 0; t < step; t++) sim_step(&ticked, input);
+                    sim_step_ticks(&chunked, input, step);
+                    same = sim_state_hash(&ticked) == sim_state_hash(&chunked);
+                }
+                if (!same || !levels || ticked.status != SIM_WON || ticked.tick >= MAX_GAME_TICKS) break;
+                if (!sim_next_level(&ticked) || !sim_next_level(&chunked)) break;
+            }
+            ticksRun += ticked.tick;
+            if (!same) {
+                printf("seed %u (%s): diverged at tick %u\n", gameSeed, difficulties[d] == EASY ? "easy" : difficulties[d] == NORMAL ? "normal" : "hard", ticked.tick);
+                mismatches++;
+            }
+            sim_free(&ticked);
+            sim_free(&chunked);
+        }
+    }
+    printf("step %d: games: %d  ticks: %lld  mismatches: %d\n", step, games * 3, ticksRun, mismatches);
+
+    nav_free(&navs[0]);
+    nav_free(&navs[1]);
+    return mismatches ? 1 : 0;
+}
+
+static int run_games(const MazeMap* map, Difficulty difficulty, uint32_t seed, long long totalTicks, const char* recordFile,
+    const std::vector<const char*>& replayFiles, int repeat, int swarmCount, bool swarmLethal, bool levels, int step, const char* leaderboardFile, bool withEvents) { // Single-threaded modes: record/replay, or the tick benchmark.
+    NavCache nav;
+    if (!sim_init_nav(&nav, map)) {
+        fprintf(stderr, "Failed to build ghost distance fields\n");
+        return 1;
+    }
+
+    if (recordFile || !replayFiles.empty()) {
+        int result = recordFile ? record_game(recordFile, map, difficulty, seed, levels, &nav) : 0;
+        if (result == 0 && !replayFiles.empty()) result = play_replays(replayFiles, map, repeat, &nav);
+        nav_free(&nav);
+        return result;
+    }
+
+    Swarm swarm;
+    memset(&swarm, 0, sizeof(swarm));
+    if (swarmCount > 0) {
+        if (!swarm_init(&swarm, swarmCount)) {
+            fprintf(stderr, "Failed to allocate a swarm of %d\n", swarmCount);
+            nav_free(&nav);
+            return 1;
+        }
+        swarm.lethal = swarmLethal;
+    }
+    uint64_t swarmContacts = 0;
+
+    EventBus eventBus;
+    EventTally eventTally;
+    memset(&eventTally, 0, sizeof(eventTally));
+    if (withEvents) {
+        if (!event_bus_init(&eventBus, EVENT_BUS_CAPACITY)) {
+            fprintf(stderr, "Failed to allocate the event bus\n");
+            swarm_free(&swarm);
+            nav_free(&nav);
+            return 1;
+        }
+        event_bus_subscribe(&eventBus, event_tally_consume, &eventTally);
+    }
+
+    Leaderboard leaderboard;
+    double leaderboardSeconds = 0.0;
+    if (leaderboardFile) {
+        auto openStart = std::chrono::steady_clock::now();
+        if (!leaderboard_open(&leaderboard, leaderboardFile)) {
+            fprintf(stderr, "Failed to open leaderboard %s\n", leaderboardFile);
+            if (withEvents) event_bus_free(&eventBus);
+            swarm_free(&swarm);
+            nav_free(&nav);
+            return 1;
+        }
+        double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStart).count();
+        printf("leaderboard %s: %d entries, opened in %.1f ms\n", leaderboardFile,
+            leaderboard_count(&leaderboard, EASY) + leaderboard_count(&leaderboard, NORMAL) + leaderboard_count(&leaderboard, HARD), openSeconds * 1000.0);
+    }
+
+    SimState state;
+    BotState bot;
+    bot_init(&bot, seed);
+    int games = 0;
+    int levelsCleared = 0;
+    long long scoreSum = 0;
+    uint64_t boardHash = 0;
+    long long ticksRun = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    while (ticksRun < totalTicks) {
+        if (!sim_init(&state, map, difficulty, seed + (uint32_t)games, &nav) ||
+            (swarmCount > 0 && !swarm_reset(&swarm, &state, (seed + (uint32_t)games) ^ 0xA5A5A5A5u))) {
+            fprintf(stderr, "Out of memory\n");
+            break;
+        }
+        if (swarmCount > 0) state.swarm = &swarm;
+        if (withEvents) state.events = &eventBus.buffer;
+        play_bot_game(&state, &bot, withEvents ? &eventBus : NULL, levels, step, &ticksRun, totalTicks);
+        levelsCleared += state.level - 1;
+        scoreSum += state.score;
+        boardHash = boardHash * 31 + sim_pellet_hash(&state);
+        games++;
+        swarmContacts += swarm.contacts;
+        if (leaderboardFile) {
+            auto insertStart = std::chrono::steady_clock::now();
+            leaderboard_insert(&leaderboard, difficulty, "bot", state.score);
+            leaderboardSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - insertStart).count();
+        }
+        sim_free(&state);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    printf("games: %d  ticks: %lld  avg score: %.1f  board hash: %016llx\n", games, ticksRun, games ? (double)scoreSum / games : 0.0, (unsigned long long)boardHash);
+    printf("time: %.3f s  throughput: %.0f ticks/s\n", seconds, seconds > 0.0 ? ticksRun / seconds : 0.0);
+    if (levels) printf("levels cleared and moved past: %d\n", levelsCleared);
+    if (leaderboardFile) {
+        LeaderboardEntry best = { "", 0 };
+        leaderboard_entry(&leaderboard, difficulty, 1, &best);
+        auto closeStart = std::chrono::steady_clock::now();
+        int stored = leaderboard_count(&leaderboard, difficulty);
+        leaderboard_close(&leaderboard);
+        double closeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - closeStart).count();
+        printf("leaderboard: %d inserts at %.2f us each, %d stored for this difficulty, best %d, closed in %.1f ms\n", games,
+            games ? leaderboardSeconds * 1e6 / games : 0.0, stored, best.score, closeSeconds * 1000.0);
+    }
+    if (swarmCount > 0) {
+        printf("swarm: %d ghosts  contacts: %llu  entity updates: %.0f/s\n", swarmCount, (unsigned long long)swarmContacts,
+            seconds > 0.0 ? (double)ticksRun * swarmCount / seconds : 0.0);
+    }
+    if (withEvents) {
+        long long total = 0;
+        printf("events:");
+        for (int t = 0; t < SIM_EVENT_TYPE_COUNT; t++) {
+            printf(" %s %lld", sim_event_type_name((SimEventType)t), eventTally.counts[t]);
+            total += eventTally.counts[t];
+        }
+        printf("  points %lld  dropped %lld\n", eventTally.points, eventBus.buffer.dropped);
+        printf("event batches: %lld  events: %lld  (%.0f/s)\n", eventTally.batches, total, seconds > 0.0 ? total / seconds : 0.0);
+        event_bus_free(&eventBus);
+    }
+
+    swarm_free(&swarm);
+    nav_free(&nav);
+    return 0;
+}
+
+static int run_autopilot(const MazeMap* map, Difficulty difficulty, uint32_t seed, int gameCount, bool levels) { // Plays games with the search bot and reports its play and forward-model throughput.
+    NavCache nav;
+    SimState state;
+    if (!sim_init_nav(&nav, map) || !sim_init(&state, map, difficulty, seed, &nav)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    SearchConfig config = bot_search_defaults();
+    SearchBot bot;
+    if (!bot_search_init(&bot, &config, &state)) {
+        fprintf(stderr, "Out of memory\n");
+        sim_free(&state);
+        nav_free(&nav);
+        return 1;
+    }
+
+    // Cost of one snapshot round trip, the operation the search is built on.
+    const int copies = 100000;
+    auto copyStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < copies; i++) {
+        sim_arena_clear(&bot.arenas[0]);
+        sim_arena_load(&bot.arenas[0], sim_arena_save(&bot.arenas[0], &state), &bot.scratch);
+    }
+    double copySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - copyStart).count();
+    sim_free(&state);
+
+    int wins = 0;
+    int levelsCleared = 0;
+    long long scoreSum = 0;
+    long long gameTicks = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int g = 0; g < gameCount; g++) {
+        if (!sim_init(&state, map, difficulty, seed + (uint32_t)g, &nav)) break;
+        for (;;) {
+            while (state.status == SIM_PLAYING && state.tick < MAX_GAME_TICKS) {
+                sim_step(&state, bot_search(&bot, &state));
+            }
+            if (state.status == SIM_WON) wins++;
+            if (!levels || state.status != SIM_WON || state.tick >= MAX_GAME_TICKS || !sim_next_level(&state)) break;
+        }
+        levelsCleared += state.level - 1;
+        scoreSum += state.score;
+        gameTicks += state.tick;
+        sim_free(&state);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    printf("autopilot: %d games  avg score: %.1f  levels won: %d  avg ticks: %.1f\n", gameCount,
+        gameCount ? (double)scoreSum / gameCount : 0.0, wins, gameCount ? (double)gameTicks / gameCount : 0.0);
+    printf("search: beam %d x depth %d, %d ticks per move  %lld searches  %.1f us per search\n", config.beamWidth, config.depth,
+        config.actionTicks, bot.searches, bot.searches ? seconds * 1e6 / bot.searches : 0.0);
+    printf("snapshot: %zu bytes, save+load %.0f ns  forward model: %.0f ticks/s  time: %.3f s\n", bot.arenas[0].slotBytes,
+        copySeconds * 1e9 / copies, seconds > 0.0 ? bot.searchTicks / seconds : 0.0, seconds);
+    if (levels) printf("levels cleared and moved past: %d\n", levelsCleared);
+
+    bot_search_free(&bot);
+    nav_free(&nav);
+    return 0;
+}
+
+static const int NET_SERVER_SESSIONS = 256;
+static const int NET_REPORT_SECONDS = 5;
+static const int NET_UDP_OVERHEAD = 28; // IPv4 and UDP headers on every datagram
+
+static int run_server(const MazeMap* map, Difficulty difficulty, uint32_t seed, int port, int seconds) { // Serves sessions at the game's tick rate and reports load every few seconds.
+    NetServer server;
+    if (!net_startup() || !net_server_init(&server, map, difficulty, seed, (uint16_t)port, NET_SERVER_SESSIONS, SIM_MAX_PLAYERS)) {
+        fprintf(stderr, "Failed to serve %dx%d maze on UDP port %d\n", map->width, map->height, port);
+        net_shutdown();
+        return 1;
+    }
+    printf("serving %dx%d maze on UDP port %d: up to %d sessions of %d players\n", map->width, map->height, port, NET_SERVER_SESSIONS, SIM_MAX_PLAYERS);
+    fflush(stdout);
+
+    const auto tickLength = std::chrono::nanoseconds(1000000000LL / SIM_TICKS_PER_SECOND);
+    auto nextTick = std::chrono::steady_clock::now();
+    double busySeconds = 0.0;
+    NetServerStats reported = server.stats;
+    while (seconds <= 0 || server.tick < (uint32_t)(seconds * SIM_TICKS_PER_SECOND)) {
+        auto tickStart = std::chrono::steady_clock::now();
+        net_server_tick(&server);
+        busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - tickStart).count();
+
+        if (server.tick % (NET_REPORT_SECONDS * SIM_TICKS_PER_SECOND) == 0) {
+            int players = net_server_players(&server);
+            long long packets = server.stats.packetsOut - reported.packetsOut;
+            long long bytes = server.stats.bytesOut - reported.bytesOut + packets * NET_UDP_OVERHEAD;
+            printf("t=%us  sessions: %d  players: %d  tick: %.1f us  out: %.0f B/s per player  full snapshots: %lld  timeouts: %lld\n",
+                server.tick / SIM_TICKS_PER_SECOND, net_server_sessions(&server), players,
+                busySeconds * 1e6 / (NET_REPORT_SECONDS * SIM_TICKS_PER_SECOND),
+                players ? (double)bytes / NET_REPORT_SECONDS / players : 0.0,
+                server.stats.fullSnapshots - reported.fullSnapshots, server.stats.timeouts);
+            fflush(stdout);
+            reported = server.stats;
+            busySeconds = 0.0;
+        }
+        nextTick += tickLength;
+        std::this_thread::sleep_until(nextTick);
+    }
+
+    net_server_free(&server);
+    net_shutdown();
+    return 0;
+}
+
+static void print_client_stats(const NetClient* client, double seconds, const char* label) { // One line of traffic and prediction figures.
+    const NetClientStats* s = &client->stats;
+    printf("%s: player %d  score %d  snapshots: %lld (%lld full, %lld dropped)  in: %.0f B/s  out: %.0f B/s  "
+        "corrections: %lld (avg %.2f tiles)  inputs in flight: %.1f\n", label, client->self, client->players[client->self].score,
+        s->snapshots, s->fullSnapshots, s->dropped,
+        seconds > 0.0 ? (s->bytesIn + s->packetsIn * NET_UDP_OVERHEAD) / seconds : 0.0,
+        seconds > 0.0 ? (s->bytesOut + s->packetsOut * NET_UDP_OVERHEAD) / seconds : 0.0,
+        s->corrections, s->corrections ? s->correctionSum / s->corrections : 0.0,
+        s->snapshots ? (double)s->pendingSum / s->snapshots : 0.0);
+}
+
+static int run_client(const MazeMap* map, const char* target, uint32_t seed, int seconds, int lossPercent) { // Plays a random-walk bot against a server in real time.
+    char host[256];
+    strncpy(host, target, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    char* colon = strrchr(host, ':');
+    int port = NET_DEFAULT_PORT;
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    NetAddress server;
+    NetClient client;
+    if (!net_startup() || !net_resolve(host, (uint16_t)port, &server) || !net_client_init(&client, map, &server, seed)) {
+        fprintf(stderr, "Failed to reach %s:%d\n", host, port);
+        net_shutdown();
+        return 1;
+    }
+    client.dropPercent = lossPercent;
+
+    BotState bot;
+    bot_init(&bot, seed);
+    const auto tickLength = std::chrono::nanoseconds(1000000000LL / SIM_TICKS_PER_SECOND);
+    auto nextTick = std::chrono::steady_clock::now();
+    uint32_t tickLimit = (uint32_t)((seconds > 0 ? seconds : 30) * SIM_TICKS_PER_SECOND);
+    bool ok = true;
+    while (client.ticks < tickLimit) {
+        SimInput input = { SIM_DIR_NONE };
+        if (client.worldReady) input = bot_random_walk(&bot, &client.world);
+        if (!net_client_tick(&client, input)) {
+            ok = false;
+            break;
+        }
+        nextTick += tickLength;
+        std::this_thread::sleep_until(nextTick);
+    }
+
+    if (!ok) fprintf(stderr, "%s\n", client.rejected ? "Server refused the connection (full, or a different maze)" : "Lost the server");
+    print_client_stats(&client, (double)client.ticks / SIM_TICKS_PER_SECOND, "client");
+    net_client_free(&client);
+    net_shutdown();
+    return ok ? 0 : 1;
+}
+
+static int run_net_bench(const MazeMap* map, Difficulty difficulty, uint32_t seed, int port, int sessions, int seconds) { // Full sessions of bot clients against one server in this process, as fast as they go.
+    NetServer server;
+    if (!net_startup() || !net_server_init(&server, map, difficulty, seed, (uint16_t)port, sessions, SIM_MAX_PLAYERS)) {
+        fprintf(stderr, "Failed to serve on UDP port %d\n", port);
+        net_shutdown();
+        return 1;
+    }
+
+    NetAddress address;
+    net_resolve("127.0.0.1", (uint16_t)port, &address);
+    int clientCount = sessions * SIM_MAX_PLAYERS;
+    std::vector<NetClient> clients(clientCount);
+    std::vector<BotState> bots(clientCount);
+    int opened = 0;
+    for (; opened < clientCount; opened++) {
+        if (!net_client_init(&clients[opened], map, &address, seed + (uint32_t)opened + 1)) break;
+        bot_init(&bots[opened], seed + (uint32_t)opened * 31u + 7u);
+    }
+    if (opened < clientCount) fprintf(stderr, "Only %d of %d client sockets opened\n", opened, clientCount);
+
+    int ticks = (seconds > 0 ? seconds : 10) * SIM_TICKS_PER_SECOND;
+    double serverSeconds = 0.0;
+    for (int t = 0; t < ticks; t++) {
+        for (int c = 0; c < opened; c++) {
+            SimInput input = { SIM_DIR_NONE };
+            if (clients[c].worldReady) input = bot_random_walk(&bots[c], &clients[c].world);
+            net_client_tick(&clients[c], input);
+        }
+        auto tickStart = std::chrono::steady_clock::now();
+        net_server_tick(&server);
+        serverSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - tickStart).count();
+    }
+
+    double gameSeconds = (double)ticks / SIM_TICKS_PER_SECOND;
+    int active = net_server_sessions(&server);
+    double usPerSession = active ? serverSeconds * 1e6 / ticks / active : 0.0;
+    long long corrections = 0;
+    long long bytesIn = 0;
+    for (int c = 0; c < opened; c++) {
+        corrections += clients[c].stats.corrections;
+        bytesIn += clients[c].stats.bytesIn + clients[c].stats.packetsIn * NET_UDP_OVERHEAD;
+    }
+    printf("net bench: %d sessions, %d players, %.0f game seconds  snapshots: %lld (%lld full)\n", active, net_server_players(&server),
+        gameSeconds, server.stats.snapshots, server.stats.fullSnapshots);
+    printf("server: %.1f us per tick, %.2f us per session tick -> %.0f sessions per core at %d Hz\n", serverSeconds * 1e6 / ticks,
+        usPerSession, usPerSession > 0.0 ? 1e6 / SIM_TICKS_PER_SECOND / usPerSession : 0.0, SIM_TICKS_PER_SECOND);
+    printf("per client: in %.0f B/s, out %.0f B/s (with UDP/IP headers)  prediction corrections: %lld\n",
+        opened ? bytesIn / gameSeconds / opened : 0.0,
+        active ? (double)(server.stats.bytesIn + server.stats.packetsIn * NET_UDP_OVERHEAD) / gameSeconds / opened : 0.0, corrections);
+    if (opened > 0) print_client_stats(&clients[0], gameSeconds, "client 0");
+
+    for (int c = 0; c < opened; c++) net_client_free(&clients[c]);
+    net_server_free(&server);
+    net_shutdown();
+    return 0;
+}
+
+static int generate_levels(int width, int height, uint32_t seed, int count, const char* saveFile) { // Times maze_generate (which validates) over count seeds.
+    MazeMap level;
+    int failures = 0;
+    long long pellets = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        if (!maze_generate(&level, width, height, seed + (uint32_t)i)) {
+            failures++;
+            continue;
+        }
+        pellets += level.pelletCount;
+        if (i == 0 && saveFile && !maze_save(&level, saveFile)) {
+            fprintf(stderr, "Failed to write %s\n", saveFile);
+            failures++;
+        }
+        maze_unload(&level);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    printf("generated %d levels of %dx%d: %d failed, avg %.1f pellets, %.2f us per level\n", count, width, height, failures,
+        count > failures ? (double)pellets / (count - failures) : 0.0, seconds * 1e6 / count);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    long long totalTicks = 1000000;
+    Difficulty difficulty = NORMAL;
+    uint32_t seed = 1;
+    int batchGames = 0;
+    int threads = 0;
+    const char* recordFile = NULL;
+    std::vector<const char*> replayFiles;
+    int repeat = 1;
+    int swarmCount = 0;
+    bool swarmLethal = false;
+    const char* mazeFile = NULL;
+    const char* writeMazeFile = NULL;
+    int mazeTile = 1;
+    bool levels = false;
+    int step = 1;
+    int checkStep = 0;
+    int autopilotGames = 0;
+    int generateCount = 0;
+    const char* leaderboardFile = NULL;
+    int servePort = 0;
+    const char* connectTarget = NULL;
+    int netBenchSessions = 0;
+    int netSeconds = 0;
+    int netLoss = 0;
+    bool withEvents = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            totalTicks = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            if (!parse_difficulty(argv[++i], &difficulty)) {
+                fprintf(stderr, "Unknown difficulty: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchGames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFiles.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) repeat = 1;
+        } else if (strcmp(argv[i], "--swarm") == 0 && i + 1 < argc) {
+            swarmCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--swarm-lethal") == 0) {
+            swarmLethal = true;
+        } else if (strcmp(argv[i], "--maze") == 0 && i + 1 < argc) {
+            mazeFile = argv[++i];
+        } else if (strcmp(argv[i], "--maze-tile") == 0 && i + 1 < argc) {
+            mazeTile = atoi(argv[++i]);
+            if (mazeTile < 1) mazeTile = 1;
+        } else if (strcmp(argv[i], "--write-maze") == 0 && i + 1 < argc) {
+            writeMazeFile = argv[++i];
+        } else if (strcmp(argv[i], "--levels") == 0) {
+            levels = true;
+        } else if (strcmp(argv[i], "--leaderboard") == 0 && i + 1 < argc) {
+            leaderboardFile = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generateCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            step = atoi(argv[++i]);
+            if (step < 1) step = 1;
+        } else if (strcmp(argv[i], "--check-step") == 0 && i + 1 < argc) {
+            checkStep = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--autopilot") == 0 && i + 1 < argc) {
+            autopilotGames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            servePort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connectTarget = argv[++i];
+        } else if (strcmp(argv[i], "--net-bench") == 0 && i + 1 < argc) {
+            netBenchSessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--net-seconds") == 0 && i + 1 < argc) {
+            netSeconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--net-loss") == 0 && i + 1 < argc) {
+            netLoss = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--events") == 0) {
+            withEvents = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--ticks N] [--difficulty easy|normal|hard] [--seed S] [--batch N] [--threads T] "
+                "[--record FILE] [--replay FILE]... [--repeat N] [--swarm N] [--swarm-lethal] [--maze FILE] [--maze-tile N] [--write-maze FILE] [--levels] [--generate N] [--leaderboard FILE] [--step N] [--check-step N] [--autopilot N] "
+                "[--serve PORT] [--connect HOST:PORT] [--net-bench N] [--net-seconds S] [--net-loss P] [--events]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    MazeMap loadedMap;
+    MazeMap tiledMap;
+    memset(&loadedMap, 0, sizeof(loadedMap));
+    memset(&tiledMap, 0, sizeof(tiledMap));
+    const MazeMap* map = maze_builtin();
+
+    if (mazeFile) {
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!maze_load(&loadedMap, mazeFile)) {
+            fprintf(stderr, "Failed to load maze %s\n", mazeFile);
+            return 1;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        printf("maze %s: %dx%d, %d pellets, opened in %.3f ms\n", mazeFile, loadedMap.width, loadedMap.height, loadedMap.pelletCount, loadSeconds * 1000.0);
+        map = &loadedMap;
+    }
+    if (mazeTile > 1) {
+        if (!maze_tile(&tiledMap, map, mazeTile, mazeTile)) {
+            fprintf(stderr, "Failed to tile the maze %d x %d\n", mazeTile, mazeTile);
+            maze_unload(&loadedMap);
+            return 1;
+        }
+        map = &tiledMap;
+    }
+
+    int result = 0;
+    if (generateCount > 0) {
+        result = generate_levels(map->width, map->height, seed, generateCount, writeMazeFile);
+    } else if (writeMazeFile) {
+        if (maze_save(map, writeMazeFile)) {
+            printf("wrote %s: %dx%d, %d pellets\n", writeMazeFile, map->width, map->height, map->pelletCount);
+        } else {
+            fprintf(stderr, "Failed to write %s\n", writeMazeFile);
+            result = 1;
+        }
+    } else if (servePort > 0) {
+        result = run_server(map, difficulty, seed, servePort, netSeconds);
+    } else if (connectTarget) {
+        result = run_client(map, connectTarget, seed, netSeconds, netLoss);
+    } else if (netBenchSessions > 0) {
+        result = run_net_bench(map, difficulty, seed, NET_DEFAULT_PORT, netBenchSessions, netSeconds);
+    } else if (checkStep > 0) {
+        result = check_step(map, seed, batchGames > 0 ? batchGames : 64, checkStep, levels);
+    } else if (autopilotGames > 0) {
+        result = run_autopilot(map, difficulty, seed, autopilotGames, levels);
+    } else if (batchGames > 0) {
+        result = run_batch(map, batchGames, threads, seed, levels, step, leaderboardFile);
+    } else {
+        result = run_games(map, difficulty, seed, totalTicks, recordFile, replayFiles, repeat, swarmCount, swarmLethal, levels, step, leaderboardFile, withEvents);
+    }
+
+    maze_unload(&tiledMap);
+    maze_unload(&loadedMap);
+    return result;
+}
@@ -0,0 +1,485 @@
+#include "leaderboard.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const int LEADERBOARD_HEADER_SIZE = 16;
+static const int LEADERBOARD_RECORD_SIZE = 24;
+static const size_t LEADERBOARD_BUFFER_SIZE = 64 * 1024;
+
+static void put_u16(uint8_t* out, uint16_t value) { // Little-endian store.
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) { // Little-endian store.
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t get_u16(const uint8_t* in) { // Little-endian load.
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) { // Little-endian load.
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+    return value;
+}
+
+static uint32_t checksum(const uint8_t* data, int size) { // 32-bit FNV-1a.
+    uint32_t hash = 0x811C9DC5u;
+    for (int i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+static uint32_t board_rand(Leaderboard* board) { // xorshift32 for treap priorities.
+    uint32_t x = board->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    board->rng = x;
+    return x;
+}
+
+static void encode_record(uint8_t* out, Difficulty difficulty, const char* name, int score) { // Fills one 24-byte record, checksum included.
+    memset(out, 0, LEADERBOARD_RECORD_SIZE);
+    size_t length = strlen(name);
+    if (length > LEADERBOARD_NAME_LENGTH) length = LEADERBOARD_NAME_LENGTH;
+    out[4] = (uint8_t)difficulty;
+    out[5] = (uint8_t)length;
+    put_u32(out + 8, (uint32_t)score);
+    memcpy(out + 12, name, length);
+    put_u32(out, checksum(out + 4, LEADERBOARD_RECORD_SIZE - 4));
+}
+
+static bool decode_record(const uint8_t* in, Difficulty* difficulty, char* name, int* score) { // Checks and unpacks one record.
+    if (get_u32(in) != checksum(in + 4, LEADERBOARD_RECORD_SIZE - 4)) return false;
+    if (in[4] >= DIFFICULTY_COUNT || in[5] > LEADERBOARD_NAME_LENGTH || get_u16(in + 6) != 0) return false;
+    *difficulty = (Difficulty)in[4];
+    *score = (int)get_u32(in + 8);
+    memcpy(name, in + 12, in[5]);
+    name[in[5]] = '\0';
+    return true;
+}
+
+static int node_size(const Leaderboard* board, int node) { // Subtree size, 0 for an empty link.
+    return node < 0 ? 0 : board->nodes[node].size;
+}
+
+static void update(Leaderboard* board, int node) { // Recomputes a node's size from its children.
+    board->nodes[node].size = 1 + node_size(board, board->nodes[node].left) + node_size(board, board->nodes[node].right);
+}
+
+static int new_node(Leaderboard* board, const char* name, int score) { // Takes a node from the pool, growing it by doubling.
+    if (board->nodeCount == board->nodeCapacity) {
+        int capacity = board->nodeCapacity ? board->nodeCapacity * 2 : 256;
+        LeaderboardNode* nodes = (LeaderboardNode*)realloc(board->nodes, (size_t)capacity * sizeof(LeaderboardNode));
+        if (!nodes) return -1;
+        board->nodes = nodes;
+        board->nodeCapacity = capacity;
+    }
+
+    int index = board->nodeCount++;
+    LeaderboardNode* node = &board->nodes[index];
+    node->score = score;
+    node->left = -1;
+    node->right = -1;
+    node->size = 1;
+    node->priority = board_rand(board);
+    strncpy(node->name, name, LEADERBOARD_NAME_LENGTH);
+    node->name[LEADERBOARD_NAME_LENGTH] = '\0';
+    return index;
+}
+
+static void split(Leaderboard* board, int node, int score, int* before, int* after) { // Nodes scoring >= score go before, lower ones after.
+    if (node < 0) {
+        *before = -1;
+        *after = -1;
+        return;
+    }
+    LeaderboardNode* n = &board->nodes[node];
+    if (n->score >= score) {
+        split(board, n->right, score, &n->right, after);
+        *before = node;
+    } else {
+        split(board, n->left, score, before, &n->left);
+        *after = node;
+    }
+    update(board, node);
+}
+
+static int merge(Leaderboard* board, int before, int after) { // Joins two trees where every node of `before` ranks first.
+    if (before < 0) return after;
+    if (after < 0) return before;
+    if (board->nodes[before].priority > board->nodes[after].priority) {
+        board->nodes[before].right = merge(board, board->nodes[before].right, after);
+        update(board, before);
+        return before;
+    }
+    board->nodes[after].left = merge(board, before, board->nodes[after].left);
+    update(board, after);
+    return after;
+}
+
+static int insert_node(Leaderboard* board, Difficulty difficulty, const char* name, int score) { // Tree insert only; returns the rank or 0.
+    int node = new_node(board, name, score);
+    if (node < 0) return 0;
+
+    int before;
+    int after;
+    split(board, board->root[difficulty], score, &before, &after);
+    int rank = node_size(board, before) + 1;
+    board->root[difficulty] = merge(board, merge(board, before, node), after);
+    return rank;
+}
+
+static int fix_sizes(Leaderboard* board, int node) { // Post-order size pass over a freshly built tree.
+    if (node < 0) return 0;
+    LeaderboardNode* n = &board->nodes[node];
+    n->size = 1 + fix_sizes(board, n->left) + fix_sizes(board, n->right);
+    return n->size;
+}
+
+// Builds a treap from nodes that arrive already in rank order, in linear time: the right spine is kept on a
+// stack and each new node adopts the popped run of lower-priority nodes as its left subtree.
+typedef struct SpineBuilder {
+    int* stack;
+    int top;
+    int difficulty; // Tree being built, -1 before the first node
+} SpineBuilder;
+
+static void spine_finish(Leaderboard* board, SpineBuilder* builder) { // Hangs the built tree under its root.
+    if (builder->difficulty >= 0 && builder->top > 0) {
+        board->root[builder->difficulty] = builder->stack[0];
+        fix_sizes(board, builder->stack[0]);
+    }
+    builder->top = 0;
+    builder->difficulty = -1;
+}
+
+static void spine_append(Leaderboard* board, SpineBuilder* builder, int node) { // Adds the next node in rank order.
+    int last = -1;
+    while (builder->top > 0 && board->nodes[builder->stack[builder->top - 1]].priority < board->nodes[node].priority) {
+        last = builder->stack[--builder->top];
+    }
+    board->nodes[node].left = last;
+    if (builder->top > 0) board->nodes[builder->stack[builder->top - 1]].right = node;
+    builder->stack[builder->top++] = node;
+}
+
+static void load_records(Leaderboard* board, const uint8_t* data, size_t size) { // Replays the snapshot and journal records of a loaded file.
+    uint32_t snapshotRecords = get_u32(data + 8);
+    size_t recordCount = (size - LEADERBOARD_HEADER_SIZE) / LEADERBOARD_RECORD_SIZE;
+    if ((size - LEADERBOARD_HEADER_SIZE) % LEADERBOARD_RECORD_SIZE != 0 || snapshotRecords > recordCount) board->needsCompaction = true;
+
+    // One allocation up front instead of a doubling copy per power of two.
+    if (recordCount > 0) {
+        LeaderboardNode* nodes = (LeaderboardNode*)malloc(recordCount * sizeof(LeaderboardNode));
+        if (nodes) {
+            board->nodes = nodes;
+            board->nodeCapacity = (int)recordCount;
+        }
+    }
+
+    SpineBuilder builder;
+    builder.stack = (int*)malloc(((size_t)(snapshotRecords < recordCount ? snapshotRecords : recordCount) + 1) * sizeof(int));
+    builder.top = 0;
+    builder.difficulty = -1;
+    bool building = builder.stack != NULL;
+    int previousScore = 0;
+
+    const uint8_t* record = data + LEADERBOARD_HEADER_SIZE;
+    for (size_t i = 0; i < recordCount; i++, record += LEADERBOARD_RECORD_SIZE) {
+        Difficulty difficulty;
+        char name[LEADERBOARD_NAME_LENGTH + 1];
+        int score;
+        if (!decode_record(record, &difficulty, name, &score)) {
+            // Records are fixed-size frames with their own checksums, so a damaged one costs only itself.
+            board->corruptRecords++;
+            board->needsCompaction = true;
+            continue;
+        }
+
+        if (i < snapshotRecords) {
+            // The snapshot is written grouped by difficulty in rank order; anything else is loaded the slow way.
+            bool inOrder = building && ((int)difficulty > builder.difficulty || ((int)difficulty == builder.difficulty && score <= previousScore));
+            if (building && inOrder && board->root[difficulty] < 0) {
+                if ((int)difficulty != builder.difficulty) {
+                    spine_finish(board, &builder);
+                    builder.difficulty = difficulty;
+                }
+                int node = new_node(board, name, score);
+                if (node < 0) {
+                    board->keepFile = true;
+                    break;
+                }
+                spine_append(board, &builder, node);
+                previousScore = score;
+                board->snapshotCount++;
+                continue;
+            }
+            if (building) {
+                spine_finish(board, &builder);
+                building = false;
+                board->needsCompaction = true;
+            }
+            if (!insert_node(board, difficulty, name, score)) {
+                board->keepFile = true;
+                break;
+            }
+            board->snapshotCount++;
+        } else {
+            if (building) {
+                spine_finish(board, &builder);
+                building = false;
+            }
+            if (!insert_node(board, difficulty, name, score)) {
+                board->keepFile = true;
+                break;
+            }
+            board->journalCount++;
+        }
+    }
+    if (building) spine_finish(board, &builder);
+    free(builder.stack);
+}
+
+static bool sync_file(FILE* file) { // Forces a flushed stream's data to disk.
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static bool replace_file(const char* from, const char* to) { // Atomically moves a finished file over the live one.
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+static bool write_backup(const char* fileName, const uint8_t* data, size_t size) { // Saves the file as loaded to "<fileName>.bad".
+    char* backupName = (char*)malloc(strlen(fileName) + 5);
+    FILE* out = backupName ? fopen(strcat(strcpy(backupName, fileName), ".bad"), "wb") : NULL;
+    bool ok = out && fwrite(data, 1, size, out) == size && fflush(out) == 0 && sync_file(out);
+    if (out && fclose(out) != 0) ok = false;
+    if (ok) fprintf(stderr, "%s: original kept as %s\n", fileName, backupName);
+    free(backupName);
+    return ok;
+}
+
+static bool read_file(Leaderboard* board, const char* fileName, bool* exists) { // Loads a whole board file with one sequential read.
+    *exists = false;
+    FILE* file = fopen(fileName, "rb");
+    if (!file) return true; // Missing file: an empty board
+
+    *exists = true;
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (end < LEADERBOARD_HEADER_SIZE) {
+        fclose(file);
+        // An empty or cut-short header can only be a file that was never written past its creation.
+        board->needsCompaction = true;
+        return end >= 0;
+    }
+
+    uint8_t* data = (uint8_t*)malloc((size_t)end);
+    bool ok = data && fread(data, 1, (size_t)end, file) == (size_t)end;
+    fclose(file);
+
+    ok = ok && memcmp(data, LEADERBOARD_MAGIC, 4) == 0 && get_u16(data + 4) == LEADERBOARD_VERSION &&
+         get_u16(data + 6) == LEADERBOARD_RECORD_SIZE;
+    if (ok) load_records(board, data, (size_t)end);
+    if (ok && board->corruptRecords > 0) {
+        fprintf(stderr, "%s: %d corrupt records skipped\n", fileName, board->corruptRecords);
+        // The compaction that drops them only runs once the original is kept aside.
+        if (!write_backup(fileName, data, (size_t)end)) board->keepFile = true;
+    }
+    free(data);
+    return ok;
+}
+
+static void reset_board(Leaderboard* board) { // Empty trees, no file.
+    memset(board, 0, sizeof(*board));
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) board->root[d] = -1;
+    board->rng = 0x2545F491u;
+}
+
+bool leaderboard_open(Leaderboard* board, const char* fileName) { // Loads the board file, compacting it if due, and opens the journal.
+    reset_board(board);
+    if (!fileName) return true;
+
+    bool exists;
+    if (!read_file(board, fileName, &exists)) {
+        // Not a board file we understand: keep it untouched and run in memory only.
+        free(board->nodes);
+        reset_board(board);
+        return false;
+    }
+
+    board->fileName = (char*)malloc(strlen(fileName) + 1);
+    if (!board->fileName) return false;
+    strcpy(board->fileName, fileName);
+
+    bool due = board->journalCount > LEADERBOARD_COMPACT_MIN && board->journalCount > board->snapshotCount;
+    if (!exists || board->needsCompaction || due) {
+        // Compacting a torn file is what cuts the bad tail off, so appending is only safe once it succeeds;
+        // a file that must be kept as it is leaves the board in memory only.
+        if (!leaderboard_compact(board) && board->needsCompaction) {
+            if (board->journal) fclose(board->journal);
+            board->journal = NULL;
+            return false;
+        }
+    }
+    if (!board->journal) {
+        board->journal = fopen(board->fileName, "ab");
+        if (board->journal) setvbuf(board->journal, NULL, _IOFBF, LEADERBOARD_BUFFER_SIZE);
+    }
+    return board->journal != NULL;
+}
+
+void leaderboard_close(Leaderboard* board) { // Compacts a long journal, syncs and releases everything.
+    if (board->journal) {
+        if (board->journalCount > LEADERBOARD_COMPACT_MIN && board->journalCount > board->snapshotCount) leaderboard_compact(board);
+        leaderboard_flush(board, true);
+        fclose(board->journal);
+    }
+    free(board->nodes);
+    free(board->fileName);
+    memset(board, 0, sizeof(*board));
+}
+
+int leaderboard_insert(Leaderboard* board, Difficulty difficulty, const char* name, int score) { // Tree insert plus one buffered journal record.
+    int rank = insert_node(board, difficulty, name, score);
+    if (rank && board->journal) {
+        uint8_t record[LEADERBOARD_RECORD_SIZE];
+        encode_record(record, difficulty, name, score);
+        fwrite(record, 1, sizeof(record), board->journal);
+        board->journalCount++;
+    }
+    return rank;
+}
+
+int leaderboard_rank(const Leaderboard* board, Difficulty difficulty, int score) { // Counts the stored scores >= score on one root-to-leaf walk.
+    int better = 0;
+    int node = board->root[difficulty];
+    while (node >= 0) {
+        const LeaderboardNode* n = &board->nodes[node];
+        if (n->score >= score) {
+            better += node_size(board, n->left) + 1;
+            node = n->right;
+        } else {
+            node = n->left;
+        }
+    }
+    return better + 1;
+}
+
+int leaderboard_count(const Leaderboard* board, Difficulty difficulty) { // Entries stored for a difficulty.
+    return node_size(board, board->root[difficulty]);
+}
+
+bool leaderboard_entry(const Leaderboard* board, Difficulty difficulty, int rank, LeaderboardEntry* entry) { // Order-statistic lookup by subtree sizes.
+    int node = board->root[difficulty];
+    if (rank < 1 || rank > node_size(board, node)) return false;
+
+    while (node >= 0) {
+        const LeaderboardNode* n = &board->nodes[node];
+        int leftSize = node_size(board, n->left);
+        if (rank <= leftSize) {
+            node = n->left;
+        } else if (rank == leftSize + 1) {
+            memcpy(entry->name, n->name, sizeof(entry->name));
+            entry->score = n->score;
+            return true;
+        } else {
+            rank -= leftSize + 1;
+            node = n->right;
+        }
+    }
+    return false;
+}
+
+bool leaderboard_flush(Leaderboard* board, bool sync) { // fflush, plus fsync when asked.
+    if (!board->journal) return false;
+    if (fflush(board->journal) != 0) return false;
+    return !sync || sync_file(board->journal);
+}
+
+bool leaderboard_compact(Leaderboard* board) { // Writes every tree in rank order to a temporary file and swaps it in.
+    // A snapshot of a partly loaded board would silently drop the records it never read.
+    if (!board->fileName || board->keepFile) return false;
+
+    size_t nameLength = strlen(board->fileName);
+    char* tempName = (char*)malloc(nameLength + 5);
+    int* stack = (int*)malloc(((size_t)board->nodeCount + 1) * sizeof(int));
+    FILE* out = tempName ? fopen(strcat(strcpy(tempName, board->fileName), ".tmp"), "wb") : NULL;
+    if (!tempName || !stack || !out) {
+        if (out) fclose(out);
+        free(tempName);
+        free(stack);
+        return false;
+    }
+    setvbuf(out, NULL, _IOFBF, LEADERBOARD_BUFFER_SIZE);
+
+    uint8_t header[LEADERBOARD_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, LEADERBOARD_MAGIC, 4);
+    put_u16(header + 4, LEADERBOARD_VERSION);
+    put_u16(header + 6, LEADERBOARD_RECORD_SIZE);
+    put_u32(header + 8, (uint32_t)board->nodeCount);
+    fwrite(header, 1, sizeof(header), out);
+
+    // Iterative in-order walk per difficulty, so the snapshot reloads with the linear-time builder.
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        int top = 0;
+        int node = board->root[d];
+        while (node >= 0 || top > 0) {
+            while (node >= 0) {
+                stack[top++] = node;
+                node = board->nodes[node].left;
+            }
+            node = stack[--top];
+            uint8_t record[LEADERBOARD_RECORD_SIZE];
+            encode_record(record, (Difficulty)d, board->nodes[node].name, board->nodes[node].score);
+            fwrite(record, 1, sizeof(record), out);
+            node = board->nodes[node].right;
+        }
+    }
+    free(stack);
+
+    bool ok = fflush(out) == 0 && !ferror(out) && sync_file(out);
+    if (fclose(out) != 0) ok = false;
+
+    // The journal handle must be closed before the rename on Windows, and points at the old file elsewhere.
+    if (board->journal) {
+        fflush(board->journal);
+        fclose(board->journal);
+        board->journal = NULL;
+    }
+    if (ok) ok = replace_file(tempName, board->fileName);
+    if (!ok) remove(tempName);
+    free(tempName);
+
+    if (ok) {
+        board->snapshotCount = board->nodeCount;
+        board->journalCount = 0;
+        board->needsCompaction = false;
+    }
+    board->journal = fopen(board->fileName, "ab");
+    if (board->journal) setvbuf(board->journal, NULL, _IOFBF, LEADERBOARD_BUFFER_SIZE);
+    return ok;
+}
@@ -0,0 +1,80 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stdio.h>
+#include "sim.h"
+
+// Persistent leaderboard.
+// Every score ever entered is kept, one order-statistic treap per difficulty (scores descending, ties in
+// entry order), so inserting a score, asking which rank a score would get and reading the entry at a rank
+// are all O(log n) however many runs are stored.
+//
+// On disk the board is one file: a header, a snapshot section holding every difficulty's entries in rank
+// order, then a journal of entries appended since. Each record carries an FNV-1a checksum, so a write torn
+// by a crash is detected and dropped on the next load; a damaged record elsewhere is skipped on its own, and
+// the file is copied to "<file>.bad" before the compaction that drops it. Loading is one sequential read; the snapshot builds
+// its treaps in linear time and only the journal is inserted one by one. When the journal outgrows the
+// snapshot, leaderboard_open/leaderboard_close compact the file: a fresh snapshot goes to a temporary file
+// that then replaces the old one, so a crash at any point leaves either the old or the new file intact.
+// Inserts never compact, so entering a name costs one tree insert and one buffered 24-byte write;
+// leaderboard_flush then hands the record to the OS.
+//
+// File layout (little-endian): "PMLB", u16 version, u16 record size, u32 snapshot records, u32 zero,
+// then 24-byte records: u32 checksum of the next 20 bytes, u8 difficulty, u8 name length, u16 zero,
+// i32 score, 12 name bytes (zero padded).
+
+#define LEADERBOARD_MAGIC "PMLB"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_NAME_LENGTH 12
+#define LEADERBOARD_COMPACT_MIN 4096 // Journals shorter than this are never worth compacting
+
+typedef struct LeaderboardEntry {
+    char name[LEADERBOARD_NAME_LENGTH + 1];
+    int score;
+} LeaderboardEntry;
+
+typedef struct LeaderboardNode {
+    int score;
+    int left;           // Node indices, -1 for none
+    int right;
+    int size;           // Nodes in this subtree
+    uint32_t priority;  // Max-heap order keeps the tree balanced in expectation
+    char name[LEADERBOARD_NAME_LENGTH + 1];
+} LeaderboardNode;
+
+typedef struct Leaderboard {
+    LeaderboardNode* nodes; // One pool shared by every difficulty's tree
+    int nodeCount;
+    int nodeCapacity;
+    int root[DIFFICULTY_COUNT];
+    uint32_t rng;
+    char* fileName;         // NULL for a board that is never saved
+    FILE* journal;          // Append handle, NULL when the file couldn't be opened
+    int snapshotCount;      // Records in the file's snapshot section
+    int journalCount;       // Records appended after it
+    bool needsCompaction;   // Set when the loaded file had a torn tail or corrupt records
+    int corruptRecords;     // Records that failed their checksum on load and were skipped
+    bool keepFile;          // The file holds records the trees don't (out of memory, no backup): never compacted over
+} Leaderboard;
+
+// Loads fileName (a missing file is an empty board) and opens it for appending. fileName may be NULL for
+// an in-memory board. Returns false if the file can't be read or written; the board still works in memory.
+bool leaderboard_open(Leaderboard* board, const char* fileName);
+// Compacts if due, then closes the file and frees the trees.
+void leaderboard_close(Leaderboard* board);
+
+// Adds a score and journals it; returns its rank (1 is best), or 0 when out of memory.
+int leaderboard_insert(Leaderboard* board, Difficulty difficulty, const char* name, int score);
+// Rank a new score would take: it goes after every stored score that is greater or equal.
+int leaderboard_rank(const Leaderboard* board, Difficulty difficulty, int score);
+int leaderboard_count(const Leaderboard* board, Difficulty difficulty);
+// Reads the entry at a 1-based rank; false when the rank is out of range.
+bool leaderboard_entry(const Leaderboard* board, Difficulty difficulty, int rank, LeaderboardEntry* entry);
+
+// Pushes buffered journal records to the OS, which is enough to survive the process dying; with sync
+// they are also forced to disk.
+bool leaderboard_flush(Leaderboard* board, bool sync);
+// Rewrites the file as a single snapshot with an empty journal; refused while keepFile is set.
+bool leaderboard_compact(Leaderboard* board);
+
+#endif
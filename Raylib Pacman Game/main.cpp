@@ -1,4 +1,16 @@
 #include "raylib.h"
+#include "sim.h"
+#include "render.h"
+#include "profiler.h"
+#include "replay.h"
+#include "swarm.h"
+#include "leaderboard.h"
+#include "audio.h"
+#include "ui.h"
+#include "bot.h"
+#include "rewind.h"
+#include "events.h"
+#include "assets.h"
 #include <stdbool.h>
 #include <math.h>
 #include <time.h>
@@ -6,110 +18,63 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-const int screenWidth = 1600;
-const int screenHeight = 900;
-
-const int MAZE_WIDTH = 25;
-const int MAZE_HEIGHT = 15;
-
-const int TILE_SIZE = screenHeight / MAZE_HEIGHT;
-
-const int MAZE_DRAW_OFFSET_X = (screenWidth - MAZE_WIDTH * TILE_SIZE) / 2;
-const int MAZE_DRAW_OFFSET_Y = 0;
-
-int maze[MAZE_HEIGHT][MAZE_WIDTH] = {
-    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
-    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
-    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
-    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
-    {1, 2, 1, 1, 1, 2, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 2, 1, 1, 1, 2, 1},
-    {1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1},
-    {1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1},
-    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
-    {1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1},
-    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
-    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
-    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
-    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
-    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
-};
-
-int initialMaze[MAZE_HEIGHT][MAZE_WIDTH];
-
-typedef struct Pacman {
-    Vector2 position;
-    float speed;
-    Vector2 direction;
-    float radius;
-    Texture2D textureOpen;
-    Texture2D textureClosed;
-    int frameCounter;
-    int framesSpeed;
-    bool mouthOpen;
-} Pacman;
+// Screens are designed for 1600x900 and drawn in layout pixels (see FrameTarget): the window shows at least the
+// design size and any extra room on one axis goes to wider or taller screens. screenWidth and screenHeight
+// are the current layout size and change with the window.
+const int designWidth = 1600;
+const int designHeight = 900;
+int screenWidth = designWidth;
+int screenHeight = designHeight;
+
+const int TILE_SIZE = 60; // The builtin maze's 15 rows fill the 900 px design height
+
+// The maze is drawn in world space (one tile = TILE_SIZE pixels from the maze's top-left corner) through a
+// camera that follows Pac-Man. Mazes that fit the screen are centred instead, exactly as before.
+// World pixels are layout pixels; FrameTargetCamera takes both down to the resolution being rendered.
+// The simulation counts in fixed-point maze units; this is the only place they become pixels.
+Vector2 sim_to_world(float x, float y) { // Maps a maze-space simulation position to world pixels.
+    float scale = (float)TILE_SIZE / SIM_TILE_SIZE;
+    return (Vector2){ x * scale, y * scale };
+}
 
-typedef enum {
-    BLINKY,
-    PINKY,
-    INKY,
-    CLYDE
-} GhostType;
-
-typedef struct Ghost {
-    Vector2 position;
-    float speed;
-    Vector2 direction;
-    float radius;
-    Color color;
-    GhostType type;
-    Texture2D texture;
-} Ghost;
-
-#define MAX_GHOSTS 4
+float CameraAxisTarget(float focus, int mazePixels, int screenPixels) { // Keeps the camera inside the maze on one axis, or centres mazes that fit.
+    if (mazePixels <= screenPixels) return mazePixels / 2.0f;
+    float half = screenPixels / 2.0f;
+    if (focus < half) return half;
+    if (focus > mazePixels - half) return mazePixels - half;
+    return focus;
+}
 
-typedef enum {
-    EASY,
-    NORMAL,
-    HARD
-} Difficulty;
+Camera2D FollowCamera(const MazeMap* map, Vector2 focus) { // Camera centred on focus, clamped to the maze.
+    Camera2D camera = { 0 };
+    camera.offset = (Vector2){ screenWidth / 2.0f, screenHeight / 2.0f };
+    camera.target = (Vector2){
+        CameraAxisTarget(focus.x, map->width * TILE_SIZE, screenWidth),
+        CameraAxisTarget(focus.y, map->height * TILE_SIZE, screenHeight)
+    };
+    camera.zoom = 1.0f;
+    return camera;
+}
 
-#define MAX_HIGHSCORES 3
-#define MAX_NAME_LENGTH 12
+bool InView(Rectangle view, Vector2 position) { // True when a sprite centred on position may overlap the view.
+    return position.x > view.x - TILE_SIZE && position.x < view.x + view.width + TILE_SIZE &&
+           position.y > view.y - TILE_SIZE && position.y < view.y + view.height + TILE_SIZE;
+}
 
-typedef struct {
-    char name[MAX_NAME_LENGTH + 1];
-    int score;
-} HighScore;
+#define MAX_HIGHSCORES 10 // Ranks shown in the high score menu; a score that would reach one asks for a name
+#define MAX_NAME_LENGTH LEADERBOARD_NAME_LENGTH
 
-HighScore highScoresEasy[MAX_HIGHSCORES] = { {"", 0}, {"", 0}, {"", 0} };
-HighScore highScoresNormal[MAX_HIGHSCORES] = { {"", 0}, {"", 0}, {"", 0} };
-HighScore highScoresHard[MAX_HIGHSCORES] = { {"", 0}, {"", 0}, {"", 0} };
+// Every named score is kept in LEADERBOARD_FILE, which survives restarts and crashes.
+const char* LEADERBOARD_FILE = "leaderboard.pmlb";
+Leaderboard leaderboard;
 
-HighScore* GetHighScoreTable(Difficulty diff) { // Returns a pointer to the high score table for the given difficulty.
-    if (diff == EASY) return highScoresEasy;
-    if (diff == NORMAL) return highScoresNormal;
-    return highScoresHard;
+void InsertHighScore(const char* name, int score, Difficulty diff) { // Stores a named score and hands it to the OS right away.
+    leaderboard_insert(&leaderboard, diff, name, score);
+    leaderboard_flush(&leaderboard, false);
 }
 
-void InsertHighScore(const char* name, int score, Difficulty diff) { // Inserts a new high score into the appropriate high score table, maintaining sorted order.
-    HighScore* table = GetHighScoreTable(diff);
-    for (int i = 0; i < MAX_HIGHSCORES; i++) {
-        if (score > table[i].score) {
-            for (int j = MAX_HIGHSCORES - 1; j > i; j--) {
-                table[j] = table[j - 1];
-            }
-            strncpy(table[i].name, name, MAX_NAME_LENGTH);
-            table[i].name[MAX_NAME_LENGTH] = '\0';
-            table[i].score = score;
-            break;
-        }
-    }
-}
-
-bool IsHighScore(int score, Difficulty diff) { // Checks if a given score qualifies as a high score for the selected difficulty.
-    HighScore* table = GetHighScoreTable(diff);
-    return score > table[MAX_HIGHSCORES - 1].score;
+bool IsHighScore(int score, Difficulty diff) { // Checks if a given score would make the shown part of the leaderboard.
+    return score > 0 && leaderboard_rank(&leaderboard, diff, score) <= MAX_HIGHSCORES;
 }
 
 typedef enum {
@@ -118,222 +83,558 @@ typedef enum {
     GAME_OVER,
     ENTER_NAME,
     WIN_SCREEN,
-    HIGHSCORE_MENU
+    HIGHSCORE_MENU,
+    REWIND
 } GameState;
 
-bool AllPelletsEaten() { // Checks if all pellets in the maze have been eaten.
-    for (int y = 0; y < MAZE_HEIGHT; y++) {
-        for (int x = 0; x < MAZE_WIDTH; x++) {
-            if (maze[y][x] == 2) return false;
-        }
+char playerName[MAX_NAME_LENGTH + 1] = "";
+int nameLength = 0;
+
+float winScreenTimer = 0.0f;
+const float WIN_SCREEN_DURATION = 2.5f;
+
+// The simulation always advances in fixed ticks; rendering runs at whatever rate the display allows
+// and interpolates between the last two ticks.
+const float SIM_TICK_TIME = 1.0f / SIM_TICKS_PER_SECOND;
+const float MAX_FRAME_TIME = 0.25f;      // Longer stalls are dropped instead of replayed in a burst
+const int FAST_FORWARD_SPEED = 8;        // Tick rate multiplier while [TAB] is held
+float simAccumulator = 0.0f;
+
+SimInput ReadGameplayInput(bool includeTaps) { // Arrow keys are held directions; WASD taps count once, on the first tick after the press.
+    SimInput input = { SIM_DIR_NONE };
+
+    if (IsKeyDown(KEY_RIGHT) || (includeTaps && IsKeyPressed(KEY_D))) {
+        input.direction = SIM_DIR_RIGHT;
+    } else if (IsKeyDown(KEY_LEFT) || (includeTaps && IsKeyPressed(KEY_A))) {
+        input.direction = SIM_DIR_LEFT;
+    } else if (IsKeyDown(KEY_UP) || (includeTaps && IsKeyPressed(KEY_W))) {
+        input.direction = SIM_DIR_UP;
+    } else if (IsKeyDown(KEY_DOWN) || (includeTaps && IsKeyPressed(KEY_S))) {
+        input.direction = SIM_DIR_DOWN;
     }
-    return true;
+
+    return input;
 }
 
-bool is_wall_tile(int tileX, int tileY) { // Checks if a given tile coordinate corresponds to a wall.
-    if (tileX < 0 || tileX >= MAZE_WIDTH || tileY < 0 || tileY >= MAZE_HEIGHT) {
-        return true;
-    }
-    return maze[tileY][tileX] == 1;
+Vector2 lerp_sim_position(SimVec2 previous, SimVec2 current, float alpha) { // Interpolates an entity between two ticks and maps it to the screen.
+    return sim_to_world(previous.x + (current.x - previous.x) * alpha, previous.y + (current.y - previous.y) * alpha);
 }
 
-bool check_wall_collision(Vector2 position, Vector2 direction, float radius) { // Checks for collision between a circular entity (Pacman or ghost) and maze walls.
-    Vector2 mazeRelativePos = { position.x - MAZE_DRAW_OFFSET_X, position.y - MAZE_DRAW_OFFSET_Y };
+Swarm* stressSwarm = NULL; // Set by --swarm N; every game then runs with the stress swarm attached
+Rewind* gameRewind = NULL;  // History of the current level, NULL when rewinding is unavailable
+EventBus* gameEvents = NULL; // Gameplay events of the current game, NULL when the bus couldn't be allocated
 
-    Vector2 testPos = {
-        mazeRelativePos.x + direction.x * (radius * 0.8f),
-        mazeRelativePos.y + direction.y * (radius * 0.8f)
-    };
+const int REWIND_SCRUB_TICKS = 2; // Ticks moved per frame while a scrub key is held
+
+void StartGame(SimState* sim, SimState* previousSim, const MazeMap* map, Difficulty difficulty, uint32_t seed, NavCache* nav) { // Resets the simulation and the interpolation history together.
+    sim_free(sim);
+    if (!sim_init(sim, map, difficulty, seed, nav)) {
+        TraceLog(LOG_ERROR, "Failed to start a game on a %dx%d maze", map->width, map->height);
+    }
+    if (stressSwarm) {
+        swarm_reset(stressSwarm, sim, seed ^ 0xA5A5A5A5u);
+        sim->swarm = stressSwarm;
+    }
+    if (gameRewind) rewind_reset(gameRewind, sim);
+    if (gameEvents) {
+        event_bus_clear(gameEvents);
+        sim->events = &gameEvents->buffer;
+    }
+    *previousSim = *sim;
+    simAccumulator = 0.0f;
+}
 
-    int tileX = (int)(testPos.x / TILE_SIZE);
-    int tileY = (int)(testPos.y / TILE_SIZE);
+// Every game is recorded to LAST_REPLAY_FILE so a reported death can be replayed with --replay.
+const char* LAST_REPLAY_FILE = "last_game.pmr";
 
-    return is_wall_tile(tileX, tileY);
+void StartRecordedGame(SimState* sim, SimState* previousSim, const MazeMap* map, Difficulty difficulty, NavCache* nav, ReplayWriter* recorder) { // Starts a fresh game on a new seed and begins recording it.
+    uint32_t seed = (uint32_t)rand();
+    if (recorder->file) replay_writer_close(recorder, sim);
+    StartGame(sim, previousSim, map, difficulty, seed, nav);
+    if (!replay_writer_open(recorder, LAST_REPLAY_FILE, difficulty, seed)) {
+        TraceLog(LOG_WARNING, "Failed to open %s for recording", LAST_REPLAY_FILE);
+    }
 }
 
-bool is_centered_in_tile(Vector2 position) { // Checks if an entity's position is approximately centered within a maze tile.
-    Vector2 mazeRelativePos = { position.x - MAZE_DRAW_OFFSET_X, position.y - MAZE_DRAW_OFFSET_Y };
+bool showSettingsMenu = false;
+float soundVolume = 1.0f;
+float musicVolume = 1.0f;
+bool soundEnabled = true;
+bool musicEnabled = true;
 
-    float tileCenterX = (int)(mazeRelativePos.x / TILE_SIZE) * TILE_SIZE + TILE_SIZE / 2.0f;
-    float tileCenterY = (int)(mazeRelativePos.y / TILE_SIZE) * TILE_SIZE + TILE_SIZE / 2.0f;
-    float tolerance = 2.0f;
+const char* DifficultyName(Difficulty difficulty) { // Upper-case label used by the menus.
+    return (difficulty == EASY) ? "EASY" : (difficulty == NORMAL) ? "NORMAL" : "HARD";
+}
 
-    return fabsf(mazeRelativePos.x - tileCenterX) < tolerance && fabsf(mazeRelativePos.y - tileCenterY) < tolerance;
+// Every menu and the HUD are retained screens: BuildGameScreens lays out the static text once, the
+// Refresh functions below only touch the elements whose values changed, and the render pass draws the
+// current screen exactly once per frame.
+typedef struct GameScreens {
+    UiScreen start;
+    int startDifficulty[DIFFICULTY_COUNT];
+
+    UiScreen settings;
+    int soundVolumeText;
+    int soundEnabledText;
+    int musicVolumeText;
+    int musicEnabledText;
+
+    UiScreen highScores;
+    int highScoreTitle;
+    int highScoreRows[MAX_HIGHSCORES];
+
+    UiScreen gameOver;
+    int gameOverScore;
+    int gameOverHint;
+    int gameOverRank;
+    int gameOverNewHighScore;
+    int gameOverRewindHint;
+
+    UiScreen enterName;
+    int enterNameField;
+
+    UiScreen win;
+    int winTitle;
+    int winNext;
+
+    UiScreen rewind;
+    int rewindTime;
+
+    UiScreen hud;
+    int hudScore;
+    int hudFast;
+    int hudSwarm;
+    int hudAutopilot;
+} GameScreens;
+
+void BuildGameScreens(GameScreens* screens) { // Lays out every screen's fixed text; values are filled in by the Refresh functions.
+    int centerX = screenWidth / 2;
+    int centerY = screenHeight / 2;
+
+    UiScreen* start = &screens->start;
+    ClearUiScreen(start);
+    AddUiText(start, "PAC-MAN", centerX, 40, 60, YELLOW, UI_ALIGN_CENTER);
+    AddUiText(start, "Select Difficulty:", centerX, 120, 30, WHITE, UI_ALIGN_CENTER);
+    screens->startDifficulty[EASY] = AddUiText(start, "E - Easy (2 Ghosts)", centerX, 160, 20, GRAY, UI_ALIGN_CENTER);
+    screens->startDifficulty[NORMAL] = AddUiText(start, "N - Normal (3 Ghosts)", centerX, 190, 20, GRAY, UI_ALIGN_CENTER);
+    screens->startDifficulty[HARD] = AddUiText(start, "H - Hard (4 Ghosts)", centerX, 220, 20, GRAY, UI_ALIGN_CENTER);
+    AddUiText(start, "Press [SPACE] to Start", centerX, 280, 30, WHITE, UI_ALIGN_CENTER);
+    AddUiText(start, "Use Arrow Keys to Move", centerX, 320, 20, GRAY, UI_ALIGN_CENTER);
+    AddUiText(start, "Press [S] for Settings", centerX, 350, 20, ORANGE, UI_ALIGN_CENTER);
+    AddUiText(start, "Press [B] for High Scores", centerX, 380, 20, ORANGE, UI_ALIGN_CENTER);
+
+    UiScreen* settings = &screens->settings;
+    int boxWidth = (int)(440 * 1.2f);
+    int boxHeight = (int)(240 * 1.2f);
+    int boxX = centerX - boxWidth/2;
+    int boxY = 100;
+    ClearUiScreen(settings);
+    AddUiPanel(settings, (Rectangle){ (float)boxX, (float)boxY, (float)boxWidth, (float)boxHeight }, Fade(DARKGRAY, 0.95f), YELLOW);
+    AddUiText(settings, "SETTINGS", centerX, boxY + 20, 48, YELLOW, UI_ALIGN_CENTER);
+    screens->soundVolumeText = AddUiText(settings, "", boxX + 32, boxY + 70, 28, WHITE, UI_ALIGN_LEFT);
+    screens->soundEnabledText = AddUiText(settings, "", boxX + 32, boxY + 110, 28, WHITE, UI_ALIGN_LEFT);
+    screens->musicVolumeText = AddUiText(settings, "", boxX + 32, boxY + 150, 28, WHITE, UI_ALIGN_LEFT);
+    screens->musicEnabledText = AddUiText(settings, "", boxX + 32, boxY + 190, 28, WHITE, UI_ALIGN_LEFT);
+    AddUiText(settings, "Press [S] to Close Settings", boxX + 32, boxY + 230, 24, YELLOW, UI_ALIGN_LEFT);
+
+    UiScreen* highScores = &screens->highScores;
+    int listStartY = 260;
+    ClearUiScreen(highScores);
+    screens->highScoreTitle = AddUiText(highScores, "", centerX, 180, 40, ORANGE, UI_ALIGN_CENTER);
+    for (int i = 0; i < MAX_HIGHSCORES; i++) {
+        screens->highScoreRows[i] = AddUiText(highScores, "", centerX - 100, listStartY + i*40, 30, WHITE, UI_ALIGN_LEFT);
+    }
+    AddUiText(highScores, "Press [E] Easy  [N] Normal  [H] Hard", centerX, listStartY + MAX_HIGHSCORES*40 + 20, 20, ORANGE, UI_ALIGN_CENTER);
+    AddUiText(highScores, "Press [Backspace] to return", centerX, listStartY + MAX_HIGHSCORES*40 + 50, 20, YELLOW, UI_ALIGN_CENTER);
+
+    UiScreen* gameOver = &screens->gameOver;
+    ClearUiScreen(gameOver);
+    AddUiText(gameOver, "GAME OVER", centerX, centerY - 60, 50, RED, UI_ALIGN_CENTER);
+    screens->gameOverScore = AddUiText(gameOver, "", centerX, centerY, 30, WHITE, UI_ALIGN_CENTER);
+    screens->gameOverHint = AddUiText(gameOver, "Press [R] to Restart or [ESC] to Menu", centerX, centerY + 40, 20, GRAY, UI_ALIGN_CENTER);
+    screens->gameOverRank = AddUiText(gameOver, "", centerX, centerY + 70, 20, GRAY, UI_ALIGN_CENTER);
+    screens->gameOverNewHighScore = AddUiText(gameOver, "NEW HIGH SCORE!", centerX, centerY + 40, 30, ORANGE, UI_ALIGN_CENTER);
+    screens->gameOverRewindHint = AddUiText(gameOver, "Press [Z] to Rewind", centerX, centerY + 100, 20, SKYBLUE, UI_ALIGN_CENTER);
+
+    UiScreen* enterName = &screens->enterName;
+    ClearUiScreen(enterName);
+    AddUiPanel(enterName, (Rectangle){ (float)(centerX - 100), (float)(centerY + 20), 200.0f, 40.0f }, DARKGRAY, DARKGRAY);
+    AddUiText(enterName, "NEW HIGH SCORE!", centerX, centerY - 80, 40, ORANGE, UI_ALIGN_CENTER);
+    AddUiText(enterName, "Enter Your Name:", centerX - 120, centerY - 20, 30, WHITE, UI_ALIGN_LEFT);
+    screens->enterNameField = AddUiText(enterName, "", centerX - 90, centerY + 25, 30, YELLOW, UI_ALIGN_LEFT);
+    AddUiText(enterName, "Press [ENTER] to Confirm", centerX, centerY + 70, 20, GRAY, UI_ALIGN_CENTER);
+
+    UiScreen* win = &screens->win;
+    ClearUiScreen(win);
+    screens->winTitle = AddUiText(win, "", centerX, centerY - 40, 40, GREEN, UI_ALIGN_CENTER);
+    screens->winNext = AddUiText(win, "", centerX, centerY + 20, 20, YELLOW, UI_ALIGN_CENTER);
+
+    UiScreen* rewindScreen = &screens->rewind;
+    ClearUiScreen(rewindScreen);
+    screens->rewindTime = AddUiText(rewindScreen, "", centerX, 20, 30, SKYBLUE, UI_ALIGN_CENTER);
+    AddUiText(rewindScreen, "Hold [LEFT]/[RIGHT] to Scrub   [SPACE] Resume   [ESC] Menu", centerX, screenHeight - 40, 20, SKYBLUE, UI_ALIGN_CENTER);
+
+    UiScreen* hud = &screens->hud;
+    ClearUiScreen(hud);
+    screens->hudScore = AddUiText(hud, "", 10, 10, 20, WHITE, UI_ALIGN_LEFT);
+    screens->hudFast = AddUiText(hud, TextFormat("FAST x%d", FAST_FORWARD_SPEED), 10, 35, 20, YELLOW, UI_ALIGN_LEFT);
+    screens->hudSwarm = AddUiText(hud, "", 10, 60, 20, ORANGE, UI_ALIGN_LEFT);
+    screens->hudAutopilot = AddUiText(hud, "AUTOPILOT  [P] to take over", 10, 85, 20, SKYBLUE, UI_ALIGN_LEFT);
 }
 
-Vector2 calculate_ghost_target(const Ghost* ghost, const Pacman* pacman, const Ghost* blinky) { // Calculates the target tile for a ghost based on its type and Pacman's position/direction.
-    Vector2 targetTile = { 0, 0 };
+void RefreshStartScreen(GameScreens* screens, Difficulty selected) { // Highlights the selected difficulty and fills in the settings values.
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        screens->start.texts[screens->startDifficulty[d]].color = (d == (int)selected) ? YELLOW : GRAY;
+    }
 
-    int pacmanTileX = (int)((pacman->position.x - MAZE_DRAW_OFFSET_X) / TILE_SIZE);
-    int pacmanTileY = (int)((pacman->position.y - MAZE_DRAW_OFFSET_Y) / TILE_SIZE);
+    UiText* texts = screens->settings.texts;
+    int soundPercent = (int)roundf(soundVolume * 100);
+    int musicPercent = (int)roundf(musicVolume * 100);
+    if (UiTextKeyChanged(&texts[screens->soundVolumeText], soundPercent, 0)) {
+        SetUiText(&texts[screens->soundVolumeText], TextFormat("Sound Volume: %d%%  [Up/Down]", soundPercent));
+    }
+    if (UiTextKeyChanged(&texts[screens->soundEnabledText], soundEnabled, 0)) {
+        SetUiText(&texts[screens->soundEnabledText], TextFormat("Sound: %s  [A]", soundEnabled ? "ON" : "OFF"));
+    }
+    if (UiTextKeyChanged(&texts[screens->musicVolumeText], musicPercent, 0)) {
+        SetUiText(&texts[screens->musicVolumeText], TextFormat("Music Volume: %d%%  [U/L]", musicPercent));
+    }
+    if (UiTextKeyChanged(&texts[screens->musicEnabledText], musicEnabled, 0)) {
+        SetUiText(&texts[screens->musicEnabledText], TextFormat("Music: %s  [M]", musicEnabled ? "ON" : "OFF"));
+    }
+}
 
-    switch (ghost->type) {
-        case BLINKY:
-            targetTile = (Vector2){ (float)pacmanTileX, (float)pacmanTileY };
-            break;
-        case PINKY: {
-            Vector2 targetOffset = { pacman->direction.x * 4, pacman->direction.y * 4 };
-            if (pacman->direction.y < 0 && pacman->direction.x == 0) {
-                targetOffset.x = -4;
-            }
-            targetTile = (Vector2){ (float)(pacmanTileX + targetOffset.x), (float)(pacmanTileY + targetOffset.y) };
+void RefreshHighScoreScreen(GameScreens* screens, Difficulty difficulty) { // Re-reads the rows only when the difficulty or the board changed.
+    UiText* texts = screens->highScores.texts;
+    if (!UiTextKeyChanged(&texts[screens->highScoreTitle], difficulty, leaderboard.nodeCount)) return;
 
-            if (targetTile.x < 0) targetTile.x = 0;
-            if (targetTile.x >= MAZE_WIDTH) targetTile.x = MAZE_WIDTH - 1;
-            if (targetTile.y < 0) targetTile.y = 0;
-            if (targetTile.y >= MAZE_HEIGHT) targetTile.y = MAZE_HEIGHT - 1;
+    SetUiText(&texts[screens->highScoreTitle], TextFormat("HIGH SCORES - %s", DifficultyName(difficulty)));
+    for (int i = 0; i < MAX_HIGHSCORES; i++) {
+        LeaderboardEntry entry = { "", 0 };
+        leaderboard_entry(&leaderboard, difficulty, i + 1, &entry);
+        SetUiText(&texts[screens->highScoreRows[i]], TextFormat("%d. %s - %d", i+1, entry.name, entry.score));
+    }
+}
 
-            break;
-        }
-        case INKY: {
-            Vector2 pacmanAhead = { (float)(pacmanTileX + pacman->direction.x * 2), (float)(pacmanTileY + pacman->direction.y * 2) };
-            Vector2 blinkyTile = { (float)((int)((blinky->position.x - MAZE_DRAW_OFFSET_X) / TILE_SIZE)), (float)((int)((blinky->position.y - MAZE_DRAW_OFFSET_Y) / TILE_SIZE)) };
+void RefreshGameOverScreen(GameScreens* screens, int score, Difficulty difficulty, bool canRewind) { // Score and rank lines, rebuilt when either value moves.
+    UiText* texts = screens->gameOver.texts;
+    if (UiTextKeyChanged(&texts[screens->gameOverScore], score, 0)) {
+        SetUiText(&texts[screens->gameOverScore], TextFormat("Score: %d", score));
+    }
 
-            Vector2 vectorBlinkyToPacmanAhead = { pacmanAhead.x - blinkyTile.x, pacmanAhead.y - blinkyTile.y };
+    int rank = leaderboard_rank(&leaderboard, difficulty, score);
+    int count = leaderboard_count(&leaderboard, difficulty) + 1;
+    if (UiTextKeyChanged(&texts[screens->gameOverRank], rank, count)) {
+        SetUiText(&texts[screens->gameOverRank], TextFormat("Rank %d of %d", rank, count));
+    }
 
-            targetTile = (Vector2){ blinkyTile.x + 2 * vectorBlinkyToPacmanAhead.x, blinkyTile.y + 2 * vectorBlinkyToPacmanAhead.y };
+    bool highScore = score > 0 && rank <= MAX_HIGHSCORES;
+    texts[screens->gameOverHint].visible = !highScore;
+    texts[screens->gameOverRank].visible = !highScore;
+    texts[screens->gameOverNewHighScore].visible = highScore;
+    texts[screens->gameOverRewindHint].visible = canRewind && !highScore;
+}
 
-            if (targetTile.x < 0) targetTile.x = 0;
-            if (targetTile.x >= MAZE_WIDTH) targetTile.x = MAZE_WIDTH - 1;
-            if (targetTile.y < 0) targetTile.y = 0;
-            if (targetTile.y >= MAZE_HEIGHT) targetTile.y = MAZE_HEIGHT - 1;
+void RefreshWinScreen(GameScreens* screens, Difficulty difficulty, int level) { // Finished and upcoming level numbers.
+    UiText* texts = screens->win.texts;
+    if (!UiTextKeyChanged(&texts[screens->winTitle], difficulty, level)) return;
+    SetUiText(&texts[screens->winTitle], TextFormat("You Win! %s Level %d Finished", DifficultyName(difficulty), level));
+    SetUiText(&texts[screens->winNext], TextFormat("Get Ready for Level %d...", level + 1));
+}
 
-            break;
-        }
-        case CLYDE: {
-            float distanceToPacman = sqrtf(powf(ghost->position.x - pacman->position.x, 2) + powf(ghost->position.y - pacman->position.y, 2));
-            float scatterDistance = TILE_SIZE * 8;
-
-            if (distanceToPacman > scatterDistance) {
-                targetTile = (Vector2){ (float)pacmanTileX, (float)pacmanTileY };
-            } else {
-                targetTile = (Vector2){ 1, MAZE_HEIGHT - 2 };
-            }
-            break;
-        }
+void RefreshRewindScreen(GameScreens* screens, uint32_t tick, uint32_t endTick) { // Time behind the newest recorded moment, in tenths of a second.
+    UiText* text = &screens->rewind.texts[screens->rewindTime];
+    int tenths = (int)((endTick - tick) * 10 / SIM_TICKS_PER_SECOND);
+    if (UiTextKeyChanged(text, tenths, 0)) {
+        SetUiText(text, TextFormat("<< REWIND  -%d.%ds", tenths / 10, tenths % 10));
     }
+}
 
-    return targetTile;
+void RefreshHud(GameScreens* screens, const SimState* sim, bool autopilot) { // Score line only reformats when the score or level moved.
+    UiText* texts = screens->hud.texts;
+    if (UiTextKeyChanged(&texts[screens->hudScore], sim->score, sim->level)) {
+        SetUiText(&texts[screens->hudScore], TextFormat("Score: %d  Level: %d", sim->score, sim->level));
+    }
+    texts[screens->hudFast].visible = IsKeyDown(KEY_TAB);
+    texts[screens->hudSwarm].visible = sim->swarm != NULL;
+    texts[screens->hudAutopilot].visible = autopilot;
+    if (sim->swarm) {
+        // Contacts and FPS change nearly every frame, so this stress-mode line is simply formatted each time.
+        SetUiText(&texts[screens->hudSwarm], TextFormat("SWARM %d  contacts %llu  %d FPS", sim->swarm->count,
+            (unsigned long long)sim->swarm->contacts, GetFPS()));
+    }
 }
 
-float manhattan_distance(Vector2 tile1, Vector2 tile2) { // Calculates the Manhattan distance between two tile coordinates.
-    return fabsf(tile1.x - tile2.x) + fabsf(tile1.y - tile2.y);
+// Menus only change on input, so while one is up the loop sleeps in EndDrawing until an input event arrives
+// (raylib's event waiting) instead of spinning at the display rate. A wake-up only draws the menu again if
+// something it shows differs from the last drawn MenuView; otherwise the previous frame is presented again
+// straight from the frame target. The music doesn't notice: the audio thread streams it on its own clock.
+typedef struct MenuView {
+    GameState state;
+    Difficulty selected;
+    Difficulty highScoreView;
+    bool settingsOpen;
+    bool soundEnabled;
+    bool musicEnabled;
+    bool canRewind;
+    int soundPercent;
+    int musicPercent;
+    int score;
+    int leaderboardNodes;
+    char name[MAX_NAME_LENGTH + 1];
+    int windowWidth;       // The target is rebuilt on resize and has to be drawn again
+    int windowHeight;
+} MenuView;
+
+bool IsIdleState(GameState state, bool nameDue) { // Screens with nothing moving between key presses.
+    // A game over that made the high scores switches to ENTER_NAME on the next frame by itself; waiting for
+    // input there would hold that up, and the key that woke it would be lost to the empty name field.
+    if (state == GAME_OVER) return !nameDue;
+    return state == START_SCREEN || state == HIGHSCORE_MENU || state == ENTER_NAME;
 }
 
-char playerName[MAX_NAME_LENGTH + 1] = "";
-int nameLength = 0;
+MenuView CaptureMenuView(GameState state, Difficulty selected, Difficulty highScoreView, int score, bool canRewind, const FrameTarget* frame) { // Everything a menu's pixels depend on.
+    MenuView view;
+    memset(&view, 0, sizeof(view)); // Compared with memcmp, so padding must be zero too
+    view.state = state;
+    view.selected = selected;
+    view.highScoreView = highScoreView;
+    view.settingsOpen = showSettingsMenu;
+    view.soundEnabled = soundEnabled;
+    view.musicEnabled = musicEnabled;
+    view.canRewind = canRewind;
+    view.soundPercent = (int)roundf(soundVolume * 100);
+    view.musicPercent = (int)roundf(musicVolume * 100);
+    view.score = score;
+    view.leaderboardNodes = leaderboard.nodeCount;
+    strncpy(view.name, playerName, MAX_NAME_LENGTH);
+    view.windowWidth = frame->windowWidth;
+    view.windowHeight = frame->windowHeight;
+    return view;
+}
 
-int level = 1;
+void ReportStartup(const char* logFile, double firstFrameMs, double windowMs, double assetMs, bool packed) { // Logs time-to-first-frame and appends it to logFile, if given, as one CSV row per launch.
+    TraceLog(LOG_INFO, "STARTUP: first frame %.1f ms after launch (window %.1f ms, assets %.1f ms from %s)",
+        firstFrameMs, windowMs, assetMs, packed ? "the archive" : "loose files");
+    if (!logFile) return;
+    FILE* file = fopen(logFile, "a");
+    if (!file) {
+        TraceLog(LOG_WARNING, "Failed to open startup log %s", logFile);
+        return;
+    }
+    fprintf(file, "%ld,%.2f,%.2f,%.2f,%s\n", (long)time(NULL), firstFrameMs, windowMs, assetMs, packed ? "archive" : "files");
+    fclose(file);
+}
 
-float winScreenTimer = 0.0f;
-const float WIN_SCREEN_DURATION = 2.5f;
+int main(int argc, char** argv) {
+    // Time-to-first-frame is measured from here: process startup before main is negligible next to the rest.
+    uint64_t launchTime = profiler_now_ns();
+
+    // Vsync lets rendering follow the monitor (60/144/240 Hz); --no-vsync renders uncapped.
+    // --replay FILE watches a recorded game instead of playing ([TAB] still fast-forwards).
+    // --swarm N adds N wandering ghosts as a load test (harmless unless --swarm-lethal is also given).
+    // --maze FILE plays on a .pmz map instead of the builtin maze.
+    // --window WxH opens the window at that size; it can be resized freely.
+    // --frame-budget MS is the frame time the render resolution adapts to hold; 0 always renders at full resolution.
+    // --assets FILE loads a packed asset archive other than the one next to the executable.
+    // --startup-log FILE appends each launch's time-to-first-frame to FILE as CSV (time, total, window, assets ms, source).
+    bool vsync = true;
+    int windowWidth = designWidth;
+    int windowHeight = designHeight;
+    float frameBudget = 1.0f / 60.0f;
+    const char* replayFile = NULL;
+    const char* mazeFile = NULL;
+    const char* assetFile = NULL;
+    const char* startupLog = NULL;
+    int swarmCount = 0;
+    bool swarmLethal = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-vsync") == 0) vsync = false;
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayFile = argv[++i];
+        else if (strcmp(argv[i], "--swarm") == 0 && i + 1 < argc) swarmCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--swarm-lethal") == 0) swarmLethal = true;
+        else if (strcmp(argv[i], "--maze") == 0 && i + 1 < argc) mazeFile = argv[++i];
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &windowWidth, &windowHeight);
+        else if (strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc) frameBudget = (float)atof(argv[++i]) / 1000.0f;
+        else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) assetFile = argv[++i];
+        else if (strcmp(argv[i], "--startup-log") == 0 && i + 1 < argc) startupLog = argv[++i];
+    }
+    if (windowWidth < 320) windowWidth = 320;
+    if (windowHeight < 180) windowHeight = 180;
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | (vsync ? FLAG_VSYNC_HINT : 0));
 
-bool showSettingsMenu = false;
-float soundVolume = 1.0f;
-float musicVolume = 1.0f;
-bool soundEnabled = true;
-bool musicEnabled = true;
+    InitWindow(windowWidth, windowHeight, "Raylib Pac-Man - Levels");
+    SetWindowMinSize(320, 180);
 
-int main() {
-    InitWindow(screenWidth, screenHeight, "Raylib Pac-Man - Levels");
+    // Everything is drawn into this target at a resolution that holds frameBudget, then scaled to the window.
+    FrameTarget frame;
+    if (!LoadFrameTarget(&frame, designWidth, designHeight, frameBudget)) {
+        TraceLog(LOG_ERROR, "Failed to create the frame render texture");
+        CloseWindow();
+        return 1;
+    }
+    screenWidth = frame.layoutWidth;
+    screenHeight = frame.layoutHeight;
+    uint64_t windowTime = profiler_now_ns();
+
+    // Assets come from the packed archive next to the executable (make assets) when there is one, otherwise
+    // from the loose files in resources/ there; the working directory doesn't matter either way.
+    char resourceDir[1024];
+    snprintf(resourceDir, sizeof(resourceDir), "%s%s", GetApplicationDirectory(), ASSET_RESOURCE_DIR);
+    char archiveFile[1024];
+    snprintf(archiveFile, sizeof(archiveFile), "%s", assetFile ? assetFile : TextFormat("%s%s", GetApplicationDirectory(), ASSET_ARCHIVE_NAME));
+    AssetArchive assets;
+    uint64_t assetStart = profiler_now_ns();
+    bool packedAssets = asset_open(&assets, archiveFile);
+    if (!packedAssets) {
+        TraceLog(assetFile ? LOG_WARNING : LOG_INFO, "No asset archive at %s, loading files from %s", archiveFile, resourceDir);
+    }
+    uint64_t assetTime = profiler_now_ns() - assetStart;
 
     InitAudioDevice();
-    Sound startSound = LoadSound("resources/audio/start.mp3");
-    Sound deathSound = LoadSound("resources/audio/death.mp3");
-    Sound eatSound = LoadSound("resources/audio/eat.wav");
-    Music bgMusic = LoadMusicStream("resources/audio/music.mp3");
+    AudioSystem audio;
+    assetStart = profiler_now_ns();
+    if (!StartAudioSystem(&audio, packedAssets ? &assets : NULL, resourceDir)) {
+        TraceLog(LOG_WARNING, "Some audio files failed to load");
+    }
+    assetTime += profiler_now_ns() - assetStart;
+    PlayGameSound(&audio, GAME_SOUND_START);
+
+    MazeMap loadedMap;
+    memset(&loadedMap, 0, sizeof(loadedMap));
+    const MazeMap* map = maze_builtin();
+    if (mazeFile) {
+        if (maze_load(&loadedMap, mazeFile)) {
+            map = &loadedMap;
+        } else {
+            TraceLog(LOG_ERROR, "Failed to load maze %s, using the builtin maze", mazeFile);
+        }
+    }
 
-    PlayMusicStream(bgMusic);
+    assetStart = profiler_now_ns();
+    SpriteAtlas spriteAtlas = LoadSpriteAtlas(packedAssets ? &assets : NULL, resourceDir);
+    assetTime += profiler_now_ns() - assetStart;
+    MazeLayer mazeLayer = LoadMazeLayer(map->width, map->height, TILE_SIZE);
 
-    PlaySound(startSound);
+    GameScreens screens;
+    BuildGameScreens(&screens);
 
-    SetSoundVolume(startSound, soundVolume);
-    SetSoundVolume(deathSound, soundVolume);
-    SetSoundVolume(eatSound, soundVolume);
-    SetMusicVolume(bgMusic, musicVolume);
+    GameState currentState = START_SCREEN;
+    Difficulty selectedDifficulty = EASY;
+    Difficulty highScoreViewDifficulty = EASY;
 
-    bool pauseBgMusic = false;
-    Sound* pendingSound = NULL;
+    srand((unsigned int)time(NULL));
 
-    for (int y = 0; y < MAZE_HEIGHT; y++) {
-        for (int x = 0; x < MAZE_WIDTH; x++) {
-            initialMaze[y][x] = maze[y][x];
-        }
+    if (!leaderboard_open(&leaderboard, LEADERBOARD_FILE)) {
+        TraceLog(LOG_WARNING, "Leaderboard %s unavailable, scores from this session won't be saved", LEADERBOARD_FILE);
     }
 
-    Pacman pacman;
-    pacman.position = (Vector2){ MAZE_DRAW_OFFSET_X + TILE_SIZE * 1.5, MAZE_DRAW_OFFSET_Y + TILE_SIZE * 1.5 };
-    pacman.speed = 6.0f;
-    pacman.direction = (Vector2){ 1.0f, 0.0f };
-    pacman.radius = TILE_SIZE * 0.4f;
-    pacman.textureOpen = LoadTexture("resources/textures/pacman.png");
-    if (pacman.textureOpen.id <= 0) {
-        TraceLog(LOG_ERROR, "Failed to load pacman.png texture!");
+    NavCache nav;
+    if (!sim_init_nav(&nav, map)) {
+        TraceLog(LOG_ERROR, "Failed to build ghost distance fields!");
     }
-    pacman.textureClosed = LoadTexture("resources/textures/pacman1.png");
-    if (pacman.textureClosed.id <= 0) {
-        TraceLog(LOG_ERROR, "Failed to load pacman1.png texture!");
-    }
-    pacman.frameCounter = 0;
-    pacman.framesSpeed = 8;
-    pacman.mouthOpen = true;
-
-    Ghost ghosts[MAX_GHOSTS];
-    Color ghostColors[MAX_GHOSTS] = { RED, PINK, SKYBLUE, ORANGE };
-    GhostType ghostTypes[MAX_GHOSTS] = { BLINKY, PINKY, INKY, CLYDE };
-    Vector2 ghostStartTilePositions[MAX_GHOSTS] = {
-        { 12.5f, 8.5f },
-        { 12.5f, 8.5f },
-        { 11.5f, 8.5f },
-        { 13.5f, 8.5f }
-    };
-
-    Texture2D ghostTextures[MAX_GHOSTS];
-    ghostTextures[0] = LoadTexture("resources/textures/blinky.png");
-    ghostTextures[1] = LoadTexture("resources/textures/pinky.png");
-    ghostTextures[2] = LoadTexture("resources/textures/inky.png");
-    ghostTextures[3] = LoadTexture("resources/textures/clyde.png");
 
-    for (int i = 0; i < MAX_GHOSTS; i++) {
-        if (ghostTextures[i].id <= 0) {
-            TraceLog(LOG_ERROR, TextFormat("Failed to load ghost texture: %d", i));
+    Swarm swarm;
+    memset(&swarm, 0, sizeof(swarm));
+    if (swarmCount > 0) {
+        if (swarm_init(&swarm, swarmCount)) {
+            swarm.lethal = swarmLethal;
+            stressSwarm = &swarm;
+        } else {
+            TraceLog(LOG_ERROR, "Failed to allocate a swarm of %d ghosts", swarmCount);
         }
     }
 
-    for (int i = 0; i < MAX_GHOSTS; i++) {
-        ghosts[i].position = (Vector2){ MAZE_DRAW_OFFSET_X + ghostStartTilePositions[i].x * TILE_SIZE, MAZE_DRAW_OFFSET_Y + ghostStartTilePositions[i].y * TILE_SIZE };
-        ghosts[i].speed = 4.0f;
-        ghosts[i].direction = (Vector2){ 0.0f, 0.0f };
-        ghosts[i].radius = TILE_SIZE * 0.4f;
-        ghosts[i].color = ghostColors[i];
-        ghosts[i].type = ghostTypes[i];
-        ghosts[i].texture = ghostTextures[i];
+    // Sounds and the overlay's event counts are consumers of the gameplay event bus; the game loop only dispatches.
+    EventBus eventBus;
+    EventTally eventTally;
+    memset(&eventTally, 0, sizeof(eventTally));
+    int eventTallyId = -1;
+    if (event_bus_init(&eventBus, EVENT_BUS_CAPACITY)) {
+        event_bus_subscribe(&eventBus, PlayEventSounds, &audio);
+        eventTallyId = event_bus_subscribe(&eventBus, event_tally_consume, &eventTally);
+        gameEvents = &eventBus;
+    } else {
+        TraceLog(LOG_WARNING, "Failed to allocate the event bus, gameplay will be silent");
     }
 
-    int score = 0;
-    GameState currentState = START_SCREEN;
-    Difficulty selectedDifficulty = EASY;
-    Difficulty highScoreViewDifficulty = EASY;
-    int activeGhostsCount = 0;
+    SimState sim = {};
+    SimState previousSim;
+    SimInput queuedInput = { SIM_DIR_NONE };
+    StartGame(&sim, &previousSim, map, selectedDifficulty, (uint32_t)rand(), &nav);
+
+    // [P] during a game hands Pac-Man to the lookahead search bot; its moves are recorded like any other input.
+    SearchConfig autopilotConfig = bot_search_defaults();
+    SearchBot autopilot;
+    bool autopilotReady = bot_search_init(&autopilot, &autopilotConfig, &sim);
+    bool autopilotOn = false;
+
+    // [Z] pauses a game, or picks up a lost one, and scrubs back through the current level.
+    Rewind rewindHistory;
+    memset(&rewindHistory, 0, sizeof(rewindHistory));
+    if (!stressSwarm) {
+        if (rewind_init(&rewindHistory, &sim, REWIND_SECONDS, REWIND_KEYFRAME_TICKS)) {
+            gameRewind = &rewindHistory;
+        } else {
+            TraceLog(LOG_WARNING, "Failed to allocate the rewind history");
+        }
+    }
+    uint32_t rewindTick = 0;
+
+    ReplayWriter recorder;
+    memset(&recorder, 0, sizeof(recorder));
+
+    Replay replay;
+    ReplayCursor replayCursor;
+    bool playingReplay = false;
+    if (replayFile) {
+        if (replay_load(&replay, replayFile)) {
+            selectedDifficulty = replay.difficulty;
+            StartGame(&sim, &previousSim, map, replay.difficulty, replay.seed, &nav);
+            replay_cursor_init(&replayCursor, &replay);
+            playingReplay = true;
+            currentState = GAMEPLAY;
+        } else {
+            TraceLog(LOG_ERROR, "Failed to load replay %s", replayFile);
+        }
+    }
 
-    srand((unsigned int)time(NULL));
+    // [F3] toggles the timing overlay, [F4] starts/stops streaming per-frame timings to a CSV file.
+    Profiler profiler;
+    profiler_init(&profiler);
+    bool showProfiler = false;
 
-    SetTargetFPS(60);
+    // Idle: the last frame waited for input in a menu (see MenuView).
+    bool idle = false;
+    MenuView drawnMenu;
+    bool menuDrawn = false;
 
     while (!WindowShouldClose()) {
-        UpdateMusicStream(bgMusic);
+        // Time spent waiting for input says nothing about how long frames take to draw.
+        if (UpdateFrameTarget(&frame, idle ? 0.0f : GetFrameTime())) {
+            screenWidth = frame.layoutWidth;
+            screenHeight = frame.layoutHeight;
+            BuildGameScreens(&screens);
+        }
 
-        if (pauseBgMusic && pendingSound != NULL && !IsSoundPlaying(*pendingSound)) {
-            PlayMusicStream(bgMusic);
-            pauseBgMusic = false;
-            pendingSound = NULL;
+        if (IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+        if (IsKeyPressed(KEY_F4)) {
+            if (profiler.csv) {
+                profiler_stop_csv(&profiler);
+            } else if (!profiler_start_csv(&profiler, TextFormat("profile_%ld.csv", (long)time(NULL)))) {
+                TraceLog(LOG_WARNING, "Failed to open profiler CSV file");
+            }
         }
+        activeProfiler = (showProfiler || profiler.csv) ? &profiler : NULL;
+        if (gameEvents) event_bus_enable(gameEvents, eventTallyId, showProfiler);
+        if (activeProfiler) profiler_begin_frame(&profiler);
 
         if (IsKeyPressed(KEY_S) && currentState == START_SCREEN) {
             showSettingsMenu = !showSettingsMenu;
         }
 
         if (showSettingsMenu && currentState == START_SCREEN) {
+            PROFILE_SCOPE(PROFILE_INPUT);
             if (IsKeyPressed(KEY_UP)) {
                 if (soundVolume < 1.0f) soundVolume += 0.1f;
             }
@@ -357,11 +658,12 @@ int main() {
             if (soundVolume < 0.0f) soundVolume = 0.0f;
             if (musicVolume > 1.0f) musicVolume = 1.0f;
             if (musicVolume < 0.0f) musicVolume = 0.0f;
+        }
 
-            SetSoundVolume(startSound, soundEnabled ? soundVolume : 0.0f);
-            SetSoundVolume(deathSound, soundEnabled ? soundVolume : 0.0f);
-            SetSoundVolume(eatSound, soundEnabled ? soundVolume : 0.0f);
-            SetMusicVolume(bgMusic, musicEnabled ? musicVolume : 0.0f);
+        {
+            // Only queues anything when a setting actually changed.
+            PROFILE_SCOPE(PROFILE_AUDIO);
+            SetAudioVolumes(&audio, soundEnabled ? soundVolume : 0.0f, musicEnabled ? musicVolume : 0.0f);
         }
 
         switch (currentState) {
@@ -371,27 +673,9 @@ int main() {
                 if (IsKeyPressed(KEY_H)) selectedDifficulty = HARD;
 
                 if (IsKeyPressed(KEY_SPACE)) {
-                    PauseMusicStream(bgMusic);
-                    PlaySound(startSound);
-                    pauseBgMusic = true;
-                    pendingSound = &startSound;
-
-                    activeGhostsCount = (selectedDifficulty == EASY) ? 2 : (selectedDifficulty == NORMAL) ? 3 : 4;
-                    pacman.position = (Vector2){ MAZE_DRAW_OFFSET_X + TILE_SIZE * 1.5, MAZE_DRAW_OFFSET_Y + TILE_SIZE * 1.5 };
-                    pacman.direction = (Vector2){ 1.0f, 0.0f };
-                    score = 0;
-                    for (int y = 0; y < MAZE_HEIGHT; y++) {
-                        for (int x = 0; x < MAZE_WIDTH; x++) {
-                            maze[y][x] = initialMaze[y][x];
-                        }
-                    }
-                    Vector2 ghostResetTilePositions[MAX_GHOSTS] = {
-                        { 12.5f, 8.5f }, { 12.5f, 8.5f }, { 11.5f, 8.5f }, { 13.5f, 8.5f }
-                    };
-                    for (int i = 0; i < activeGhostsCount; i++) {
-                        ghosts[i].position = (Vector2){ MAZE_DRAW_OFFSET_X + ghostResetTilePositions[i].x * TILE_SIZE, MAZE_DRAW_OFFSET_Y + ghostResetTilePositions[i].y * TILE_SIZE };
-                        ghosts[i].direction = (Vector2){ 0.0f, 0.0f };
-                    }
+                    PlayGameSoundOverMusic(&audio, GAME_SOUND_START);
+
+                    StartRecordedGame(&sim, &previousSim, map, selectedDifficulty, &nav, &recorder);
                     currentState = GAMEPLAY;
                 }
 
@@ -399,32 +683,6 @@ int main() {
                     currentState = HIGHSCORE_MENU;
                     highScoreViewDifficulty = EASY;
                 }
-
-                DrawText("PAC-MAN", screenWidth/2 - MeasureText("PAC-MAN", 60)/2, 40, 60, YELLOW);
-                DrawText("Select Difficulty:", screenWidth/2 - MeasureText("Select Difficulty:", 30)/2, 120, 30, WHITE);
-                DrawText("E - Easy (2 Ghosts)", screenWidth/2 - MeasureText("E - Easy (2 Ghosts)", 20)/2, 160, 20, (selectedDifficulty == EASY) ? YELLOW : GRAY);
-                DrawText("N - Normal (3 Ghosts)", screenWidth/2 - MeasureText("N - Normal (3 Ghosts)", 20)/2, 190, 20, (selectedDifficulty == NORMAL) ? YELLOW : GRAY);
-                DrawText("H - Hard (4 Ghosts)", screenWidth/2 - MeasureText("H - Hard (4 Ghosts)", 20)/2, 220, 20, (selectedDifficulty == HARD) ? YELLOW : GRAY);
-                DrawText("Press [SPACE] to Start", screenWidth/2 - MeasureText("Press [SPACE] to Start", 30)/2, 280, 30, YELLOW);
-                DrawText("Use Arrow Keys to Move", screenWidth/2 - MeasureText("Use Arrow Keys to Move", 20)/2, 320, 20, GRAY);
-                DrawText("Press [S] for Settings", screenWidth/2 - MeasureText("Press [S] for Settings", 20)/2, 350, 20, ORANGE);
-                DrawText("Press [B] for High Scores", screenWidth/2 - MeasureText("Press [B] for High Scores", 20)/2, 380, 20, ORANGE);
-
-                if (showSettingsMenu) {
-                                int boxWidth = (int)(440 * 1.2f);    // 528
-                                int boxHeight = (int)(240 * 1.2f);  // 288
-                                int boxX = screenWidth/2 - boxWidth/2;
-                                int boxY = 100;
-                                DrawRectangle(boxX, boxY, boxWidth, boxHeight, Fade(DARKGRAY, 0.95f));
-                                DrawRectangleLines(boxX, boxY, boxWidth, boxHeight, YELLOW);
-                                DrawText("SETTINGS", screenWidth/2 - MeasureText("SETTINGS", 48)/2, boxY + 20, 48, YELLOW);
-
-                                DrawText(TextFormat("Sound Volume: %.0f%%  [Up/Down]", soundVolume * 100), boxX + 32, boxY + 70, 28, WHITE);
-                                DrawText(TextFormat("Sound: %s  [A]", soundEnabled ? "ON" : "OFF"), boxX + 32, boxY + 110, 28, WHITE);
-                                DrawText(TextFormat("Music Volume: %.0f%%  [U/L]", musicVolume * 100), boxX + 32, boxY + 150, 28, WHITE);
-                                DrawText(TextFormat("Music: %s  [M]", musicEnabled ? "ON" : "OFF"), boxX + 32, boxY + 190, 28, WHITE);
-                                DrawText("Press [S] to Close Settings", boxX + 32, boxY + 230, 24, YELLOW);
-                            }
                 } break;
 
                 case HIGHSCORE_MENU: {
@@ -432,195 +690,115 @@ int main() {
                     if (IsKeyPressed(KEY_N)) highScoreViewDifficulty = NORMAL;
                     if (IsKeyPressed(KEY_H)) highScoreViewDifficulty = HARD;
                     if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_BACKSPACE)) currentState = START_SCREEN;
-
-                    const char* diffText = (highScoreViewDifficulty == EASY) ? "EASY" :
-                                           (highScoreViewDifficulty == NORMAL) ? "NORMAL" : "HARD";
-                    int titleY = 180;
-                    int listStartY = 260;
-                    DrawText(TextFormat("HIGH SCORES - %s", diffText), screenWidth/2 - MeasureText(TextFormat("HIGH SCORES - %s", diffText), 40)/2, titleY, 40, ORANGE);
-
-                    HighScore* table = GetHighScoreTable(highScoreViewDifficulty);
-                    for (int i = 0; i < MAX_HIGHSCORES; i++) {
-                        DrawText(TextFormat("%d. %s - %d", i+1, table[i].name, table[i].score),
-                            screenWidth/2 - 100, listStartY + i*40, 30, WHITE);
-                    }
-                    DrawText("Press [E] Easy  [N] Normal  [H] Hard", screenWidth/2 - MeasureText("Press [E] Easy  [N] Normal  [H] Hard", 20)/2, listStartY + MAX_HIGHSCORES*40 + 20, 20, ORANGE);
-                    DrawText("Press [Backspace] to return", screenWidth/2 - MeasureText("Press [Backspace] to return", 20)/2, listStartY + MAX_HIGHSCORES*40 + 50, 20, YELLOW);
                 } break;
 
                 case GAMEPLAY: {
-                    Vector2 intendedDirection = pacman.direction;
-
-                    if (IsKeyDown(KEY_RIGHT) || IsKeyPressed(KEY_D)) {
-                        intendedDirection = (Vector2){ 1.0f, 0.0f };
-                    } else if (IsKeyDown(KEY_LEFT) || IsKeyPressed(KEY_A)) {
-                        intendedDirection = (Vector2){ -1.0f, 0.0f };
-                    } else if (IsKeyDown(KEY_UP) || IsKeyPressed(KEY_W)) {
-                        intendedDirection = (Vector2){ 0.0f, -1.0f };
-                    } else if (IsKeyDown(KEY_DOWN) || IsKeyPressed(KEY_S)) {
-                        intendedDirection = (Vector2){ 0.0f, 1.0f };
+                    {
+                        PROFILE_SCOPE(PROFILE_INPUT);
+                        SimInput frameInput = ReadGameplayInput(true);
+                        if (frameInput.direction != SIM_DIR_NONE) queuedInput = frameInput;
+                        if (IsKeyPressed(KEY_P) && autopilotReady && !playingReplay) autopilotOn = !autopilotOn;
                     }
-
-                    Vector2 potentialNewPosition = pacman.position;
-                    potentialNewPosition.x += intendedDirection.x * pacman.speed;
-                    potentialNewPosition.y += intendedDirection.y * pacman.speed;
-
-                    if (!check_wall_collision(potentialNewPosition, intendedDirection, pacman.radius)) {
-                        pacman.position = potentialNewPosition;
-                        pacman.direction = intendedDirection;
-                    } else {
-                        potentialNewPosition = pacman.position;
-                        potentialNewPosition.x += pacman.direction.x * pacman.speed;
-                        potentialNewPosition.y += pacman.direction.y * pacman.speed;
-
-                        if (!check_wall_collision(potentialNewPosition, pacman.direction, pacman.radius)) {
-                            pacman.position = potentialNewPosition;
-                        } else {
-                            pacman.direction = (Vector2){0.0f, 0.0f};
-                        }
+                    if (IsKeyPressed(KEY_Z) && gameRewind && !playingReplay) {
+                        // The recording ends where the rewind starts, so last_game.pmr still reproduces what was played.
+                        if (recorder.file) replay_writer_close(&recorder, &sim);
+                        rewindTick = sim.tick;
+                        currentState = REWIND;
+                        break;
                     }
 
-                    pacman.frameCounter++;
-                    if (pacman.frameCounter >= (60/pacman.framesSpeed)) {
-                        pacman.frameCounter = 0;
-                        pacman.mouthOpen = !pacman.mouthOpen;
+                    float frameTime = GetFrameTime();
+                    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+                    simAccumulator += frameTime * (IsKeyDown(KEY_TAB) ? FAST_FORWARD_SPEED : 1);
+
+                    int events = 0;
+                    bool replayEnded = false;
+                    {
+                        PROFILE_SCOPE(PROFILE_SIM);
+                        while (simAccumulator >= SIM_TICK_TIME && sim.status == SIM_PLAYING) {
+                            SimInput tickInput = queuedInput;
+                            if (playingReplay && !replay_next_input(&replayCursor, &tickInput)) {
+                                replayEnded = true;
+                                break;
+                            }
+                            if (autopilotOn) tickInput = bot_search(&autopilot, &sim);
+                            replay_writer_record(&recorder, tickInput);
+                            if (gameRewind) rewind_record(gameRewind, &sim, tickInput);
+
+                            previousSim = sim;
+                            events |= sim_step(&sim, tickInput);
+                            queuedInput = ReadGameplayInput(false);
+                            simAccumulator -= SIM_TICK_TIME;
+                        }
                     }
-
-                    int pacmanTileX = (int)((pacman.position.x - MAZE_DRAW_OFFSET_X) / TILE_SIZE);
-                    int pacmanTileY = (int)((pacman.position.y - MAZE_DRAW_OFFSET_Y) / TILE_SIZE);
-
-                    if (pacmanTileX >= 0 && pacmanTileX < MAZE_WIDTH && pacmanTileY >= 0 && pacmanTileY < MAZE_HEIGHT) {
-                        if (maze[pacmanTileY][pacmanTileX] == 2) {
-                            maze[pacmanTileY][pacmanTileX] = 0;
-                            score += 10;
-                            PlaySound(eatSound);
+                    if (gameEvents) event_bus_dispatch(gameEvents);
+
+                    // A cleared level only ends a replay when the recording stops there; otherwise it goes on to the next level.
+                    if (playingReplay && (replayEnded || sim.status == SIM_DEAD || (sim.status == SIM_WON && replayCursor.run >= replay.runCount))) {
+                        bool match = replay_matches(&replay, &sim);
+                        TraceLog(match ? LOG_INFO : LOG_WARNING, "Replay %s: %s after %u ticks", replayFile, match ? "reproduced exactly" : "DIVERGED", sim.tick);
+                        if (replayEnded) {
+                            // The recording stopped mid-game (window closed), so there is no death or win to show.
+                            playingReplay = false;
+                            currentState = START_SCREEN;
                         }
                     }
+                    if (recorder.file && sim.status == SIM_DEAD) {
+                        replay_writer_close(&recorder, &sim);
+                    }
 
-                    if (AllPelletsEaten()) {
+                    if (events & SIM_EVENT_LEVEL_CLEARED) {
                         winScreenTimer = 0.0f;
                         currentState = WIN_SCREEN;
                     }
 
-                    for (int i = 0; i < activeGhostsCount; i++) {
-                        if (is_centered_in_tile(ghosts[i].position)) {
-                            Ghost* blinkyGhost = NULL;
-                            for(int j = 0; j < activeGhostsCount; j++) {
-                                if (ghosts[j].type == BLINKY) {
-                                    blinkyGhost = &ghosts[j];
-                                    break;
-                                }
-                            }
-                            Vector2 targetTile = calculate_ghost_target(&ghosts[i], &pacman, blinkyGhost);
-
-                            Vector2 bestDir = ghosts[i].direction;
-                            float minDistance = 1e9f;
-                            bool foundValidMove = false;
-
-                            Vector2 possibleDirs[4] = {
-                                { 1, 0 },
-                                { -1, 0 },
-                                { 0, 1 },
-                                { 0, -1 }
-                            };
-
-                            for (int s = 3; s > 0; s--) {
-                                int j = rand() % (s + 1);
-                                Vector2 temp = possibleDirs[s];
-                                possibleDirs[s] = possibleDirs[j];
-                                possibleDirs[j] = temp;
-                            }
-
-                            for (int d = 0; d < 4; d++) {
-                                Vector2 testDir = possibleDirs[d];
-
-                                if (testDir.x == -ghosts[i].direction.x && testDir.y == -ghosts[i].direction.y &&
-                                    (ghosts[i].direction.x != 0 || ghosts[i].direction.y != 0)) {
-                                    continue;
-                                }
-
-                                Vector2 currentGhostMazePos = { ghosts[i].position.x - MAZE_DRAW_OFFSET_X, ghosts[i].position.y - MAZE_DRAW_OFFSET_Y };
-                                int nextTileX = (int)((currentGhostMazePos.x + testDir.x * TILE_SIZE) / TILE_SIZE);
-                                int nextTileY = (int)((currentGhostMazePos.y + testDir.y * TILE_SIZE) / TILE_SIZE);
-
-
-                                if (!is_wall_tile(nextTileX, nextTileY)) {
-                                    Vector2 nextTile = { (float)nextTileX, (float)nextTileY };
-                                    float distance = manhattan_distance(nextTile, targetTile);
-
-                                    if (distance < minDistance) {
-                                        minDistance = distance;
-                                        bestDir = testDir;
-                                        foundValidMove = true;
-                                    }
-                                }
-                            }
-
-                            if (foundValidMove) {
-                                ghosts[i].direction = bestDir;
-                            } else {
-                                Vector2 reverseDir = { -ghosts[i].direction.x, -ghosts[i].direction.y };
-                                Vector2 currentGhostMazePos = { ghosts[i].position.x - MAZE_DRAW_OFFSET_X, ghosts[i].position.y - MAZE_DRAW_OFFSET_Y };
-                                int nextTileX = (int)((currentGhostMazePos.x + reverseDir.x * TILE_SIZE) / TILE_SIZE);
-                                int nextTileY = (int)((currentGhostMazePos.y + reverseDir.y * TILE_SIZE) / TILE_SIZE);
-
-                                if (!is_wall_tile(nextTileX, nextTileY)) {
-                                    ghosts[i].direction = reverseDir;
-                                } else {
-                                    ghosts[i].direction = (Vector2){0.0f, 0.0f};
-                                }
-                            }
-                        }
-
-                        ghosts[i].position.x += ghosts[i].direction.x * ghosts[i].speed;
-                        ghosts[i].position.y += ghosts[i].direction.y * ghosts[i].speed;
-                    }
-
-                    for (int i = 0; i < activeGhostsCount; i++) {
-                        if (CheckCollisionCircles(pacman.position, pacman.radius, ghosts[i].position, ghosts[i].radius)) {
-                            PauseMusicStream(bgMusic);
-                            PlaySound(deathSound);
-                            pauseBgMusic = true;
-                            pendingSound = &deathSound;
-                            currentState = GAME_OVER;
-                            break;
-                        }
+                    if (events & SIM_EVENT_PACMAN_DIED) {
+                        currentState = GAME_OVER;
                     }
 
                 } break;
 
                 case GAME_OVER: {
-                    if (IsHighScore(score, selectedDifficulty)) {
+                    if (!playingReplay && IsHighScore(sim.score, selectedDifficulty)) {
                         currentState = ENTER_NAME;
                         nameLength = 0;
                         playerName[0] = '\0';
                     } else {
                         if (IsKeyPressed(KEY_R)) {
-                            pacman.position = (Vector2){ MAZE_DRAW_OFFSET_X + TILE_SIZE * 1.5, MAZE_DRAW_OFFSET_Y + TILE_SIZE * 1.5 };
-                            pacman.direction = (Vector2){ 1.0f, 0.0f };
-                            score = 0;
-                            for (int y = 0; y < MAZE_HEIGHT; y++) {
-                                for (int x = 0; x < MAZE_WIDTH; x++) {
-                                    maze[y][x] = initialMaze[y][x];
-                                }
-                            }
-                            Vector2 ghostResetTilePositions[MAX_GHOSTS] = {
-                                { 12.5f, 8.5f },
-                                { 12.5f, 8.5f },
-                                { 11.5f, 8.5f },
-                                { 13.5f, 8.5f }
-                            };
-                            for (int i = 0; i < activeGhostsCount; i++) {
-                                ghosts[i].position = (Vector2){ MAZE_DRAW_OFFSET_X + ghostResetTilePositions[i].x * TILE_SIZE, MAZE_DRAW_OFFSET_Y + ghostResetTilePositions[i].y * TILE_SIZE };
-                                ghosts[i].direction = (Vector2){ 0.0f, 0.0f };
-                            }
+                            playingReplay = false;
+                            StartRecordedGame(&sim, &previousSim, map, selectedDifficulty, &nav, &recorder);
                             currentState = GAMEPLAY;
+                        } else if (IsKeyPressed(KEY_Z) && gameRewind && !playingReplay) {
+                            rewindTick = sim.tick;
+                            currentState = REWIND;
                         } else if (IsKeyPressed(KEY_ESCAPE)) {
+                            playingReplay = false;
                             currentState = START_SCREEN;
                         }
                     }
                 } break;
 
+                case REWIND: {
+                    uint32_t oldest = rewind_oldest(gameRewind);
+                    uint32_t target = rewindTick;
+                    if (IsKeyDown(KEY_LEFT)) target = (target > oldest + REWIND_SCRUB_TICKS) ? target - REWIND_SCRUB_TICKS : oldest;
+                    if (IsKeyDown(KEY_RIGHT)) target = (target + REWIND_SCRUB_TICKS < gameRewind->endTick) ? target + REWIND_SCRUB_TICKS : gameRewind->endTick;
+                    if (target != rewindTick && rewind_seek(gameRewind, target, &sim)) {
+                        rewindTick = target;
+                        previousSim = sim;
+                    }
+
+                    if (IsKeyPressed(KEY_SPACE) && sim.status == SIM_PLAYING) {
+                        // Play resumes from here; the history after this tick is dropped.
+                        rewind_truncate(gameRewind, rewindTick);
+                        queuedInput = (SimInput){ SIM_DIR_NONE };
+                        simAccumulator = 0.0f;
+                        currentState = GAMEPLAY;
+                    } else if (IsKeyPressed(KEY_ESCAPE)) {
+                        currentState = START_SCREEN;
+                    }
+                } break;
+
                 case ENTER_NAME: {
                     int key = GetCharPressed();
                     while (key > 0) {
@@ -636,7 +814,7 @@ int main() {
                         playerName[nameLength] = '\0';
                     }
                     if (IsKeyPressed(KEY_ENTER) && nameLength > 0) {
-                        InsertHighScore(playerName, score, selectedDifficulty);
+                        InsertHighScore(playerName, sim.score, selectedDifficulty);
                         currentState = START_SCREEN;
                     }
                 } break;
@@ -644,146 +822,208 @@ int main() {
                 case WIN_SCREEN: {
                     winScreenTimer += GetFrameTime();
                     if (winScreenTimer >= WIN_SCREEN_DURATION) {
-                        pacman.position = (Vector2){ MAZE_DRAW_OFFSET_X + TILE_SIZE * 1.5, MAZE_DRAW_OFFSET_Y + TILE_SIZE * 1.5 };
-                        pacman.direction = (Vector2){ 1.0f, 0.0f };
-                        score = 0;
-                        level = 1;
-                        for (int y = 0; y < MAZE_HEIGHT; y++) {
-                            for (int x = 0; x < MAZE_WIDTH; x++) {
-                                maze[y][x] = initialMaze[y][x];
-                            }
-                        }
-                        Vector2 ghostResetTilePositions[MAX_GHOSTS] = {
-                            { 12.5f, 8.5f },
-                            { 12.5f, 8.5f },
-                            { 11.5f, 8.5f },
-                            { 13.5f, 8.5f }
-                        };
-                        for (int i = 0; i < activeGhostsCount; i++) {
-                            ghosts[i].position = (Vector2){ MAZE_DRAW_OFFSET_X + ghostResetTilePositions[i].x * TILE_SIZE, MAZE_DRAW_OFFSET_Y + ghostResetTilePositions[i].y * TILE_SIZE };
-                            ghosts[i].direction = (Vector2){ 0.0f, 0.0f };
+                        bool replayHasMore = playingReplay && replayCursor.run < replay.runCount;
+                        if ((!playingReplay || replayHasMore) && sim_next_level(&sim)) {
+                            // The recording carries on into the new level, so its seed still reproduces the whole game.
+                            if (gameRewind) rewind_reset(gameRewind, &sim);
+                            previousSim = sim;
+                            simAccumulator = 0.0f;
+                            currentState = GAMEPLAY;
+                        } else {
+                            playingReplay = false;
+                            if (recorder.file) replay_writer_close(&recorder, &sim);
+                            StartGame(&sim, &previousSim, map, selectedDifficulty, (uint32_t)rand(), &nav);
+                            currentState = START_SCREEN;
                         }
-                        currentState = START_SCREEN;
                     }
                 } break;
             }
 
-            BeginDrawing();
-
-            ClearBackground(BLACK);
-
-            switch (currentState) {
-                case START_SCREEN: {
-                    DrawText("PAC-MAN", screenWidth/2 - MeasureText("PAC-MAN", 60)/2, 40, 60, YELLOW);
-                    DrawText("Select Difficulty:", screenWidth/2 - MeasureText("Select Difficulty:", 30)/2, 120, 30, WHITE);
-                    DrawText("E - Easy (2 Ghosts)", screenWidth/2 - MeasureText("E - Easy (2 Ghosts)", 20)/2, 160, 20, (selectedDifficulty == EASY) ? YELLOW : GRAY);
-                    DrawText("N - Normal (3 Ghosts)", screenWidth/2 - MeasureText("N - Normal (3 Ghosts)", 20)/2, 190, 20, (selectedDifficulty == NORMAL) ? YELLOW : GRAY);
-                    DrawText("H - Hard (4 Ghosts)", screenWidth/2 - MeasureText("H - Hard (4 Ghosts)", 20)/2, 220, 20, (selectedDifficulty == HARD) ? YELLOW : GRAY);
-                    DrawText("Press [SPACE] to Start", screenWidth/2 - MeasureText("Press [SPACE] to Start", 30)/2, 280, 30, WHITE);
-                    DrawText("Use Arrow Keys to Move", screenWidth/2 - MeasureText("Use Arrow Keys to Move", 20)/2, 320, 20, GRAY);
-                    DrawText("Press [S] for Settings", screenWidth/2 - MeasureText("Press [S] for Settings", 20)/2, 350, 20, ORANGE);
-
-                    if (showSettingsMenu) {
-                        int boxWidth = (int)(440 * 1.2f);
-                        int boxHeight = (int)(240 * 1.2f);
-                        int boxX = screenWidth/2 - boxWidth/2;
-                        int boxY = 100;
-                        DrawRectangle(boxX, boxY, boxWidth, boxHeight, Fade(DARKGRAY, 0.95f));
-                        DrawRectangleLines(boxX, boxY, boxWidth, boxHeight, YELLOW);
-                        DrawText("SETTINGS", screenWidth/2 - MeasureText("SETTINGS", 48)/2, boxY + 20, 48, YELLOW);
-
-                        DrawText(TextFormat("Sound Volume: %.0f%%  [Up/Down]", soundVolume * 100), boxX + 32, boxY + 70, 28, WHITE);
-                        DrawText(TextFormat("Sound: %s  [A]", soundEnabled ? "ON" : "OFF"), boxX + 32, boxY + 110, 28, WHITE);
-                        DrawText(TextFormat("Music Volume: %.0f%%  [U/L]", musicVolume * 100), boxX + 32, boxY + 150, 28, WHITE);
-                        DrawText(TextFormat("Music: %s  [M]", musicEnabled ? "ON" : "OFF"), boxX + 32, boxY + 190, 28, WHITE);
-                        DrawText("Press [S] to Close Settings", boxX + 32, boxY + 230, 24, YELLOW);
-                    }
-                } break;
+            if (currentState == GAMEPLAY || currentState == REWIND) {
+                PROFILE_SCOPE(PROFILE_MAZE_DRAW);
+                UpdateMazeLayer(&mazeLayer, &sim.maze);
+            }
 
-                case GAMEPLAY: {
-                    for (int y = 0; y < MAZE_HEIGHT; y++) {
-                        for (int x = 0; x < MAZE_WIDTH; x++) {
-                            if (maze[y][x] == 1) {
-                                DrawRectangle(MAZE_DRAW_OFFSET_X + x * TILE_SIZE, MAZE_DRAW_OFFSET_Y + y * TILE_SIZE, TILE_SIZE, TILE_SIZE, BLUE);
-                            } else if (maze[y][x] == 2) {
-                                DrawCircle(MAZE_DRAW_OFFSET_X + x * TILE_SIZE + TILE_SIZE / 2, MAZE_DRAW_OFFSET_Y + y * TILE_SIZE + TILE_SIZE / 2, TILE_SIZE * 0.15f, WHITE);
-                            }
+            // The very first frame never waits, so time-to-first-frame isn't held up until the first key press.
+            bool nameDue = currentState == GAME_OVER && !playingReplay && IsHighScore(sim.score, selectedDifficulty);
+            bool wantIdle = IsIdleState(currentState, nameDue) && !activeProfiler && !launchTime;
+            if (wantIdle != idle) {
+                if (wantIdle) EnableEventWaiting();
+                else DisableEventWaiting();
+                idle = wantIdle;
+            }
+            bool redraw = true;
+            if (idle) {
+                MenuView view = CaptureMenuView(currentState, selectedDifficulty, highScoreViewDifficulty, sim.score, gameRewind && !playingReplay, &frame);
+                redraw = !menuDrawn || memcmp(&view, &drawnMenu, sizeof(view)) != 0;
+                drawnMenu = view;
+            }
+            menuDrawn = idle;
+
+            if (redraw) {
+                // Screens draw in layout pixels through uiCamera; the maze and sprites switch to the world camera.
+                Camera2D uiCamera = { 0 };
+                uiCamera.zoom = 1.0f;
+                uiCamera = FrameTargetCamera(&frame, uiCamera);
+                BeginFrameTarget(&frame);
+                BeginMode2D(uiCamera);
+
+                switch (currentState) {
+                    case START_SCREEN: {
+                        PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                        RefreshStartScreen(&screens, selectedDifficulty);
+                        DrawUiScreen(&screens.start);
+                        if (showSettingsMenu) DrawUiScreen(&screens.settings);
+                    } break;
+
+                    case HIGHSCORE_MENU: {
+                        PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                        RefreshHighScoreScreen(&screens, highScoreViewDifficulty);
+                        DrawUiScreen(&screens.highScores);
+                    } break;
+
+                    case REWIND:
+                    case GAMEPLAY: {
+                        float alpha = simAccumulator / SIM_TICK_TIME;
+                        if (alpha > 1.0f) alpha = 1.0f;
+
+                        Vector2 pacmanScreenPos = lerp_sim_position(previousSim.pacman.position, sim.pacman.position, alpha);
+                        Camera2D camera = FollowCamera(sim.map, pacmanScreenPos);
+                        Vector2 viewMin = GetScreenToWorld2D((Vector2){ 0.0f, 0.0f }, camera);
+                        Rectangle view = { viewMin.x, viewMin.y, (float)screenWidth, (float)screenHeight };
+
+                        BeginMode2D(FrameTargetCamera(&frame, camera));
+                        {
+                            PROFILE_SCOPE(PROFILE_MAZE_DRAW);
+                            if (mazeLayer.target.id > 0) DrawMazeLayer(&mazeLayer, view);
+                            else DrawMazeView(&sim.maze, TILE_SIZE, view);
                         }
-                    }
 
-                    float rotation = 0.0f;
-                    if (pacman.direction.x > 0) rotation = 0.0f;
-                    else if (pacman.direction.x < 0) rotation = 180.0f;
-                    else if (pacman.direction.y > 0) rotation = 90.0f;
-                    else if (pacman.direction.y < 0) rotation = 270.0f;
+                        PROFILE_SCOPE(PROFILE_ENTITY_DRAW);
+                        const SimPacman* pacman = &sim.pacman;
+                        float rotation = 0.0f;
+                        if (pacman->direction.x > 0) rotation = 0.0f;
+                        else if (pacman->direction.x < 0) rotation = 180.0f;
+                        else if (pacman->direction.y > 0) rotation = 90.0f;
+                        else if (pacman->direction.y < 0) rotation = 270.0f;
 
-                    Texture2D currentPacmanTexture = pacman.mouthOpen ? pacman.textureOpen : pacman.textureClosed;
+                        SpriteId pacmanSprite = pacman->mouthOpen ? SPRITE_PACMAN_OPEN : SPRITE_PACMAN_CLOSED;
 
-                    Rectangle sourceRec = { 0.0f, 0.0f, (float)currentPacmanTexture.width, (float)currentPacmanTexture.height };
-                    Rectangle destRec = { pacman.position.x, pacman.position.y, (float)TILE_SIZE, (float)TILE_SIZE };
-                    Vector2 origin = { (float)TILE_SIZE / 2.0f, (float)TILE_SIZE / 2.0f };
+                        Rectangle destRec = { pacmanScreenPos.x, pacmanScreenPos.y, (float)TILE_SIZE, (float)TILE_SIZE };
+                        Vector2 origin = { (float)TILE_SIZE / 2.0f, (float)TILE_SIZE / 2.0f };
 
-                    DrawTexturePro(currentPacmanTexture, sourceRec, destRec, origin, rotation, WHITE);
+                        DrawSprite(&spriteAtlas, pacmanSprite, destRec, origin, rotation);
 
 
-                    for (int i = 0; i < activeGhostsCount; i++) {
-                        float ghostScale = 1.0f;
-                        Rectangle ghostDestRec = {
-                            ghosts[i].position.x,
-                            ghosts[i].position.y,
-                            TILE_SIZE * ghostScale,
-                            TILE_SIZE * ghostScale
-                        };
-                        Vector2 ghostOrigin = { (float)TILE_SIZE * ghostScale / 2.0f, (float)TILE_SIZE * ghostScale / 2.0f };
-                        Rectangle ghostSourceRec = { 0.0f, 0.0f, (float)ghosts[i].texture.width, (float)ghosts[i].texture.height };
-                        DrawTexturePro(ghosts[i].texture, ghostSourceRec, ghostDestRec, ghostOrigin, 0.0f, WHITE);
-                    }
+                        for (int i = 0; i < sim.activeGhostsCount; i++) {
+                            float ghostScale = 1.0f;
+                            Vector2 ghostScreenPos = lerp_sim_position(previousSim.ghosts[i].position, sim.ghosts[i].position, alpha);
+                            if (!InView(view, ghostScreenPos)) continue;
+                            Rectangle ghostDestRec = {
+                                ghostScreenPos.x,
+                                ghostScreenPos.y,
+                                TILE_SIZE * ghostScale,
+                                TILE_SIZE * ghostScale
+                            };
+                            Vector2 ghostOrigin = { (float)TILE_SIZE * ghostScale / 2.0f, (float)TILE_SIZE * ghostScale / 2.0f };
+                            DrawSprite(&spriteAtlas, (SpriteId)(SPRITE_BLINKY + sim.ghosts[i].type), ghostDestRec, ghostOrigin, 0.0f);
+                        }
 
-                    DrawText(TextFormat("Score: %d", score), 10, 10, 20, WHITE);
-                } break;
+                        if (sim.swarm) {
+                            // All sprites share the atlas texture, so raylib batches the whole swarm into a few draw calls.
+                            const Swarm* s = sim.swarm;
+                            Vector2 swarmOrigin = { (float)TILE_SIZE / 2.0f, (float)TILE_SIZE / 2.0f };
+                            for (int i = 0; i < s->count; i++) {
+                                SimVec2 previous = { s->prevX[i], s->prevY[i] };
+                                SimVec2 current = { s->x[i], s->y[i] };
+                                Vector2 screenPos = lerp_sim_position(previous, current, alpha);
+                                if (!InView(view, screenPos)) continue;
+                                Rectangle swarmDestRec = { screenPos.x, screenPos.y, (float)TILE_SIZE, (float)TILE_SIZE };
+                                DrawSprite(&spriteAtlas, (SpriteId)(SPRITE_BLINKY + (i & 3)), swarmDestRec, swarmOrigin, 0.0f);
+                            }
+                        }
+                        BeginMode2D(uiCamera);
+
+                    } break;
+
+                    case GAME_OVER: {
+                        PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                        RefreshGameOverScreen(&screens, sim.score, selectedDifficulty, gameRewind && !playingReplay);
+                        DrawUiScreen(&screens.gameOver);
+                    } break;
+
+                    case ENTER_NAME: {
+                        PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                        SetUiText(&screens.enterName.texts[screens.enterNameField], playerName);
+                        DrawUiScreen(&screens.enterName);
+                    } break;
+
+                    case WIN_SCREEN: {
+                        PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                        RefreshWinScreen(&screens, selectedDifficulty, sim.level);
+                        DrawUiScreen(&screens.win);
+                    } break;
+                }
 
-                case GAME_OVER: {
-                    DrawText("GAME OVER", screenWidth/2 - MeasureText("GAME OVER", 50)/2, screenHeight/2 - 60, 50, RED);
-                    DrawText(TextFormat("Score: %d", score), screenWidth/2 - MeasureText(TextFormat("Score: %d", score), 30)/2, screenHeight/2, 30, WHITE);
-                    if (!IsHighScore(score, selectedDifficulty)) {
-                        DrawText("Press [R] to Restart or [ESC] to Menu", screenWidth/2 - MeasureText("Press [R] to Restart or [ESC] to Menu", 20)/2, screenHeight/2 + 40, 20, GRAY);
-                    } else {
-                        DrawText("NEW HIGH SCORE!", screenWidth/2 - MeasureText("NEW HIGH SCORE!", 30)/2, screenHeight/2 + 40, 30, ORANGE);
+                if (currentState == GAMEPLAY || currentState == REWIND) {
+                    PROFILE_SCOPE(PROFILE_TEXT_DRAW);
+                    RefreshHud(&screens, &sim, autopilotOn);
+                    DrawUiScreen(&screens.hud);
+                    if (currentState == REWIND) {
+                        RefreshRewindScreen(&screens, rewindTick, gameRewind->endTick);
+                        DrawUiScreen(&screens.rewind);
                     }
-                } break;
+                }
 
-                case ENTER_NAME: {
-                    DrawText("NEW HIGH SCORE!", screenWidth/2 - MeasureText("NEW HIGH SCORE!", 40)/2, screenHeight/2 - 80, 40, ORANGE);
-                    DrawText("Enter Your Name:", screenWidth/2 - 120, screenHeight/2 - 20, 30, WHITE);
-                    DrawRectangle(screenWidth/2 - 100, screenHeight/2 + 20, 200, 40, DARKGRAY);
-                    DrawText(playerName, screenWidth/2 - 90, screenHeight/2 + 25, 30, YELLOW);
-                    DrawText("Press [ENTER] to Confirm", screenWidth/2 - MeasureText("Press [ENTER] to Confirm", 20)/2, screenHeight/2 + 70, 20, GRAY);
-                } break;
+                EndMode2D();
+                EndFrameTarget();
+            }
 
-                case WIN_SCREEN: {
-                    const char* diffText = (selectedDifficulty == EASY) ? "EASY" :
-                                           (selectedDifficulty == NORMAL) ? "NORMAL" : "HARD";
-                    char winMsg[128];
-                    snprintf(winMsg, sizeof(winMsg), "You Win! %s Level Finished", diffText);
-                    DrawText(winMsg, screenWidth/2 - MeasureText(winMsg, 40)/2, screenHeight/2 - 40, 40, GREEN);
-                    DrawText("Returning to Menu...", screenWidth/2 - MeasureText("Returning to Menu...", 20)/2, screenHeight/2 + 20, 20, YELLOW);
-                } break;
+            {
+                PROFILE_SCOPE(PROFILE_PRESENT);
+                BeginDrawing();
+                DrawFrameTarget(&frame);
+                // Drawn at window resolution, so the numbers stay readable however low the frame goes.
+                if (showProfiler) {
+                    DrawProfilerOverlay(&profiler, gameEvents ? &eventTally : NULL, &frame, frame.windowWidth - 430, 10);
+                }
+                EndDrawing();
+            }
+            if (launchTime) {
+                ReportStartup(startupLog, (profiler_now_ns() - launchTime) / 1e6, (windowTime - launchTime) / 1e6, assetTime / 1e6, packedAssets);
+                launchTime = 0;
             }
 
-            EndDrawing();
+            if (activeProfiler) profiler_end_frame(&profiler);
         }
 
-        UnloadTexture(pacman.textureOpen);
-        UnloadTexture(pacman.textureClosed);
-        for(int i = 0; i < MAX_GHOSTS; i++) {
-            UnloadTexture(ghosts[i].texture);
+        activeProfiler = NULL;
+        profiler_stop_csv(&profiler);
+        if (recorder.file) replay_writer_close(&recorder, &sim);
+        if (replayFile && replay.runLengths) replay_free(&replay);
+        stressSwarm = NULL;
+        swarm_free(&swarm);
+
+        UnloadSpriteAtlas(&spriteAtlas);
+
+        UnloadMazeLayer(&mazeLayer);
+        UnloadFrameTarget(&frame);
+        bot_search_free(&autopilot);
+        gameRewind = NULL;
+        rewind_free(&rewindHistory);
+        if (gameEvents) {
+            sim.events = NULL;
+            gameEvents = NULL;
+            event_bus_free(&eventBus);
         }
+        nav_free(&nav);
+        sim_free(&sim);
+        maze_unload(&loadedMap);
+        leaderboard_close(&leaderboard);
 
-        UnloadSound(startSound);
-        UnloadSound(deathSound);
-        UnloadSound(eatSound);
-        UnloadMusicStream(bgMusic);
+        StopAudioSystem(&audio);
         CloseAudioDevice();
+        asset_close(&assets);
 
         CloseWindow();
 
@@ -0,0 +1,239 @@
+#include "maze.h"
+#include "filemap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "The .pmz planes are mapped as-is and assume a little-endian host"
+#endif
+
+static const int BUILTIN_WIDTH = 25;
+static const int BUILTIN_HEIGHT = 15;
+
+static const uint8_t builtinMaze[BUILTIN_HEIGHT][BUILTIN_WIDTH] = {
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
+    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
+    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
+    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
+    {1, 2, 1, 1, 1, 2, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 2, 1, 1, 1, 2, 1},
+    {1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1},
+    {1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1},
+    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
+    {1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1},
+    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
+    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
+    {1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 2, 1},
+    {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1},
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
+};
+
+static void put_u32(uint8_t* out, uint32_t value) { // Little-endian store.
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* in) { // Little-endian load.
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+    return value;
+}
+
+static int row_words(int width) { // Words needed for one plane row.
+    return (width + 63) / 64;
+}
+
+static bool spawn_ok(const MazeMap* map, int tileX, int tileY) { // Spawns must be open tiles inside the maze.
+    return !maze_map_is_wall(map, tileX, tileY);
+}
+
+static bool count_pellets(MazeMap* map) { // Sets pelletCount; rejects planes with bits set past the last column.
+    uint64_t tailMask = (map->width & 63) ? ~((1ull << (map->width & 63)) - 1) : 0;
+    map->pelletCount = 0;
+
+    for (int y = 0; y < map->height; y++) {
+        const uint64_t* walls = map->walls + (size_t)y * map->rowWords;
+        const uint64_t* pellets = map->pellets + (size_t)y * map->rowWords;
+        for (int w = 0; w < map->rowWords; w++) {
+            if (pellets[w] & walls[w]) return false;
+            map->pelletCount += __builtin_popcountll(pellets[w]);
+        }
+        if (pellets[map->rowWords - 1] & tailMask) return false;
+    }
+    return true;
+}
+
+bool maze_from_cells(MazeMap* map, int width, int height, const uint8_t* cells, int pacmanX, int pacmanY, int ghostX, int ghostY) { // Packs a cell grid into freshly allocated planes.
+    memset(map, 0, sizeof(*map));
+    if (width <= 0 || height <= 0 || width > MAZE_MAX_SIDE || height > MAZE_MAX_SIDE) return false;
+    if ((long long)width * height > MAZE_MAX_TILES) return false;
+
+    map->width = width;
+    map->height = height;
+    map->rowWords = row_words(width);
+
+    size_t planeWords = (size_t)height * map->rowWords;
+    map->owned = (uint64_t*)calloc(planeWords * 2, sizeof(uint64_t));
+    if (!map->owned) return false;
+
+    uint64_t* walls = map->owned;
+    uint64_t* pellets = map->owned + planeWords;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t cell = cells[(size_t)y * width + x];
+            uint64_t bit = 1ull << (x & 63);
+            size_t word = (size_t)y * map->rowWords + (x >> 6);
+            if (cell == 1) walls[word] |= bit;
+            if (cell == 2) pellets[word] |= bit;
+        }
+    }
+
+    map->walls = walls;
+    map->pellets = pellets;
+    map->pacmanX = pacmanX;
+    map->pacmanY = pacmanY;
+    map->ghostX = ghostX;
+    map->ghostY = ghostY;
+
+    if (!count_pellets(map) || !spawn_ok(map, pacmanX, pacmanY) || !spawn_ok(map, ghostX, ghostY)) {
+        maze_unload(map);
+        return false;
+    }
+    return true;
+}
+
+const MazeMap* maze_builtin(void) { // Built on first use; function-local statics are initialized once, even across threads.
+    static MazeMap map;
+    static const bool built = maze_from_cells(&map, BUILTIN_WIDTH, BUILTIN_HEIGHT, &builtinMaze[0][0], 1, 1, 12, 8);
+    (void)built;
+    return &map;
+}
+
+static uint8_t map_cell(const MazeMap* map, int x, int y) { // Inverse of maze_from_cells for one tile.
+    size_t word = (size_t)y * map->rowWords + (x >> 6);
+    uint64_t bit = 1ull << (x & 63);
+    if (map->walls[word] & bit) return 1;
+    if (map->pellets[word] & bit) return 2;
+    return 0;
+}
+
+bool maze_tile(MazeMap* map, const MazeMap* source, int repeatX, int repeatY) { // Copies the source grid and carves doors through the shared border walls.
+    if (repeatX <= 0 || repeatY <= 0 || repeatX > MAZE_MAX_SIDE || repeatY > MAZE_MAX_SIDE) return false;
+    // A seam is tested against the tile on either side of its two walls, so a repeated side needs at least three.
+    if ((repeatX > 1 && source->width < 3) || (repeatY > 1 && source->height < 3)) return false;
+    long long wideWidth = (long long)source->width * repeatX;
+    long long wideHeight = (long long)source->height * repeatY;
+    if (wideWidth > MAZE_MAX_SIDE || wideHeight > MAZE_MAX_SIDE || wideWidth * wideHeight > MAZE_MAX_TILES) return false;
+    int width = (int)wideWidth;
+    int height = (int)wideHeight;
+
+    uint8_t* cells = (uint8_t*)malloc((size_t)width * height);
+    if (!cells) return false;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            cells[(size_t)y * width + x] = map_cell(source, x % source->width, y % source->height);
+        }
+    }
+
+    // A seam is a pair of border walls; open it where the corridors on both sides line up.
+    int sw = source->width;
+    int sh = source->height;
+    for (int cx = 1; cx < repeatX; cx++) {
+        int left = cx * sw - 1;
+        for (int y = 0; y < height; y++) {
+            size_t row = (size_t)y * width;
+            if (cells[row + left] == 1 && cells[row + left + 1] == 1 && cells[row + left - 1] != 1 && cells[row + left + 2] != 1) {
+                cells[row + left] = 2;
+                cells[row + left + 1] = 2;
+            }
+        }
+    }
+    for (int cy = 1; cy < repeatY; cy++) {
+        int top = cy * sh - 1;
+        for (int x = 0; x < width; x++) {
+            if (cells[(size_t)top * width + x] == 1 && cells[(size_t)(top + 1) * width + x] == 1 &&
+                cells[(size_t)(top - 1) * width + x] != 1 && cells[(size_t)(top + 2) * width + x] != 1) {
+                cells[(size_t)top * width + x] = 2;
+                cells[(size_t)(top + 1) * width + x] = 2;
+            }
+        }
+    }
+
+    int ghostCopyX = repeatX / 2;
+    int ghostCopyY = repeatY / 2;
+    bool ok = maze_from_cells(map, width, height, cells, source->pacmanX, source->pacmanY,
+        ghostCopyX * sw + source->ghostX, ghostCopyY * sh + source->ghostY);
+    free(cells);
+    return ok;
+}
+
+bool maze_load(MazeMap* map, const char* fileName) { // Maps a .pmz file and points the planes straight into it.
+    memset(map, 0, sizeof(*map));
+
+    void* view = NULL;
+    size_t size = 0;
+    if (!file_map(fileName, &view, &size)) return false;
+
+    const uint8_t* bytes = (const uint8_t*)view;
+    bool ok = size >= MAZE_FILE_HEADER_SIZE && memcmp(bytes, MAZE_FILE_MAGIC, 4) == 0 && get_u32(bytes + 4) == MAZE_FILE_VERSION;
+
+    uint32_t width = ok ? get_u32(bytes + 8) : 0;
+    uint32_t height = ok ? get_u32(bytes + 12) : 0;
+    ok = ok && width > 0 && height > 0 && width <= MAZE_MAX_SIDE && height <= MAZE_MAX_SIDE && (uint64_t)width * height <= MAZE_MAX_TILES;
+
+    if (ok) {
+        map->width = (int)width;
+        map->height = (int)height;
+        map->rowWords = row_words(map->width);
+        size_t planeBytes = (size_t)map->height * map->rowWords * sizeof(uint64_t);
+        ok = size >= MAZE_FILE_HEADER_SIZE + 2 * planeBytes;
+
+        if (ok) {
+            map->walls = (const uint64_t*)(bytes + MAZE_FILE_HEADER_SIZE);
+            map->pellets = (const uint64_t*)(bytes + MAZE_FILE_HEADER_SIZE + planeBytes);
+            map->pacmanX = (int32_t)get_u32(bytes + 16);
+            map->pacmanY = (int32_t)get_u32(bytes + 20);
+            map->ghostX = (int32_t)get_u32(bytes + 24);
+            map->ghostY = (int32_t)get_u32(bytes + 28);
+            map->mapping = view;
+            map->mappingSize = size;
+            ok = count_pellets(map) && spawn_ok(map, map->pacmanX, map->pacmanY) && spawn_ok(map, map->ghostX, map->ghostY);
+        }
+    }
+
+    if (!ok) {
+        file_unmap(view, size);
+        memset(map, 0, sizeof(*map));
+    }
+    return ok;
+}
+
+bool maze_save(const MazeMap* map, const char* fileName) { // Writes the header and both planes.
+    FILE* file = fopen(fileName, "wb");
+    if (!file) return false;
+
+    uint8_t header[MAZE_FILE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, MAZE_FILE_MAGIC, 4);
+    put_u32(header + 4, MAZE_FILE_VERSION);
+    put_u32(header + 8, (uint32_t)map->width);
+    put_u32(header + 12, (uint32_t)map->height);
+    put_u32(header + 16, (uint32_t)map->pacmanX);
+    put_u32(header + 20, (uint32_t)map->pacmanY);
+    put_u32(header + 24, (uint32_t)map->ghostX);
+    put_u32(header + 28, (uint32_t)map->ghostY);
+
+    size_t planeWords = (size_t)map->height * map->rowWords;
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+        fwrite(map->walls, sizeof(uint64_t), planeWords, file) == planeWords &&
+        fwrite(map->pellets, sizeof(uint64_t), planeWords, file) == planeWords;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+void maze_unload(MazeMap* map) { // Frees or unmaps whatever backs the planes.
+    free(map->owned);
+    if (map->mapping) file_unmap(map->mapping, map->mappingSize);
+    memset(map, 0, sizeof(*map));
+}
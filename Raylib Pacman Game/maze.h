@@ -0,0 +1,78 @@
+#ifndef MAZE_H
+#define MAZE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Maze maps.
+// A MazeMap is the immutable description of a level: its size, a wall plane, the initial pellet plane and
+// the spawn tiles. Planes hold one bit per tile, packed row by row into 64-bit words.
+// Maps are either built in memory (the classic 25x15 maze) or loaded from a .pmz file, which is the
+// header below followed by the two planes exactly as they sit in memory: 2 bits per tile on disk, and
+// the file is memory-mapped so even very large maps open without being read or parsed.
+//
+// .pmz layout (little-endian): "PMAZ", u32 version, u32 width, u32 height,
+// i32 pacmanX, i32 pacmanY, i32 ghostX, i32 ghostY, zero padding to 64 bytes,
+// then height * rowWords u64 wall words, then as many pellet words.
+
+#define MAZE_FILE_MAGIC "PMAZ"
+#define MAZE_FILE_VERSION 1
+#define MAZE_FILE_HEADER_SIZE 64
+#define MAZE_MAX_SIDE 65536
+#define MAZE_MAX_TILES (1 << 30)  // Area cap: tile indices and counts stay inside an int everywhere
+
+typedef struct MazeMap {
+    int width;
+    int height;
+    int rowWords;             // 64-bit words per plane row
+    const uint64_t* walls;    // height * rowWords words
+    const uint64_t* pellets;  // Pellets at the start of a game, same layout
+    int pelletCount;
+    int pacmanX;              // Spawn tiles
+    int pacmanY;
+    int ghostX;
+    int ghostY;
+    uint64_t* owned;          // Heap planes for maps built in memory, NULL when mapped
+    void* mapping;            // File view for loaded maps, NULL when built in memory
+    size_t mappingSize;
+} MazeMap;
+
+// One game's view of its maze: shared read-only walls plus the pellets still on the board.
+typedef struct MazeBits {
+    int width;
+    int height;
+    int rowWords;
+    const uint64_t* walls;
+    uint64_t* pellets;
+    int pelletsLeft; // Kept in step with the pellet plane so the win check is O(1)
+} MazeBits;
+
+inline bool maze_is_wall(const MazeBits* maze, int tileX, int tileY) { // Bit test on the wall plane; the caller checks bounds.
+    return (maze->walls[(size_t)tileY * maze->rowWords + (tileX >> 6)] >> (tileX & 63)) & 1;
+}
+
+inline bool maze_has_pellet(const MazeBits* maze, int tileX, int tileY) { // Bit test on the pellet plane; the caller checks bounds.
+    return (maze->pellets[(size_t)tileY * maze->rowWords + (tileX >> 6)] >> (tileX & 63)) & 1;
+}
+
+inline bool maze_map_is_wall(const MazeMap* map, int tileX, int tileY) { // Wall test on a map; out-of-bounds tiles count as walls.
+    if (tileX < 0 || tileX >= map->width || tileY < 0 || tileY >= map->height) return true;
+    return (map->walls[(size_t)tileY * map->rowWords + (tileX >> 6)] >> (tileX & 63)) & 1;
+}
+
+// The classic 25x15 maze, built once and shared.
+const MazeMap* maze_builtin(void);
+
+// Builds a map from a row-major cell grid: 0 empty floor, 1 wall, 2 pellet.
+bool maze_from_cells(MazeMap* map, int width, int height, const uint8_t* cells, int pacmanX, int pacmanY, int ghostX, int ghostY);
+
+// Repeats a map repeatX x repeatY times, opening the seams wherever corridors meet, to build large test maps.
+// False for a source under 3 tiles along a repeated side, where there is no room for a seam.
+bool maze_tile(MazeMap* map, const MazeMap* source, int repeatX, int repeatY);
+
+bool maze_load(MazeMap* map, const char* fileName);
+bool maze_save(const MazeMap* map, const char* fileName);
+void maze_unload(MazeMap* map);
+
+#endif
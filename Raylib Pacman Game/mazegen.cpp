@@ -0,0 +1,221 @@
+#include "mazegen.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int MAZEGEN_LOOP_CHANCE = 6;     // One in this many walls left between two corridors is opened as a loop
+static const int MAZEGEN_CROSSING_CHANCE = 3; // One in this many rows gets a crossing over the centre column
+
+typedef struct MazeGen {
+    int width;      // Full map size
+    int height;
+    int spanX;      // Odd extent the lattice and the mirror use; an even map keeps its last column solid
+    int spanY;
+    int centerX;    // Mirror axis
+    uint8_t* cells; // maze_from_cells layout: 1 wall, 2 pellet
+    uint32_t rng;
+} MazeGen;
+
+static const int directions[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+static uint32_t gen_rand(MazeGen* gen) { // Generator-local xorshift32, so levels depend only on their seed.
+    uint32_t x = gen->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->rng = x;
+    return x;
+}
+
+static bool is_open(const MazeGen* gen, int x, int y) { // Carved tile test; everything outside the lattice is wall.
+    if (x < 0 || x >= gen->spanX || y < 0 || y >= gen->spanY) return false;
+    return gen->cells[(size_t)y * gen->width + x] != 1;
+}
+
+static void open_pair(MazeGen* gen, int x, int y) { // Carves a tile and its mirror image.
+    gen->cells[(size_t)y * gen->width + x] = 2;
+    gen->cells[(size_t)y * gen->width + (gen->spanX - 1 - x)] = 2;
+}
+
+static bool is_half_cell(const MazeGen* gen, int x, int y) { // Lattice cells (odd tiles) on the left of the axis or on it.
+    return x >= 1 && x <= gen->centerX && y >= 1 && y <= gen->spanY - 2;
+}
+
+static bool is_cell(const MazeGen* gen, int x, int y) { // Lattice cells anywhere in the maze.
+    return x >= 1 && x <= gen->spanX - 2 && y >= 1 && y <= gen->spanY - 2;
+}
+
+static int degree(const MazeGen* gen, int x, int y) { // Open neighbours of a tile.
+    int count = 0;
+    for (int d = 0; d < 4; d++) {
+        if (is_open(gen, x + directions[d][0], y + directions[d][1])) count++;
+    }
+    return count;
+}
+
+static bool carve_tree(MazeGen* gen) { // Randomized depth-first spanning tree over the left half's cells.
+    int* stack = (int*)malloc(((size_t)(gen->centerX / 2 + 1) * (gen->spanY / 2) + 1) * sizeof(int));
+    if (!stack) return false;
+
+    int top = 0;
+    open_pair(gen, 1, 1);
+    stack[top++] = gen->width + 1;
+
+    while (top > 0) {
+        int x = stack[top - 1] % gen->width;
+        int y = stack[top - 1] / gen->width;
+
+        int options[4];
+        int optionCount = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + 2 * directions[d][0];
+            int ny = y + 2 * directions[d][1];
+            if (is_half_cell(gen, nx, ny) && !is_open(gen, nx, ny)) options[optionCount++] = d;
+        }
+        if (optionCount == 0) {
+            top--;
+            continue;
+        }
+
+        int d = options[gen_rand(gen) % optionCount];
+        int nx = x + 2 * directions[d][0];
+        int ny = y + 2 * directions[d][1];
+        open_pair(gen, x + directions[d][0], y + directions[d][1]);
+        open_pair(gen, nx, ny);
+        stack[top++] = ny * gen->width + nx;
+    }
+
+    free(stack);
+    return true;
+}
+
+static void braid(MazeGen* gen) { // Knocks every dead end through to a neighbouring cell, preferring another dead end.
+    for (int y = 1; y <= gen->spanY - 2; y += 2) {
+        for (int x = 1; x <= gen->centerX; x += 2) {
+            if (degree(gen, x, y) != 1) continue;
+
+            int options[4];
+            int optionCount = 0;
+            int deadEnds[4];
+            int deadEndCount = 0;
+            for (int d = 0; d < 4; d++) {
+                int wallX = x + directions[d][0];
+                int wallY = y + directions[d][1];
+                int nx = x + 2 * directions[d][0];
+                int ny = y + 2 * directions[d][1];
+                if (!is_cell(gen, nx, ny) || is_open(gen, wallX, wallY)) continue;
+                options[optionCount++] = d;
+                if (degree(gen, nx, ny) == 1) deadEnds[deadEndCount++] = d;
+            }
+            if (optionCount == 0) continue;
+
+            int d = deadEndCount ? deadEnds[gen_rand(gen) % deadEndCount] : options[gen_rand(gen) % optionCount];
+            open_pair(gen, x + directions[d][0], y + directions[d][1]);
+        }
+    }
+}
+
+static void add_loops(MazeGen* gen) { // Opens a share of the remaining walls that separate two cells.
+    for (int y = 1; y <= gen->spanY - 2; y++) {
+        for (int x = 1; x <= gen->centerX; x++) {
+            // Walls between two cells sit on exactly one odd coordinate; even-even tiles are the pillars.
+            bool horizontal = (x & 1) == 0 && (y & 1) == 1;
+            bool vertical = (x & 1) == 1 && (y & 1) == 0;
+            if ((!horizontal && !vertical) || is_open(gen, x, y)) continue;
+            if (gen_rand(gen) % MAZEGEN_LOOP_CHANCE == 0) open_pair(gen, x, y);
+        }
+    }
+}
+
+bool maze_generate(MazeMap* map, int width, int height, uint32_t seed) { // Carves, braids, mirrors and validates one level.
+    memset(map, 0, sizeof(*map));
+    if (width < 7 || height < 5 || width > MAZE_MAX_SIDE || height > MAZE_MAX_SIDE) return false;
+    if ((long long)width * height > MAZE_MAX_TILES) return false;
+
+    MazeGen gen;
+    gen.width = width;
+    gen.height = height;
+    gen.spanX = (width & 1) ? width : width - 1;
+    gen.spanY = (height & 1) ? height : height - 1;
+    gen.centerX = (gen.spanX - 1) / 2;
+    gen.rng = seed ? seed : 0x9E3779B9u;
+    gen.cells = (uint8_t*)malloc((size_t)width * height);
+    if (!gen.cells) return false;
+    memset(gen.cells, 1, (size_t)width * height);
+
+    if (!carve_tree(&gen)) {
+        free(gen.cells);
+        return false;
+    }
+
+    int ghostY = ((gen.spanY - 1) / 2) | 1;
+    int pacmanY = gen.spanY - 2;
+    if (pacmanY == ghostY) pacmanY = 1;
+
+    // An odd axis runs through lattice cells, so the mirrored halves already share them. An even axis is a
+    // wall column: open it on the spawn rows, which also joins the two halves, and on a few random rows.
+    if ((gen.centerX & 1) == 0) {
+        for (int y = 1; y <= gen.spanY - 2; y += 2) {
+            if (y == ghostY || y == pacmanY || gen_rand(&gen) % MAZEGEN_CROSSING_CHANCE == 0) open_pair(&gen, gen.centerX, y);
+        }
+    }
+
+    braid(&gen);
+    add_loops(&gen);
+    gen.cells[(size_t)ghostY * width + gen.centerX] = 0;
+
+    bool ok = maze_from_cells(map, width, height, gen.cells, gen.centerX, pacmanY, gen.centerX, ghostY);
+    free(gen.cells);
+    if (ok && !maze_validate(map)) {
+        maze_unload(map);
+        ok = false;
+    }
+    return ok;
+}
+
+static bool plane_bit(const uint64_t* plane, int rowWords, int x, int y) { // Bit test on any plane.
+    return (plane[(size_t)y * rowWords + (x >> 6)] >> (x & 63)) & 1;
+}
+
+bool maze_validate(const MazeMap* map) { // BFS over open tiles from Pac-Man's spawn, then checks what was left unreached.
+    if (maze_map_is_wall(map, map->pacmanX, map->pacmanY) || maze_map_is_wall(map, map->ghostX, map->ghostY)) return false;
+
+    size_t planeWords = (size_t)map->height * map->rowWords;
+    uint64_t* reached = (uint64_t*)calloc(planeWords, sizeof(uint64_t));
+    size_t* queue = (size_t*)malloc((size_t)map->width * map->height * sizeof(size_t));
+    if (!reached || !queue) {
+        free(reached);
+        free(queue);
+        return false;
+    }
+
+    size_t head = 0;
+    size_t tail = 0;
+    queue[tail++] = (size_t)map->pacmanY * map->width + map->pacmanX;
+    reached[(size_t)map->pacmanY * map->rowWords + (map->pacmanX >> 6)] |= 1ull << (map->pacmanX & 63);
+
+    while (head < tail) {
+        int x = (int)(queue[head] % map->width);
+        int y = (int)(queue[head] / map->width);
+        head++;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + directions[d][0];
+            int ny = y + directions[d][1];
+            if (maze_map_is_wall(map, nx, ny) || plane_bit(reached, map->rowWords, nx, ny)) continue;
+            reached[(size_t)ny * map->rowWords + (nx >> 6)] |= 1ull << (nx & 63);
+            queue[tail++] = (size_t)ny * map->width + nx;
+        }
+    }
+    free(queue);
+
+    bool ok = plane_bit(reached, map->rowWords, map->ghostX, map->ghostY);
+    for (int dx = -1; dx <= 1 && ok; dx += 2) {
+        int x = map->ghostX + dx;
+        if (!maze_map_is_wall(map, x, map->ghostY) && !plane_bit(reached, map->rowWords, x, map->ghostY)) ok = false;
+    }
+    for (size_t w = 0; w < planeWords && ok; w++) {
+        if (map->pellets[w] & ~reached[w]) ok = false;
+    }
+
+    free(reached);
+    return ok;
+}
@@ -0,0 +1,20 @@
+#ifndef MAZEGEN_H
+#define MAZEGEN_H
+
+#include "maze.h"
+
+// Procedural levels.
+// maze_generate carves a left-right symmetric maze from a seed: a randomized depth-first spanning tree over
+// the odd tiles of the left half, then every dead end is knocked through to a neighbour ("braided") and a few
+// extra walls are opened for loops, and the half is mirrored. Corridors are one tile wide, as in the builtin
+// maze. Ghosts start in the middle of the centre column and Pac-Man at the bottom of it; every other floor
+// tile holds a pellet. A 25x15 level takes a few microseconds to generate and validate.
+// Sizes must be at least 7x5; with an even size the last column or row is solid wall.
+
+bool maze_generate(MazeMap* map, int width, int height, uint32_t seed);
+
+// Flood fill from Pac-Man's spawn: true when every pellet, the ghost tile and the open tiles beside it on the
+// same row (where ghosts may start) can be reached.
+bool maze_validate(const MazeMap* map);
+
+#endif
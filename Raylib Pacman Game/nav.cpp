@@ -0,0 +1,245 @@
+#include "nav.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void build_field(NavCache* nav, int slot, int target, uint32_t* field) { // Breadth-first search outward from the target tile.
+    if (nav->slotTouched) {
+        // Bounded fields start all-unreachable (see nav_init), so only the previous build's tiles need clearing.
+        int* touched = nav->slotTouched + (size_t)slot * nav->touchedCapacity;
+        for (int i = 0; i < nav->slotTouchedCount[slot]; i++) {
+            field[touched[i]] = NAV_UNREACHABLE;
+        }
+    } else {
+        for (int i = 0; i < nav->tileCount; i++) {
+            field[i] = NAV_UNREACHABLE;
+        }
+    }
+
+    int head = 0;
+    int tail = 0;
+    field[target] = 0;
+    nav->queue[tail++] = target;
+
+    // The target itself may be a wall (targets get clamped onto the border), so only its neighbours are tested.
+    while (head < tail) {
+        int tile = nav->queue[head++];
+        int x = tile % nav->width;
+        int y = tile / nav->width;
+        uint32_t next = field[tile] + 1;
+        if (next > nav->maxDepth) continue;
+
+        if (x + 1 < nav->width && !nav->walls[tile + 1] && field[tile + 1] == NAV_UNREACHABLE) {
+            field[tile + 1] = next;
+            nav->queue[tail++] = tile + 1;
+        }
+        if (x > 0 && !nav->walls[tile - 1] && field[tile - 1] == NAV_UNREACHABLE) {
+            field[tile - 1] = next;
+            nav->queue[tail++] = tile - 1;
+        }
+        if (y + 1 < nav->height && !nav->walls[tile + nav->width] && field[tile + nav->width] == NAV_UNREACHABLE) {
+            field[tile + nav->width] = next;
+            nav->queue[tail++] = tile + nav->width;
+        }
+        if (y > 0 && !nav->walls[tile - nav->width] && field[tile - nav->width] == NAV_UNREACHABLE) {
+            field[tile - nav->width] = next;
+            nav->queue[tail++] = tile - nav->width;
+        }
+    }
+
+    // Every tile the search reached passed through the queue, which makes it the touched list.
+    if (nav->slotTouched) {
+        memcpy(nav->slotTouched + (size_t)slot * nav->touchedCapacity, nav->queue, tail * sizeof(int));
+        nav->slotTouchedCount[slot] = tail;
+    }
+}
+
+static bool build_graph(NavCache* nav) { // Exit masks for every tile, then one straight walk per node exit.
+    free(nav->edges);
+    nav->edges = NULL;
+    nav->nodeCount = 0;
+
+    for (int tile = 0; tile < nav->tileCount; tile++) {
+        int x = tile % nav->width;
+        int y = tile / nav->width;
+        uint8_t exits = 0;
+        if (!nav->walls[tile]) {
+            if (x + 1 < nav->width && !nav->walls[tile + 1]) exits |= NAV_EXIT_RIGHT;
+            if (x > 0 && !nav->walls[tile - 1]) exits |= NAV_EXIT_LEFT;
+            if (y > 0 && !nav->walls[tile - nav->width]) exits |= NAV_EXIT_UP;
+            if (y + 1 < nav->height && !nav->walls[tile + nav->width]) exits |= NAV_EXIT_DOWN;
+        }
+        nav->exits[tile] = exits;
+        nav->nodeOfTile[tile] = (!nav->walls[tile] && nav_is_node(exits)) ? nav->nodeCount++ : -1;
+    }
+
+    nav->edges = (NavEdge*)malloc((size_t)(nav->nodeCount ? nav->nodeCount : 1) * 4 * sizeof(NavEdge));
+    if (!nav->edges) return false;
+
+    // A straight tile's only exits are ahead and behind, so a walk from a node always ends on the next one.
+    const int steps[4] = { 1, -1, -nav->width, nav->width };
+    for (int tile = 0; tile < nav->tileCount; tile++) {
+        int node = nav->nodeOfTile[tile];
+        if (node < 0) continue;
+        for (int e = 0; e < 4; e++) {
+            NavEdge* edge = &nav->edges[(size_t)node * 4 + e];
+            edge->node = -1;
+            edge->length = 0;
+            if (!(nav->exits[tile] & (1 << e))) continue;
+            int next = tile + steps[e];
+            int length = 1;
+            while (nav->nodeOfTile[next] < 0) {
+                next += steps[e];
+                length++;
+            }
+            edge->node = nav->nodeOfTile[next];
+            edge->length = length;
+        }
+    }
+    nav->graphVersion = nav->wallVersion;
+    return true;
+}
+
+bool nav_init(NavCache* nav, int width, int height, const uint8_t* walls, size_t maxBytes) { // Allocates the cache and precomputes every field when they all fit.
+    memset(nav, 0, sizeof(*nav));
+    // Tiles are indexed with ints throughout; maps are capped well below this (MAZE_MAX_TILES).
+    if (width <= 0 || height <= 0 || (long long)width * height > INT_MAX) return false;
+    nav->width = width;
+    nav->height = height;
+    nav->tileCount = width * height;
+
+    size_t fieldBytes = (size_t)nav->tileCount * sizeof(uint32_t);
+    size_t slots = maxBytes / fieldBytes;
+    if (slots < 4) slots = 4;
+    if (slots > (size_t)nav->tileCount) slots = nav->tileCount;
+    nav->slotCount = (int)slots;
+
+    nav->walls = (uint8_t*)malloc(nav->tileCount);
+    nav->fields = (uint32_t*)malloc(slots * fieldBytes);
+    nav->slotTarget = (int*)malloc(slots * sizeof(int));
+    nav->slotVersion = (uint32_t*)malloc(slots * sizeof(uint32_t));
+    nav->slotLastUse = (uint32_t*)malloc(slots * sizeof(uint32_t));
+    nav->targetSlot = (int*)malloc(nav->tileCount * sizeof(int));
+    nav->queue = (int*)malloc(nav->tileCount * sizeof(int));
+    nav->exits = (uint8_t*)malloc(nav->tileCount);
+    nav->nodeOfTile = (int*)malloc(nav->tileCount * sizeof(int));
+    nav->maxDepth = NAV_UNREACHABLE;
+
+    if (!nav->walls || !nav->fields || !nav->slotTarget || !nav->slotVersion || !nav->slotLastUse || !nav->targetSlot || !nav->queue ||
+        !nav->exits || !nav->nodeOfTile) {
+        nav_free(nav);
+        return false;
+    }
+
+    if (nav->tileCount > NAV_BOUNDED_TILES && nav->slotCount < nav->tileCount) {
+        // At most 2d^2 + 2d + 1 tiles lie within d steps of the target.
+        nav->maxDepth = NAV_BOUNDED_DEPTH;
+        nav->touchedCapacity = 2 * NAV_BOUNDED_DEPTH * NAV_BOUNDED_DEPTH + 2 * NAV_BOUNDED_DEPTH + 1;
+        nav->slotTouched = (int*)malloc(slots * nav->touchedCapacity * sizeof(int));
+        nav->slotTouchedCount = (int*)calloc(slots, sizeof(int));
+        if (!nav->slotTouched || !nav->slotTouchedCount) {
+            nav_free(nav);
+            return false;
+        }
+        for (size_t i = 0; i < slots * nav->tileCount; i++) {
+            nav->fields[i] = NAV_UNREACHABLE;
+        }
+    }
+
+    for (int i = 0; i < nav->tileCount; i++) {
+        nav->walls[i] = walls[i] ? 1 : 0;
+        nav->targetSlot[i] = -1;
+    }
+    for (int s = 0; s < nav->slotCount; s++) {
+        nav->slotTarget[s] = -1;
+        nav->slotLastUse[s] = 0;
+    }
+    if (!build_graph(nav)) {
+        nav_free(nav);
+        return false;
+    }
+
+    if (nav->slotCount == nav->tileCount) {
+        for (int t = 0; t < nav->tileCount; t++) {
+            nav->slotTarget[t] = t;
+            nav->targetSlot[t] = t;
+            nav->slotVersion[t] = nav->wallVersion;
+            build_field(nav, t, t, nav->fields + (size_t)t * nav->tileCount);
+        }
+    }
+
+    return true;
+}
+
+void nav_free(NavCache* nav) { // Releases everything nav_init allocated.
+    free(nav->walls);
+    free(nav->fields);
+    free(nav->slotTarget);
+    free(nav->slotVersion);
+    free(nav->slotLastUse);
+    free(nav->targetSlot);
+    free(nav->queue);
+    free(nav->slotTouched);
+    free(nav->slotTouchedCount);
+    free(nav->exits);
+    free(nav->nodeOfTile);
+    free(nav->edges);
+    memset(nav, 0, sizeof(*nav));
+}
+
+void nav_set_wall(NavCache* nav, int tileX, int tileY, bool wall) { // Updates one tile; cached fields go stale only if it actually changed.
+    if (tileX < 0 || tileX >= nav->width || tileY < 0 || tileY >= nav->height) return;
+
+    int tile = tileY * nav->width + tileX;
+    uint8_t value = wall ? 1 : 0;
+    if (nav->walls[tile] == value) return;
+
+    nav->walls[tile] = value;
+    nav->wallVersion++;
+}
+
+bool nav_update_graph(NavCache* nav) { // Rebuilds only when a wall changed since the last build.
+    if (nav->edges && nav->graphVersion == nav->wallVersion) return true;
+    return build_graph(nav);
+}
+
+int nav_run_length(const NavCache* nav, int tileX, int tileY, int exit) { // Edge length from the graph, or a single tile.
+    if (!nav->edges || nav->graphVersion != nav->wallVersion) return 1;
+    int node = nav->nodeOfTile[(size_t)tileY * nav->width + tileX];
+    if (node < 0) return 1;
+    int length = nav->edges[(size_t)node * 4 + nav_exit_index(exit)].length;
+    return length > 0 ? length : 1;
+}
+
+const uint32_t* nav_field(NavCache* nav, int targetX, int targetY) { // Returns the cached field for a target, building or refreshing it if needed.
+    if (targetX < 0) targetX = 0;
+    if (targetX >= nav->width) targetX = nav->width - 1;
+    if (targetY < 0) targetY = 0;
+    if (targetY >= nav->height) targetY = nav->height - 1;
+
+    int target = targetY * nav->width + targetX;
+    int slot = nav->targetSlot[target];
+    nav->useClock++;
+
+    if (slot < 0) {
+        slot = 0;
+        for (int s = 1; s < nav->slotCount && nav->slotTarget[slot] >= 0; s++) {
+            if (nav->slotTarget[s] < 0 || nav->slotLastUse[s] < nav->slotLastUse[slot]) slot = s;
+        }
+        if (nav->slotTarget[slot] >= 0) {
+            nav->targetSlot[nav->slotTarget[slot]] = -1;
+        }
+        nav->slotTarget[slot] = target;
+        nav->targetSlot[target] = slot;
+        nav->slotVersion[slot] = nav->wallVersion - 1;
+    }
+
+    uint32_t* field = nav->fields + (size_t)slot * nav->tileCount;
+    if (nav->slotVersion[slot] != nav->wallVersion) {
+        build_field(nav, slot, target, field);
+        nav->slotVersion[slot] = nav->wallVersion;
+    }
+    nav->slotLastUse[slot] = nav->useClock;
+
+    return field;
+}
@@ -0,0 +1,85 @@
+#ifndef NAV_H
+#define NAV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wall-aware path distances for ghost steering.
+// A distance field holds the BFS step count from one target tile to every tile of the maze.
+// Fields are cached per target: small mazes keep every field (all-pairs), large ones keep the
+// most recently used few. Changing a wall only marks fields stale; each is rebuilt when next used.
+// On very large maps a field only reaches NAV_BOUNDED_DEPTH steps from its target, so a rebuild touches
+// a few thousand tiles instead of the whole map; tiles further out read as NAV_UNREACHABLE.
+//
+// The cache also compiles the walls into a junction graph. Every tile gets a mask of its open neighbours,
+// and every open tile where a walker's heading can change (a junction, a corner or a dead end) is a node;
+// the straight corridors between nodes are edges weighted by their length in tiles. A walker leaving a
+// node therefore knows how far it is to the next one and needs no look at the maze until it gets there.
+
+#define NAV_EXIT_RIGHT 0x1
+#define NAV_EXIT_LEFT 0x2
+#define NAV_EXIT_UP 0x4
+#define NAV_EXIT_DOWN 0x8
+
+#define NAV_UNREACHABLE 0xFFFFFFFFu
+#define NAV_DEFAULT_BUDGET (16u * 1024 * 1024)
+#define NAV_BOUNDED_TILES (256 * 256) // Maps larger than this get depth-bounded fields
+#define NAV_BOUNDED_DEPTH 64
+
+typedef struct NavEdge {
+    int node;   // Node at the far end, -1 where the exit is closed
+    int length; // Tiles to it
+} NavEdge;
+
+typedef struct NavCache {
+    int width;
+    int height;
+    int tileCount;
+    uint8_t* walls;          // 1 for wall tiles, row-major
+    int slotCount;
+    uint32_t* fields;        // slotCount fields of tileCount distances each
+    int* slotTarget;         // Target tile of each slot, -1 when unused
+    uint32_t* slotVersion;   // wallVersion the slot was built against
+    uint32_t* slotLastUse;
+    int* targetSlot;         // Slot holding each target tile's field, -1 when not cached
+    int* queue;              // BFS scratch
+    uint32_t maxDepth;       // Distance limit of every field, NAV_UNREACHABLE when unbounded
+    int* slotTouched;        // Bounded fields: tiles each slot set, so a rebuild clears only those
+    int* slotTouchedCount;
+    int touchedCapacity;
+    uint32_t wallVersion;
+    const uint64_t* mapWalls; // Wall plane the simulation last copied in, so a level change knows to resync
+    uint32_t useClock;
+    uint8_t* exits;          // Open neighbours of every tile as NAV_EXIT_* bits, 0 on walls
+    int* nodeOfTile;         // Node index of every node tile, -1 on straight corridors and walls
+    NavEdge* edges;          // Four per node, in NAV_EXIT_* bit order
+    int nodeCount;
+    uint32_t graphVersion;   // wallVersion the graph was built against
+} NavCache;
+
+inline bool nav_is_node(uint8_t exits) { // Anything but a straight corridor: junctions, corners, dead ends.
+    return exits != (NAV_EXIT_RIGHT | NAV_EXIT_LEFT) && exits != (NAV_EXIT_UP | NAV_EXIT_DOWN);
+}
+
+inline int nav_exit_index(int exit) { // Position of a single NAV_EXIT_* bit.
+    return (exit & NAV_EXIT_RIGHT) ? 0 : (exit & NAV_EXIT_LEFT) ? 1 : (exit & NAV_EXIT_UP) ? 2 : 3;
+}
+
+// Builds a cache for a width x height grid; walls[y * width + x] is non-zero for walls.
+// maxBytes bounds the memory spent on fields; mazes that fit get every field precomputed.
+bool nav_init(NavCache* nav, int width, int height, const uint8_t* walls, size_t maxBytes);
+void nav_free(NavCache* nav);
+
+// Leaves the junction graph stale until the next nav_update_graph.
+void nav_set_wall(NavCache* nav, int tileX, int tileY, bool wall);
+// Recompiles exit masks and junction graph after wall changes; false (and no edges) if memory runs out.
+bool nav_update_graph(NavCache* nav);
+// Tiles from a node along an open exit to the next node. Tiles off the graph, and a cache without one, give 1,
+// so walkers fall back to deciding at every tile centre.
+int nav_run_length(const NavCache* nav, int tileX, int tileY, int exit);
+
+// Distance field towards a target tile (walls included as a target), built on a cache miss.
+const uint32_t* nav_field(NavCache* nav, int targetX, int targetY);
+
+#endif
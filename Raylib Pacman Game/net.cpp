@@ -0,0 +1,984 @@
+#include "net.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NetHandle;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NetHandle;
+#endif
+
+enum {
+    NET_PACKET_CONNECT = 1,
+    NET_PACKET_WELCOME,
+    NET_PACKET_REJECT,
+    NET_PACKET_INPUT,
+    NET_PACKET_SNAPSHOT,
+    NET_PACKET_DISCONNECT
+};
+
+// Snapshot flags.
+#define NET_SNAPSHOT_DELTA 0x1      // Everything not sent is as in the base tick's frame
+#define NET_SNAPSHOT_PLANE 0x2      // The raw pellet plane follows, instead of the tiles eaten since the base
+
+// Changed-mask bits: the frame header, then one per entity, then one per player score.
+#define NET_CHANGED_HEADER 0x1
+#define NET_CHANGED_ENTITY(i) (0x2 << (i))
+#define NET_CHANGED_SCORE(p) (0x2 << (NET_ENTITY_COUNT + (p)))
+
+static const int NET_TOKEN_SLOT_BITS = 2;   // Enough for SIM_MAX_PLAYERS
+static const int NET_TOKEN_SESSION_BITS = 14;
+static const int NET_CONNECT_RETRY_TICKS = SIM_TICKS_PER_SECOND / 2;
+static const int NET_POSITION_SHIFT = 1; // Positions travel halved; every speed is even, so every position the sim produces is too
+
+// Sockets.
+
+bool net_startup(void) { // WSAStartup on Windows.
+#if defined(_WIN32)
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void net_shutdown(void) { // WSACleanup on Windows.
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+bool net_open(NetSocket* sock, uint16_t port) { // Non-blocking UDP socket bound to every interface.
+    sock->handle = -1;
+    NetHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if defined(_WIN32)
+    if (handle == INVALID_SOCKET) return false;
+    u_long nonBlocking = 1;
+    ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+    if (handle < 0) return false;
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    sock->handle = (intptr_t)handle;
+
+    // A server drains its socket once per tick; give it room for a tick's worth of every client's inputs.
+    int bufferSize = 1 << 20;
+    setsockopt(handle, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(handle, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        net_close(sock);
+        return false;
+    }
+    return true;
+}
+
+void net_close(NetSocket* sock) { // Safe on a closed socket.
+    if (sock->handle == -1) return;
+#if defined(_WIN32)
+    closesocket((NetHandle)sock->handle);
+#else
+    close((NetHandle)sock->handle);
+#endif
+    sock->handle = -1;
+}
+
+bool net_resolve(const char* host, uint16_t port, NetAddress* address) { // First IPv4 address of a host name or dotted quad.
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result) return false;
+    address->host = ntohl(((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+    address->port = port;
+    freeaddrinfo(result);
+    return true;
+}
+
+bool net_send(NetSocket* sock, const NetAddress* to, const uint8_t* data, int size) { // One datagram; a full send buffer just drops it, as the network might.
+    struct sockaddr_in remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(to->host);
+    remote.sin_port = htons(to->port);
+    return sendto((NetHandle)sock->handle, (const char*)data, size, 0, (struct sockaddr*)&remote, sizeof(remote)) == size;
+}
+
+int net_receive(NetSocket* sock, NetAddress* from, uint8_t* data, int capacity) { // Next waiting datagram, -1 when there is none.
+    for (;;) {
+        struct sockaddr_in remote;
+        socklen_t length = sizeof(remote);
+        int size = (int)recvfrom((NetHandle)sock->handle, (char*)data, capacity, 0, (struct sockaddr*)&remote, &length);
+        if (size < 0) {
+#if defined(_WIN32)
+            // Windows reports an earlier send to a closed port here; that's no reason to stop reading.
+            if (WSAGetLastError() == WSAECONNRESET) continue;
+#endif
+            return -1;
+        }
+        from->host = ntohl(remote.sin_addr.s_addr);
+        from->port = ntohs(remote.sin_port);
+        return size;
+    }
+}
+
+static bool same_address(const NetAddress* a, const NetAddress* b) { // Host and port both match.
+    return a->host == b->host && a->port == b->port;
+}
+
+// Packet writing and reading. Writers and readers latch a flag instead of failing each call, so a packet is
+// checked once at the end.
+
+typedef struct NetWriter {
+    uint8_t* data;
+    int size;
+    int capacity;
+    bool overflow;
+} NetWriter;
+
+typedef struct NetReader {
+    const uint8_t* data;
+    int size;
+    int offset;
+    bool bad;
+} NetReader;
+
+static void write_u8(NetWriter* writer, uint8_t value) { // One byte.
+    if (writer->size + 1 > writer->capacity) {
+        writer->overflow = true;
+        return;
+    }
+    writer->data[writer->size++] = value;
+}
+
+static void write_u16(NetWriter* writer, uint16_t value) { // Little-endian store.
+    write_u8(writer, (uint8_t)value);
+    write_u8(writer, (uint8_t)(value >> 8));
+}
+
+static void write_u32(NetWriter* writer, uint32_t value) { // Little-endian store.
+    for (int i = 0; i < 4; i++) write_u8(writer, (uint8_t)(value >> (8 * i)));
+}
+
+static void write_varint(NetWriter* writer, uint32_t value) { // Seven bits per byte, high bit set on all but the last.
+    while (value >= 0x80) {
+        write_u8(writer, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    write_u8(writer, (uint8_t)value);
+}
+
+static uint8_t read_u8(NetReader* reader) { // One byte, 0 past the end.
+    if (reader->offset + 1 > reader->size) {
+        reader->bad = true;
+        return 0;
+    }
+    return reader->data[reader->offset++];
+}
+
+static uint16_t read_u16(NetReader* reader) { // Little-endian load.
+    uint16_t value = read_u8(reader);
+    return (uint16_t)(value | (read_u8(reader) << 8));
+}
+
+static uint32_t read_u32(NetReader* reader) { // Little-endian load.
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)read_u8(reader) << (8 * i);
+    return value;
+}
+
+static uint32_t read_varint(NetReader* reader) { // Inverse of write_varint; more than five bytes is a bad packet.
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t byte = read_u8(reader);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    reader->bad = true;
+    return 0;
+}
+
+// Frames.
+
+static uint32_t wall_hash(const MazeMap* map) { // 32-bit FNV-1a over the wall plane, so client and server agree on the maze.
+    const uint8_t* bytes = (const uint8_t*)map->walls;
+    size_t size = (size_t)map->height * map->rowWords * sizeof(uint64_t);
+    uint32_t hash = 0x811C9DC5u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+static uint8_t dir_code(SimVec2 direction) { // Unit heading to its SimDir.
+    if (direction.x > 0) return SIM_DIR_RIGHT;
+    if (direction.x < 0) return SIM_DIR_LEFT;
+    if (direction.y < 0) return SIM_DIR_UP;
+    if (direction.y > 0) return SIM_DIR_DOWN;
+    return SIM_DIR_NONE;
+}
+
+static SimVec2 dir_vector(uint8_t code) { // SimDir back to a unit heading.
+    switch (code) {
+        case SIM_DIR_RIGHT: return (SimVec2){ 1, 0 };
+        case SIM_DIR_LEFT: return (SimVec2){ -1, 0 };
+        case SIM_DIR_UP: return (SimVec2){ 0, -1 };
+        case SIM_DIR_DOWN: return (SimVec2){ 0, 1 };
+        default: return (SimVec2){ 0, 0 };
+    }
+}
+
+static NetEntity pack_entity(SimVec2 position, SimVec2 direction, SimVec2 nextDirection) { // Packs one entity for the wire, losslessly.
+    NetEntity entity;
+    entity.x = (uint16_t)(position.x >> NET_POSITION_SHIFT);
+    entity.y = (uint16_t)(position.y >> NET_POSITION_SHIFT);
+    entity.dirs = (uint8_t)(dir_code(direction) | (dir_code(nextDirection) << 3));
+    return entity;
+}
+
+static void unpack_entity(const NetEntity* entity, SimVec2* position, SimVec2* direction, SimVec2* nextDirection) { // Inverse of pack_entity.
+    position->x = (int32_t)entity->x << NET_POSITION_SHIFT;
+    position->y = (int32_t)entity->y << NET_POSITION_SHIFT;
+    *direction = dir_vector(entity->dirs & 7);
+    if (nextDirection) *nextDirection = dir_vector((entity->dirs >> 3) & 7);
+}
+
+static bool entity_equal(const NetEntity* a, const NetEntity* b) { // Field by field; the struct has padding.
+    return a->x == b->x && a->y == b->y && a->dirs == b->dirs;
+}
+
+static bool ring_init(NetFrameRing* ring, const MazeMap* map) { // One plane per slot, all frames invalid.
+    memset(ring->frames, 0, sizeof(ring->frames));
+    ring->planeWords = (size_t)map->height * map->rowWords;
+    ring->planes = (uint64_t*)calloc(NET_HISTORY * ring->planeWords, sizeof(uint64_t));
+    return ring->planes != NULL;
+}
+
+static void ring_free(NetFrameRing* ring) { // Releases the planes.
+    free(ring->planes);
+    ring->planes = NULL;
+}
+
+static NetFrame* ring_slot(NetFrameRing* ring, uint32_t tick) { // Where the frame of a tick goes.
+    return &ring->frames[(tick / NET_SNAPSHOT_TICKS) % NET_HISTORY];
+}
+
+static NetFrame* ring_find(NetFrameRing* ring, uint32_t tick) { // The frame of exactly that tick, NULL once overwritten.
+    NetFrame* frame = ring_slot(ring, tick);
+    return frame->valid && frame->tick == tick ? frame : NULL;
+}
+
+static uint64_t* ring_plane(NetFrameRing* ring, const NetFrame* frame) { // A frame's pellet plane.
+    return ring->planes + (size_t)(frame - ring->frames) * ring->planeWords;
+}
+
+// Snapshot body after the fixed header: the header fields when NET_CHANGED_HEADER is set (u32 seed, u16 level,
+// u8 status, ghost count, alive mask, player mask), 5 bytes per changed entity (u16 x, u16 y, u8 dirs), an
+// i32 per changed score, then the pellets: with NET_SNAPSHOT_PLANE the plane words as u64s, otherwise a varint
+// count of tiles eaten since the base and their row-major indices as varint gaps.
+static int encode_snapshot(NetFrameRing* ring, const NetFrame* frame, const NetFrame* base, const MazeMap* map, uint32_t inputsConsumed, uint8_t* out, int capacity) { // Returns the packet size, 0 if it didn't fit.
+    if (base && (base->seed != frame->seed || base->level != frame->level)) base = NULL; // New maze, nothing to diff against
+
+    uint16_t mask = 0;
+    if (!base || base->seed != frame->seed || base->level != frame->level || base->status != frame->status ||
+        base->ghostCount != frame->ghostCount || base->aliveMask != frame->aliveMask || base->playerMask != frame->playerMask) {
+        mask |= NET_CHANGED_HEADER;
+    }
+    for (int i = 0; i < NET_ENTITY_COUNT; i++) {
+        if (!base || !entity_equal(&base->entities[i], &frame->entities[i])) mask |= NET_CHANGED_ENTITY(i);
+    }
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        if (!base || base->scores[p] != frame->scores[p]) mask |= NET_CHANGED_SCORE(p);
+    }
+
+    NetWriter writer = { out, 0, capacity, false };
+    write_u8(&writer, NET_PACKET_SNAPSHOT);
+    write_u32(&writer, frame->tick);
+    write_u32(&writer, base ? base->tick : 0);
+    write_u8(&writer, base ? NET_SNAPSHOT_DELTA : NET_SNAPSHOT_PLANE);
+    write_u32(&writer, inputsConsumed);
+    write_u16(&writer, mask);
+
+    if (mask & NET_CHANGED_HEADER) {
+        write_u32(&writer, frame->seed);
+        write_u16(&writer, frame->level);
+        write_u8(&writer, frame->status);
+        write_u8(&writer, frame->ghostCount);
+        write_u8(&writer, frame->aliveMask);
+        write_u8(&writer, frame->playerMask);
+    }
+    for (int i = 0; i < NET_ENTITY_COUNT; i++) {
+        if (!(mask & NET_CHANGED_ENTITY(i))) continue;
+        write_u16(&writer, frame->entities[i].x);
+        write_u16(&writer, frame->entities[i].y);
+        write_u8(&writer, frame->entities[i].dirs);
+    }
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        if (mask & NET_CHANGED_SCORE(p)) write_u32(&writer, (uint32_t)frame->scores[p]);
+    }
+
+    const uint64_t* plane = ring_plane(ring, frame);
+    if (!base) {
+        for (size_t w = 0; w < ring->planeWords; w++) {
+            write_u32(&writer, (uint32_t)plane[w]);
+            write_u32(&writer, (uint32_t)(plane[w] >> 32));
+        }
+    } else {
+        // Pellets only ever disappear within a level, so the difference is exactly the tiles eaten.
+        const uint64_t* basePlane = ring_plane(ring, base);
+        uint32_t eaten = 0;
+        for (size_t w = 0; w < ring->planeWords; w++) {
+            for (uint64_t bits = basePlane[w] & ~plane[w]; bits; bits &= bits - 1) eaten++;
+        }
+        write_varint(&writer, eaten);
+        uint32_t previous = 0;
+        for (int y = 0; y < map->height; y++) {
+            for (int word = 0; word < map->rowWords; word++) {
+                size_t w = (size_t)y * map->rowWords + word;
+                for (uint64_t bits = basePlane[w] & ~plane[w]; bits; bits &= bits - 1) {
+                    int bit = 0;
+                    while (!((bits >> bit) & 1)) bit++;
+                    uint32_t tile = (uint32_t)y * map->width + word * 64 + bit;
+                    write_varint(&writer, tile - previous);
+                    previous = tile;
+                }
+            }
+        }
+    }
+    return writer.overflow ? 0 : writer.size;
+}
+
+// Server.
+
+static uint32_t server_rand(NetServer* server) { // xorshift32, for token salt.
+    uint32_t x = server->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    server->rng = x;
+    return x;
+}
+
+static void place_session_players(NetSession* session) { // Everyone connected back on the spawn.
+    sim_place_players(&session->state, session->players, SIM_MAX_PLAYERS);
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        if (!session->peers[p].connected) session->players[p].alive = false;
+    }
+}
+
+static bool start_game(NetServer* server, NetSession* session) { // A new board and seed, scores back to zero.
+    int index = (int)(session - server->sessions);
+    uint32_t seed = server->seed + (uint32_t)index * 1000003u + (uint32_t)session->games * 7919u;
+    sim_free(&session->state);
+    if (!sim_init(&session->state, server->map, server->difficulty, seed, &session->nav)) return false;
+    session->games++;
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) session->players[p].score = 0;
+    place_session_players(session);
+    return true;
+}
+
+static bool open_session(NetServer* server, NetSession* session) { // Activates a free slot; its nav cache and frame ring are kept for reuse.
+    if (!session->navReady) {
+        if (!sim_init_nav(&session->nav, server->map)) return false;
+        session->navReady = true;
+    }
+    if (!session->history.planes && !ring_init(&session->history, server->map)) return false;
+    memset(session->history.frames, 0, sizeof(session->history.frames));
+    memset(session->peers, 0, sizeof(session->peers));
+    memset(session->players, 0, sizeof(session->players));
+    session->peerCount = 0;
+    if (!start_game(server, session)) return false;
+    session->active = true;
+    return true;
+}
+
+static void close_session(NetSession* session) { // Frees the board once the last player has left.
+    sim_free(&session->state);
+    session->active = false;
+}
+
+static void drop_peer(NetSession* session, int slot) { // The player leaves the board; everyone else plays on.
+    session->peers[slot].connected = false;
+    session->players[slot].alive = false;
+    session->peerCount--;
+}
+
+static void send_packet(NetServer* server, const NetAddress* to, const uint8_t* data, int size) { // Sends and counts.
+    if (net_send(&server->socket, to, data, size)) {
+        server->stats.packetsOut++;
+        server->stats.bytesOut += size;
+    }
+}
+
+static void send_welcome(NetServer* server, const NetPeer* peer, int slot) { // Tells a client its token and which player it is.
+    uint8_t packet[32];
+    NetWriter writer = { packet, 0, (int)sizeof(packet), false };
+    write_u8(&writer, NET_PACKET_WELCOME);
+    write_u32(&writer, peer->token);
+    write_u8(&writer, (uint8_t)slot);
+    write_u8(&writer, (uint8_t)server->difficulty);
+    write_u16(&writer, (uint16_t)server->map->width);
+    write_u16(&writer, (uint16_t)server->map->height);
+    write_u32(&writer, server->wallHash);
+    send_packet(server, &peer->address, packet, writer.size);
+}
+
+static void send_reject(NetServer* server, const NetAddress* to) { // Full, or speaking another protocol.
+    uint8_t packet = NET_PACKET_REJECT;
+    send_packet(server, to, &packet, 1);
+}
+
+static void handle_connect(NetServer* server, const NetAddress* from, NetReader* reader) { // Seats a new client in the first session with room.
+    if (read_u32(reader) != NET_PROTOCOL_MAGIC || read_u8(reader) != NET_PROTOCOL_VERSION || reader->bad) {
+        send_reject(server, from);
+        return;
+    }
+
+    // Clients repeat connect until welcomed, so one we already seated just gets its welcome again.
+    for (int s = 0; s < server->sessionCapacity; s++) {
+        NetSession* session = &server->sessions[s];
+        if (!session->active) continue;
+        for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+            if (session->peers[p].connected && same_address(&session->peers[p].address, from)) {
+                send_welcome(server, &session->peers[p], p);
+                return;
+            }
+        }
+    }
+
+    NetSession* target = NULL;
+    for (int s = 0; s < server->sessionCapacity && !target; s++) {
+        if (server->sessions[s].active && server->sessions[s].peerCount < server->playersPerSession) target = &server->sessions[s];
+    }
+    for (int s = 0; s < server->sessionCapacity && !target; s++) {
+        if (!server->sessions[s].active && open_session(server, &server->sessions[s])) target = &server->sessions[s];
+    }
+    if (!target) {
+        send_reject(server, from);
+        return;
+    }
+
+    int slot = 0;
+    while (target->peers[slot].connected) slot++;
+    NetPeer* peer = &target->peers[slot];
+    memset(peer, 0, sizeof(*peer));
+    peer->connected = true;
+    peer->address = *from;
+    peer->token = (server_rand(server) << (NET_TOKEN_SESSION_BITS + NET_TOKEN_SLOT_BITS)) |
+        ((uint32_t)(target - server->sessions) << NET_TOKEN_SLOT_BITS) | (uint32_t)slot;
+    peer->lastHeard = server->tick;
+    target->peerCount++;
+
+    // Joining mid-level: on the spawn with a fresh score, the board carries on for everyone else.
+    sim_place_players(&target->state, &target->players[slot], 1);
+    target->players[slot].score = 0;
+
+    server->stats.connects++;
+    send_welcome(server, peer, slot);
+}
+
+static NetPeer* find_peer(NetServer* server, uint32_t token, const NetAddress* from, NetSession** session, int* slot) { // Decodes the token; NULL unless it names a connected peer at that address.
+    uint32_t index = (token >> NET_TOKEN_SLOT_BITS) & ((1u << NET_TOKEN_SESSION_BITS) - 1);
+    int peerSlot = (int)(token & ((1u << NET_TOKEN_SLOT_BITS) - 1));
+    if (index >= (uint32_t)server->sessionCapacity || peerSlot >= SIM_MAX_PLAYERS) return NULL;
+    NetSession* owner = &server->sessions[index];
+    NetPeer* peer = &owner->peers[peerSlot];
+    if (!owner->active || !peer->connected || peer->token != token || !same_address(&peer->address, from)) return NULL;
+    *session = owner;
+    *slot = peerSlot;
+    return peer;
+}
+
+static void handle_input(NetServer* server, const NetAddress* from, NetReader* reader) { // Queues new inputs and records the client's ack.
+    uint32_t token = read_u32(reader);
+    bool hasAck = read_u8(reader) != 0;
+    uint32_t ackTick = read_u32(reader);
+    uint32_t firstSeq = read_u32(reader);
+    int count = read_u8(reader);
+    if (reader->bad) return;
+
+    NetSession* session;
+    int slot;
+    NetPeer* peer = find_peer(server, token, from, &session, &slot);
+    if (!peer) return;
+    peer->lastHeard = server->tick;
+    if (hasAck && (!peer->hasAck || ackTick > peer->ackTick)) {
+        peer->hasAck = true;
+        peer->ackTick = ackTick;
+    }
+
+    if (firstSeq + (uint32_t)count > peer->nextInput + NET_INPUT_QUEUE) {
+        // More than a queue ahead of us (we stalled, or its clock ran away): carry on from this packet.
+        peer->nextInput = firstSeq;
+        peer->receivedInput = firstSeq;
+    }
+    for (int i = 0; i < count; i++) {
+        uint8_t direction = read_u8(reader);
+        if (reader->bad || direction > SIM_DIR_DOWN) return;
+        uint32_t seq = firstSeq + (uint32_t)i;
+        // Already consumed, or so far ahead it would overwrite inputs still queued.
+        if (seq < peer->nextInput || seq >= peer->nextInput + NET_INPUT_QUEUE) continue;
+        peer->inputs[seq % NET_INPUT_QUEUE] = direction;
+        if (seq + 1 > peer->receivedInput) peer->receivedInput = seq + 1;
+    }
+}
+
+static void handle_packet(NetServer* server, const NetAddress* from, const uint8_t* data, int size) { // Dispatches on the type byte.
+    NetReader reader = { data, size, 0, false };
+    uint8_t type = read_u8(&reader);
+    if (type == NET_PACKET_CONNECT) {
+        handle_connect(server, from, &reader);
+    } else if (type == NET_PACKET_INPUT) {
+        handle_input(server, from, &reader);
+    } else if (type == NET_PACKET_DISCONNECT) {
+        NetSession* session;
+        int slot;
+        if (find_peer(server, read_u32(&reader), from, &session, &slot) && !reader.bad) {
+            drop_peer(session, slot);
+            if (session->peerCount == 0) close_session(session);
+        }
+    }
+}
+
+static void step_session(NetServer* server, NetSession* session) { // Moves a finished board on, then plays one tick with each peer's next input.
+    if (session->state.status == SIM_WON) {
+        if (sim_next_level(&session->state)) {
+            place_session_players(session);
+        } else if (!start_game(server, session)) {
+            close_session(session);
+            return;
+        }
+    } else if (session->state.status == SIM_DEAD && !start_game(server, session)) {
+        close_session(session);
+        return;
+    }
+
+    SimInput inputs[SIM_MAX_PLAYERS];
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        NetPeer* peer = &session->peers[p];
+        if (peer->connected) {
+            // A backlog means the client's clock runs ahead of ours; skip to its newest inputs so its
+            // latency doesn't keep growing.
+            if (peer->receivedInput - peer->nextInput > 2 * NET_INPUT_REDUNDANCY) peer->nextInput = peer->receivedInput - NET_INPUT_REDUNDANCY;
+            if (peer->nextInput < peer->receivedInput) {
+                peer->held = (SimDir)peer->inputs[peer->nextInput % NET_INPUT_QUEUE];
+                peer->nextInput++;
+            }
+        }
+        inputs[p].direction = peer->connected ? peer->held : SIM_DIR_NONE;
+    }
+    sim_step_players(&session->state, session->players, SIM_MAX_PLAYERS, inputs);
+}
+
+static NetFrame* capture_frame(NetServer* server, NetSession* session) { // Records the session as of this tick in its ring.
+    const SimState* state = &session->state;
+    NetFrame* frame = ring_slot(&session->history, server->tick);
+    memset(frame, 0, sizeof(*frame));
+    frame->tick = server->tick;
+    frame->valid = true;
+    frame->seed = state->seed;
+    frame->level = (uint16_t)state->level;
+    frame->status = (uint8_t)state->status;
+    frame->ghostCount = (uint8_t)state->activeGhostsCount;
+
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        if (!session->peers[p].connected) continue;
+        const SimPlayer* player = &session->players[p];
+        frame->playerMask |= (uint8_t)(1 << p);
+        if (player->alive) frame->aliveMask |= (uint8_t)(1 << p);
+        frame->scores[p] = player->score;
+        frame->entities[p] = pack_entity(player->pacman.position, player->pacman.direction, player->pacman.nextDirection);
+    }
+    for (int i = 0; i < state->activeGhostsCount; i++) {
+        frame->entities[SIM_MAX_PLAYERS + i] = pack_entity(state->ghosts[i].position, state->ghosts[i].direction, (SimVec2){ 0, 0 });
+    }
+    memcpy(ring_plane(&session->history, frame), state->maze.pellets, session->history.planeWords * sizeof(uint64_t));
+    return frame;
+}
+
+bool net_server_init(NetServer* server, const MazeMap* map, Difficulty difficulty, uint32_t seed, uint16_t port, int maxSessions, int playersPerSession) { // Binds the port and allocates every session slot.
+    memset(server, 0, sizeof(*server));
+    server->socket.handle = -1;
+    if ((size_t)map->height * map->rowWords * sizeof(uint64_t) > NET_MAX_PLANE_BYTES) return false;
+    if (((long)map->width * SIM_TILE_SIZE >> NET_POSITION_SHIFT) > 0xFFFF || ((long)map->height * SIM_TILE_SIZE >> NET_POSITION_SHIFT) > 0xFFFF) return false;
+
+    if (maxSessions < 1) maxSessions = 1;
+    if (maxSessions > (1 << NET_TOKEN_SESSION_BITS)) maxSessions = 1 << NET_TOKEN_SESSION_BITS;
+    if (playersPerSession < 1) playersPerSession = 1;
+    if (playersPerSession > SIM_MAX_PLAYERS) playersPerSession = SIM_MAX_PLAYERS;
+
+    server->map = map;
+    server->difficulty = difficulty;
+    server->seed = seed;
+    server->wallHash = wall_hash(map);
+    server->rng = seed ? seed : 0x9E3779B9u;
+    server->sessionCapacity = maxSessions;
+    server->playersPerSession = playersPerSession;
+    server->sessions = (NetSession*)calloc(maxSessions, sizeof(NetSession));
+    if (!server->sessions || !net_open(&server->socket, port)) {
+        net_server_free(server);
+        return false;
+    }
+    return true;
+}
+
+void net_server_free(NetServer* server) { // Closes the socket and every session.
+    for (int s = 0; server->sessions && s < server->sessionCapacity; s++) {
+        NetSession* session = &server->sessions[s];
+        if (session->active) close_session(session);
+        if (session->navReady) nav_free(&session->nav);
+        ring_free(&session->history);
+    }
+    free(server->sessions);
+    server->sessions = NULL;
+    net_close(&server->socket);
+}
+
+void net_server_tick(NetServer* server) { // Receive, step, snapshot.
+    server->tick++;
+
+    uint8_t packet[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = net_receive(&server->socket, &from, packet, sizeof(packet))) >= 0) {
+        server->stats.packetsIn++;
+        server->stats.bytesIn += size;
+        handle_packet(server, &from, packet, size);
+    }
+
+    bool snapshotDue = server->tick % NET_SNAPSHOT_TICKS == 0;
+    for (int s = 0; s < server->sessionCapacity; s++) {
+        NetSession* session = &server->sessions[s];
+        if (!session->active) continue;
+
+        for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+            if (session->peers[p].connected && server->tick - session->peers[p].lastHeard > NET_TIMEOUT_TICKS) {
+                drop_peer(session, p);
+                server->stats.timeouts++;
+            }
+        }
+        if (session->peerCount == 0) {
+            close_session(session);
+            continue;
+        }
+
+        step_session(server, session);
+        if (!session->active || !snapshotDue) continue;
+
+        NetFrame* frame = capture_frame(server, session);
+        for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+            NetPeer* peer = &session->peers[p];
+            if (!peer->connected) continue;
+            const NetFrame* base = peer->hasAck ? ring_find(&session->history, peer->ackTick) : NULL;
+            int packetSize = encode_snapshot(&session->history, frame, base, server->map, peer->nextInput, packet, sizeof(packet));
+            if (packetSize == 0) continue;
+            send_packet(server, &peer->address, packet, packetSize);
+            server->stats.snapshots++;
+            if (packet[9] & NET_SNAPSHOT_PLANE) server->stats.fullSnapshots++;
+        }
+    }
+}
+
+int net_server_sessions(const NetServer* server) { // Sessions with at least one player.
+    int count = 0;
+    for (int s = 0; s < server->sessionCapacity; s++) count += server->sessions[s].active;
+    return count;
+}
+
+int net_server_players(const NetServer* server) { // Connected clients across every session.
+    int count = 0;
+    for (int s = 0; s < server->sessionCapacity; s++) {
+        if (server->sessions[s].active) count += server->sessions[s].peerCount;
+    }
+    return count;
+}
+
+// Client.
+
+static uint32_t client_rand(NetClient* client) { // xorshift32, for simulated loss.
+    uint32_t x = client->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    client->rng = x;
+    return x;
+}
+
+static void send_to_server(NetClient* client, const uint8_t* data, int size) { // Sends and counts.
+    if (net_send(&client->socket, &client->server, data, size)) {
+        client->stats.packetsOut++;
+        client->stats.bytesOut += size;
+    }
+}
+
+bool net_client_init(NetClient* client, const MazeMap* map, const NetAddress* server, uint32_t seed) { // Socket and frame ring; connecting starts on the first tick.
+    memset(client, 0, sizeof(*client));
+    client->socket.handle = -1;
+    client->server = *server;
+    client->map = map;
+    client->rng = seed ? seed : 0x9E3779B9u;
+    if (!ring_init(&client->history, map) || !net_open(&client->socket, 0)) {
+        net_client_free(client);
+        return false;
+    }
+    return true;
+}
+
+void net_client_free(NetClient* client) { // Says goodbye if connected, then releases everything.
+    if (client->connected && client->socket.handle != -1) {
+        uint8_t packet[5];
+        NetWriter writer = { packet, 0, (int)sizeof(packet), false };
+        write_u8(&writer, NET_PACKET_DISCONNECT);
+        write_u32(&writer, client->token);
+        send_to_server(client, packet, writer.size);
+    }
+    if (client->worldReady) sim_free(&client->world);
+    client->worldReady = false;
+    client->connected = false;
+    ring_free(&client->history);
+    net_close(&client->socket);
+}
+
+static void handle_welcome(NetClient* client, NetReader* reader) { // Takes our token and player slot if the maze matches ours.
+    uint32_t token = read_u32(reader);
+    int slot = read_u8(reader);
+    int difficulty = read_u8(reader);
+    int width = read_u16(reader);
+    int height = read_u16(reader);
+    uint32_t hash = read_u32(reader);
+    if (reader->bad || client->connected) return;
+    if (slot >= SIM_MAX_PLAYERS || difficulty >= DIFFICULTY_COUNT || width != client->map->width ||
+        height != client->map->height || hash != wall_hash(client->map)) {
+        client->rejected = true;
+        return;
+    }
+    client->token = token;
+    client->self = slot;
+    client->difficulty = (Difficulty)difficulty;
+    client->connected = true;
+}
+
+static NetFrame* decode_snapshot(NetClient* client, NetReader* reader, uint32_t* inputsConsumed) { // Rebuilds the sent frame in our ring; NULL when stale, malformed or missing its base.
+    uint32_t tick = read_u32(reader);
+    uint32_t baseTick = read_u32(reader);
+    uint8_t flags = read_u8(reader);
+    *inputsConsumed = read_u32(reader);
+    uint16_t mask = read_u16(reader);
+    if (reader->bad || (client->hasFrame && tick <= client->newestTick)) return NULL;
+
+    NetFrameRing* ring = &client->history;
+    NetFrame* base = NULL;
+    if (flags & NET_SNAPSHOT_DELTA) {
+        base = ring_find(ring, baseTick);
+        if (!base) {
+            client->stats.dropped++;
+            return NULL;
+        }
+    }
+
+    NetFrame frame;
+    if (base) {
+        frame = *base;
+    } else {
+        memset(&frame, 0, sizeof(frame));
+    }
+    if (mask & NET_CHANGED_HEADER) {
+        frame.seed = read_u32(reader);
+        frame.level = read_u16(reader);
+        frame.status = read_u8(reader);
+        frame.ghostCount = read_u8(reader);
+        frame.aliveMask = read_u8(reader);
+        frame.playerMask = read_u8(reader);
+    }
+    for (int i = 0; i < NET_ENTITY_COUNT; i++) {
+        if (!(mask & NET_CHANGED_ENTITY(i))) continue;
+        frame.entities[i].x = read_u16(reader);
+        frame.entities[i].y = read_u16(reader);
+        frame.entities[i].dirs = read_u8(reader);
+    }
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        if (mask & NET_CHANGED_SCORE(p)) frame.scores[p] = (int32_t)read_u32(reader);
+    }
+    if (reader->bad || frame.ghostCount > MAX_GHOSTS) return NULL;
+
+    // Slots of frames less than NET_HISTORY snapshots apart never collide, so the base survives this.
+    NetFrame* target = ring_slot(ring, tick);
+    target->valid = false;
+    uint64_t* plane = ring_plane(ring, target);
+    if (flags & NET_SNAPSHOT_PLANE) {
+        for (size_t w = 0; w < ring->planeWords; w++) {
+            uint64_t low = read_u32(reader);
+            plane[w] = low | ((uint64_t)read_u32(reader) << 32);
+        }
+    } else {
+        if (base) memcpy(plane, ring_plane(ring, base), ring->planeWords * sizeof(uint64_t));
+        uint32_t eaten = read_varint(reader);
+        uint32_t tile = 0;
+        uint32_t tileCount = (uint32_t)client->map->width * client->map->height;
+        for (uint32_t i = 0; i < eaten && !reader->bad; i++) {
+            tile += read_varint(reader);
+            if (tile >= tileCount) {
+                reader->bad = true;
+                break;
+            }
+            int x = (int)(tile % client->map->width);
+            int y = (int)(tile / client->map->width);
+            plane[(size_t)y * client->map->rowWords + (x >> 6)] &= ~(1ull << (x & 63));
+        }
+    }
+    if (reader->bad) return NULL;
+
+    frame.tick = tick;
+    frame.valid = true;
+    *target = frame;
+    return target;
+}
+
+static void apply_frame(NetClient* client, NetFrame* frame, uint32_t inputsConsumed) { // Mirrors a new newest frame into the world and reconciles our prediction.
+    SimState* world = &client->world;
+    bool predicting = client->worldReady && (client->players[client->self].alive);
+
+    // The maze follows from the seed and level exactly as on the server.
+    if (!client->worldReady || world->seed != frame->seed || world->level > frame->level) {
+        if (client->worldReady) sim_free(world);
+        client->worldReady = sim_init(world, client->map, client->difficulty, frame->seed, NULL);
+        if (!client->worldReady) return;
+        predicting = false;
+    }
+    while (world->level < frame->level) {
+        if (!sim_next_level(world)) return;
+        predicting = false;
+    }
+
+    const uint64_t* plane = ring_plane(&client->history, frame);
+    int pellets = 0;
+    for (size_t w = 0; w < client->history.planeWords; w++) {
+        world->maze.pellets[w] = plane[w];
+        for (uint64_t bits = plane[w]; bits; bits &= bits - 1) pellets++;
+    }
+    world->maze.pelletsLeft = pellets;
+    world->status = (SimStatus)frame->status;
+    world->activeGhostsCount = frame->ghostCount;
+    for (int i = 0; i < frame->ghostCount; i++) {
+        unpack_entity(&frame->entities[SIM_MAX_PLAYERS + i], &world->ghosts[i].position, &world->ghosts[i].direction, NULL);
+    }
+
+    client->playerMask = frame->playerMask;
+    for (int p = 0; p < SIM_MAX_PLAYERS; p++) {
+        SimPlayer* player = &client->players[p];
+        player->pacman = world->pacman; // Speed, radius and animation rate are the same for everyone
+        unpack_entity(&frame->entities[p], &player->pacman.position, &player->pacman.direction, &player->pacman.nextDirection);
+        player->score = frame->scores[p];
+        player->alive = (frame->aliveMask >> p) & 1;
+    }
+
+    // Reconciliation: start from where the server had us and replay every input it hadn't consumed yet.
+    SimPlayer* self = &client->players[client->self];
+    if (self->alive) {
+        SimPacman pacman = self->pacman;
+        uint32_t first = inputsConsumed;
+        if (first > client->inputSeq) first = client->inputSeq;
+        if (client->inputSeq - first > NET_INPUT_HISTORY) first = client->inputSeq - NET_INPUT_HISTORY;
+        for (uint32_t seq = first; seq < client->inputSeq; seq++) {
+            SimInput input = { (SimDir)client->inputs[seq % NET_INPUT_HISTORY] };
+            sim_walk_pacman(&world->maze, &pacman, input, 1);
+        }
+        client->stats.pendingSum += client->inputSeq - first;
+
+        double dx = pacman.position.x - world->pacman.position.x;
+        double dy = pacman.position.y - world->pacman.position.y;
+        if (predicting && (dx != 0.0 || dy != 0.0)) {
+            client->stats.corrections++;
+            client->stats.correctionSum += sqrt(dx * dx + dy * dy) / SIM_TILE_SIZE;
+        }
+        world->pacman = pacman;
+        self->pacman = pacman;
+    }
+}
+
+bool net_client_tick(NetClient* client, SimInput input) { // Receive, predict, send.
+    client->ticks++;
+
+    uint8_t packet[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = net_receive(&client->socket, &from, packet, sizeof(packet))) >= 0) {
+        if (!same_address(&from, &client->server)) continue;
+        client->stats.packetsIn++;
+        client->stats.bytesIn += size;
+        client->lastHeard = client->ticks;
+
+        NetReader reader = { packet, size, 0, false };
+        uint8_t type = read_u8(&reader);
+        if (type == NET_PACKET_WELCOME) {
+            handle_welcome(client, &reader);
+        } else if (type == NET_PACKET_REJECT) {
+            if (!client->connected) client->rejected = true;
+        } else if (type == NET_PACKET_SNAPSHOT && client->connected) {
+            if (client->dropPercent > 0 && (int)(client_rand(client) % 100) < client->dropPercent) {
+                client->stats.dropped++;
+                continue;
+            }
+            uint32_t inputsConsumed;
+            NetFrame* frame = decode_snapshot(client, &reader, &inputsConsumed);
+            if (!frame) continue;
+            client->stats.snapshots++;
+            if (packet[9] & NET_SNAPSHOT_PLANE) client->stats.fullSnapshots++;
+            client->hasFrame = true;
+            client->newestTick = frame->tick;
+            apply_frame(client, frame, inputsConsumed);
+        }
+    }
+
+    if (client->rejected || client->ticks - client->lastHeard > NET_TIMEOUT_TICKS) return false;
+
+    if (!client->connected) {
+        if ((client->ticks - 1) % NET_CONNECT_RETRY_TICKS == 0) {
+            uint8_t connect[8];
+            NetWriter writer = { connect, 0, (int)sizeof(connect), false };
+            write_u8(&writer, NET_PACKET_CONNECT);
+            write_u32(&writer, NET_PROTOCOL_MAGIC);
+            write_u8(&writer, NET_PROTOCOL_VERSION);
+            send_to_server(client, connect, writer.size);
+        }
+        return true;
+    }
+
+    // Prediction: our own Pac-Man moves now, the server's verdict arrives a round trip later.
+    client->inputs[client->inputSeq % NET_INPUT_HISTORY] = (uint8_t)input.direction;
+    client->inputSeq++;
+    SimPlayer* self = &client->players[client->self];
+    if (client->worldReady && self->alive && client->world.status == SIM_PLAYING) {
+        sim_walk_pacman(&client->world.maze, &client->world.pacman, input, 1);
+        self->pacman = client->world.pacman;
+    }
+
+    int count = client->inputSeq < NET_INPUT_REDUNDANCY ? (int)client->inputSeq : NET_INPUT_REDUNDANCY;
+    uint32_t firstSeq = client->inputSeq - (uint32_t)count;
+    NetWriter writer = { packet, 0, (int)sizeof(packet), false };
+    write_u8(&writer, NET_PACKET_INPUT);
+    write_u32(&writer, client->token);
+    write_u8(&writer, client->hasFrame ? 1 : 0);
+    write_u32(&writer, client->newestTick);
+    write_u32(&writer, firstSeq);
+    write_u8(&writer, (uint8_t)count);
+    for (uint32_t seq = firstSeq; seq < client->inputSeq; seq++) write_u8(&writer, client->inputs[seq % NET_INPUT_HISTORY]);
+    send_to_server(client, packet, writer.size);
+    return true;
+}
@@ -0,0 +1,199 @@
+#ifndef NET_H
+#define NET_H
+
+#include "sim.h"
+
+// Networked multiplayer over UDP.
+// The server runs every board authoritatively: sessions of up to SIM_MAX_PLAYERS Pac-Men sharing one maze
+// (sim_step_players), all stepped at SIM_TICKS_PER_SECOND on one thread. Clients only send inputs, each packet
+// repeating the last few ticks' so a lost packet costs nothing, and get a snapshot every NET_SNAPSHOT_TICKS.
+//
+// Snapshots are deltas against the newest snapshot the client has acknowledged: the server keeps the last
+// NET_HISTORY frames of every session, and a snapshot carries only the entities and scores that changed since
+// that frame plus the pellets eaten in between. Positions travel as half maze units and headings as 3-bit
+// SimDirs, so an entity costs 5 bytes; a typical snapshot is 40-70 bytes, about 2 KB/s per client with UDP
+// headers. A client with no usable baseline (joining, or after losing a second of packets) gets a full
+// snapshot carrying the raw pellet plane instead, which is why net boards are limited to NET_MAX_PLANE_BYTES.
+//
+// Each client predicts its own Pac-Man from its inputs (sim_walk_pacman, the server's own movement) and shows
+// everything else as last received. When a snapshot arrives it restarts from the server's Pac-Man there and
+// replays the inputs the server hadn't consumed yet; the two only disagree when inputs arrived late.
+//
+// Packets (little-endian, first byte is the type):
+//   connect    c->s  u32 magic, u8 version
+//   welcome    s->c  u32 token, u8 player, u8 difficulty, u16 width, u16 height, u32 wall hash
+//   reject     s->c  (server full or a different protocol)
+//   input      c->s  u32 token, u8 has ack, u32 acked snapshot tick, u32 first input seq, u8 count, count SimDirs
+//   snapshot   s->c  u32 tick, u32 base tick, u8 flags, u32 inputs consumed, u16 changed mask, then the fields
+//                    the mask names and the pellets (see net.cpp)
+//   disconnect c->s  u32 token
+// Tokens carry the session and player slot in their low bits, so the server finds a sender without a search.
+
+#define NET_PROTOCOL_MAGIC 0x544E4D50u // "PMNT"
+#define NET_PROTOCOL_VERSION 2
+#define NET_DEFAULT_PORT 7777
+#define NET_MAX_PACKET 1200
+#define NET_MAX_PLANE_BYTES 1024      // A full snapshot must fit one packet
+#define NET_SNAPSHOT_TICKS 3          // 20 snapshots per second
+#define NET_HISTORY 32                // Frames kept for deltas, about 1.6 s
+#define NET_INPUT_REDUNDANCY 4        // Inputs repeated in every input packet
+#define NET_INPUT_QUEUE 32            // Server side, per player
+#define NET_INPUT_HISTORY 128         // Client side, for replaying unacknowledged inputs
+#define NET_TIMEOUT_TICKS (SIM_TICKS_PER_SECOND * 5)
+#define NET_ENTITY_COUNT (SIM_MAX_PLAYERS + MAX_GHOSTS)
+
+typedef struct NetAddress {
+    uint32_t host; // IPv4, host byte order
+    uint16_t port;
+} NetAddress;
+
+typedef struct NetSocket {
+    intptr_t handle; // -1 when closed
+} NetSocket;
+
+// Winsock needs setting up once per process; a no-op elsewhere.
+bool net_startup(void);
+void net_shutdown(void);
+// Binds a non-blocking UDP socket; port 0 picks any free port.
+bool net_open(NetSocket* sock, uint16_t port);
+void net_close(NetSocket* sock);
+bool net_resolve(const char* host, uint16_t port, NetAddress* address);
+bool net_send(NetSocket* sock, const NetAddress* to, const uint8_t* data, int size);
+// Bytes received into data, or -1 when nothing is waiting.
+int net_receive(NetSocket* sock, NetAddress* from, uint8_t* data, int capacity);
+
+// One entity as it travels: position in half maze units, heading and buffered turn as SimDirs (3 bits each).
+typedef struct NetEntity {
+    uint16_t x;
+    uint16_t y;
+    uint8_t dirs;
+} NetEntity;
+
+// A session as the network sees it at one server tick. Players come first in `entities`, then ghosts.
+typedef struct NetFrame {
+    uint32_t tick;          // Server tick, so frames of different games never mix
+    bool valid;
+    uint32_t seed;          // Game seed and level; the client rebuilds the maze when either changes
+    uint16_t level;
+    uint8_t status;
+    uint8_t ghostCount;
+    uint8_t aliveMask;      // Players still on the board
+    uint8_t playerMask;     // Player slots with someone connected
+    int32_t scores[SIM_MAX_PLAYERS];
+    NetEntity entities[NET_ENTITY_COUNT];
+} NetFrame;
+
+typedef struct NetFrameRing {
+    NetFrame frames[NET_HISTORY]; // Frame at tick t lives in slot (t / NET_SNAPSHOT_TICKS) % NET_HISTORY
+    uint64_t* planes;             // One pellet plane per frame
+    size_t planeWords;
+} NetFrameRing;
+
+// Server side.
+typedef struct NetPeer {
+    bool connected;
+    NetAddress address;
+    uint32_t token;
+    uint8_t inputs[NET_INPUT_QUEUE]; // Input seq s lives at s % NET_INPUT_QUEUE
+    uint32_t nextInput;      // Seq applied on the next tick; also how many inputs have been consumed
+    uint32_t receivedInput;  // One past the newest seq received
+    SimDir held;             // Reused on ticks whose input hasn't arrived
+    bool hasAck;
+    uint32_t ackTick;        // Newest snapshot the client confirmed, the baseline of the next delta
+    uint32_t lastHeard;      // Server tick
+} NetPeer;
+
+typedef struct NetSession {
+    bool active;
+    SimState state;
+    NavCache nav;            // Per session: sessions move through generated levels independently
+    bool navReady;
+    SimPlayer players[SIM_MAX_PLAYERS];
+    NetPeer peers[SIM_MAX_PLAYERS]; // Peer i plays players[i]
+    int peerCount;
+    NetFrameRing history;
+    int games;               // Games started, for seeding the next one
+} NetSession;
+
+typedef struct NetServerStats {
+    long long packetsIn;
+    long long packetsOut;
+    long long bytesIn;
+    long long bytesOut;
+    long long snapshots;
+    long long fullSnapshots;
+    long long connects;
+    long long timeouts;
+} NetServerStats;
+
+typedef struct NetServer {
+    NetSocket socket;
+    const MazeMap* map;
+    Difficulty difficulty;
+    uint32_t seed;
+    uint32_t tick;
+    uint32_t wallHash;
+    uint32_t rng;            // Token salt
+    NetSession* sessions;
+    int sessionCapacity;
+    int playersPerSession;
+    NetServerStats stats;
+} NetServer;
+
+// Serves boards on map (every level after the first is generated, as in single player). False if the
+// socket can't be bound, the board is too large for a full snapshot or 16-bit positions (127 tiles a side),
+// or memory runs out.
+bool net_server_init(NetServer* server, const MazeMap* map, Difficulty difficulty, uint32_t seed, uint16_t port, int maxSessions, int playersPerSession);
+void net_server_free(NetServer* server);
+// One server tick: drains the socket, steps every active session and sends the snapshots that are due.
+void net_server_tick(NetServer* server);
+int net_server_sessions(const NetServer* server);
+int net_server_players(const NetServer* server);
+
+// Client side.
+typedef struct NetClientStats {
+    long long packetsIn;
+    long long packetsOut;
+    long long bytesIn;
+    long long bytesOut;
+    long long snapshots;
+    long long fullSnapshots;
+    long long dropped;       // Snapshots lost on purpose (dropPercent) or with a missing baseline
+    long long corrections;   // Reconciliations that moved the predicted Pac-Man
+    double correctionSum;    // Total distance they moved it, in tiles
+    long long pendingSum;    // Unconsumed inputs replayed, summed over snapshots
+} NetClientStats;
+
+typedef struct NetClient {
+    NetSocket socket;
+    NetAddress server;
+    const MazeMap* map;
+    bool connected;
+    bool rejected;
+    uint32_t token;
+    int self;
+    Difficulty difficulty;
+    SimState world;          // Mirror of the session: maze, pellets and ghosts; pacman is our prediction
+    bool worldReady;
+    SimPlayer players[SIM_MAX_PLAYERS]; // As last received; players[self] is overwritten by the prediction
+    uint8_t playerMask;
+    NetFrameRing history;
+    bool hasFrame;
+    uint32_t newestTick;
+    uint8_t inputs[NET_INPUT_HISTORY]; // Our input seq s lives at s % NET_INPUT_HISTORY
+    uint32_t inputSeq;       // Next seq to send
+    uint32_t ticks;
+    uint32_t lastHeard;      // Client tick
+    int dropPercent;         // Simulated snapshot loss, for testing
+    uint32_t rng;
+    NetClientStats stats;
+} NetClient;
+
+// Opens a socket and starts connecting; map must be the one the server was started with.
+bool net_client_init(NetClient* client, const MazeMap* map, const NetAddress* server, uint32_t seed);
+void net_client_free(NetClient* client);
+// One client tick: reads snapshots, predicts our Pac-Man with input and sends it. False once the server
+// rejected us or went quiet for NET_TIMEOUT_TICKS.
+bool net_client_tick(NetClient* client, SimInput input);
+
+#endif
@@ -0,0 +1,59 @@
+#include "raylib.h"
+#include "assets.h"
+#include "render.h"
+#include "audio.h"
+#include <stdio.h>
+#include <string.h>
+
+// Asset packer: decodes everything under resources/ once and writes the archive the game maps at startup
+// (see assets.h). Run it again whenever a file under resources/ changes; `make assets` builds and runs it.
+// It uses raylib's decoders but opens no window or audio device.
+// Usage: pacman_pack [--resources DIR] [--out FILE]
+// DIR defaults to resources/ and FILE to pacman.pma, both next to the executable.
+
+static const char* asset_type_name(uint32_t type) { // Label for the summary.
+    switch (type) {
+        case ASSET_TEXTURE: return "texture";
+        case ASSET_REGION: return "region";
+        case ASSET_WAVE: return "pcm";
+        case ASSET_STREAM: return "stream";
+    }
+    return "?";
+}
+
+int main(int argc, char** argv) {
+    char directory[1024];
+    char outFile[1024];
+    snprintf(directory, sizeof(directory), "%s%s", GetApplicationDirectory(), ASSET_RESOURCE_DIR);
+    snprintf(outFile, sizeof(outFile), "%s%s", GetApplicationDirectory(), ASSET_ARCHIVE_NAME);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--resources") == 0 && i + 1 < argc) {
+            // Loaders append relative paths, so the directory needs its trailing separator.
+            const char* dir = argv[++i];
+            size_t length = strlen(dir);
+            bool slash = length > 0 && (dir[length - 1] == '/' || dir[length - 1] == '\\');
+            snprintf(directory, sizeof(directory), "%s%s", dir, slash ? "" : "/");
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            snprintf(outFile, sizeof(outFile), "%s", argv[++i]);
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    AssetWriter writer;
+    asset_writer_init(&writer);
+    bool ok = PackSpriteAssets(&writer, directory) && PackAudioAssets(&writer, directory) && asset_writer_save(&writer, outFile);
+    if (!ok) {
+        fprintf(stderr, "Failed to pack %s into %s\n", directory, outFile);
+        asset_writer_free(&writer);
+        return 1;
+    }
+
+    size_t total = ASSET_FILE_HEADER_SIZE + (size_t)writer.entryCount * sizeof(AssetEntry) + writer.dataSize;
+    for (int i = 0; i < writer.entryCount; i++) {
+        const AssetEntry* entry = &writer.entries[i];
+        printf("%-24s %-8s %10llu bytes\n", entry->name, asset_type_name(entry->type), (unsigned long long)entry->size);
+    }
+    printf("%s: %d entries, %.1f KB\n", outFile, writer.entryCount, total / 1024.0);
+    asset_writer_free(&writer);
+    return 0;
+}
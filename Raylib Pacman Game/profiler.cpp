@@ -0,0 +1,105 @@
+#include "profiler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+thread_local Profiler* activeProfiler = NULL;
+
+static const char* phaseNames[PROFILE_PHASE_COUNT] = {
+    "frame",
+    "input",
+    "sim",
+    "sim.pacman",
+    "sim.ghost_ai",
+    "sim.collision",
+    "draw.maze",
+    "draw.entities",
+    "draw.text",
+    "audio",
+    "present"
+};
+
+static const size_t CSV_BUFFER_SIZE = 64 * 1024;
+
+uint64_t profiler_now_ns(void) { // Monotonic clock in nanoseconds.
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler_init(Profiler* profiler) { // Clears history and counters.
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+void profiler_begin_frame(Profiler* profiler) { // Marks the start of a frame; phase totals restart from zero.
+    memset(profiler->current, 0, sizeof(profiler->current));
+    profiler->frameStart = profiler_now_ns();
+}
+
+void profiler_end_frame(Profiler* profiler) { // Pushes this frame's phase totals into the history ring and the CSV file.
+    profiler->current[PROFILE_FRAME] = profiler_now_ns() - profiler->frameStart;
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        profiler->history[p][profiler->historyHead] = profiler->current[p] / 1.0e6f;
+    }
+    profiler->historyHead = (profiler->historyHead + 1) % PROFILE_HISTORY;
+    if (profiler->historyCount < PROFILE_HISTORY) profiler->historyCount++;
+
+    if (profiler->csv) {
+        fprintf(profiler->csv, "%llu", (unsigned long long)profiler->frameIndex);
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+            fprintf(profiler->csv, ",%llu", (unsigned long long)(profiler->current[p] / 1000));
+        }
+        fputc('\n', profiler->csv);
+    }
+
+    profiler->frameIndex++;
+}
+
+bool profiler_start_csv(Profiler* profiler, const char* fileName) { // Starts streaming one row of per-phase microseconds per frame.
+    profiler_stop_csv(profiler);
+
+    profiler->csv = fopen(fileName, "w");
+    if (!profiler->csv) return false;
+    setvbuf(profiler->csv, NULL, _IOFBF, CSV_BUFFER_SIZE);
+
+    fputs("frame", profiler->csv);
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        fprintf(profiler->csv, ",%s_us", phaseNames[p]);
+    }
+    fputc('\n', profiler->csv);
+    return true;
+}
+
+void profiler_stop_csv(Profiler* profiler) { // Flushes and closes the CSV file if one is open.
+    if (profiler->csv) {
+        fclose(profiler->csv);
+        profiler->csv = NULL;
+    }
+}
+
+static int compare_floats(const void* a, const void* b) { // qsort comparator for ascending floats.
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+ProfileStats profiler_stats(const Profiler* profiler, ProfilePhase phase) { // Min, mean and 99th percentile over the rolling window, in milliseconds.
+    ProfileStats stats = { 0.0f, 0.0f, 0.0f };
+    int count = profiler->historyCount;
+    if (count == 0) return stats;
+
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, profiler->history[phase], count * sizeof(float));
+    qsort(sorted, count, sizeof(float), compare_floats);
+
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) sum += sorted[i];
+
+    stats.min = sorted[0];
+    stats.avg = sum / count;
+    stats.p99 = sorted[(count * 99) / 100 < count ? (count * 99) / 100 : count - 1];
+    return stats;
+}
+
+const char* profiler_phase_name(ProfilePhase phase) { // Short label used by the overlay and the CSV header.
+    return phaseNames[phase];
+}
@@ -0,0 +1,76 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Per-phase frame profiler.
+// PROFILE_SCOPE(phase) adds the scope's wall time to the phase's total for the current frame.
+// Scopes only record while a profiler is active on the calling thread; otherwise they cost one
+// pointer test. Building with -DPACMAN_NO_PROFILER compiles them out entirely.
+
+typedef enum {
+    PROFILE_FRAME,
+    PROFILE_INPUT,
+    PROFILE_SIM,
+    PROFILE_SIM_PACMAN,
+    PROFILE_SIM_GHOST_AI,
+    PROFILE_SIM_COLLISION,
+    PROFILE_MAZE_DRAW,
+    PROFILE_ENTITY_DRAW,
+    PROFILE_TEXT_DRAW,
+    PROFILE_AUDIO,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+#define PROFILE_HISTORY 240 // Frames kept for the rolling min/avg/p99
+
+typedef struct Profiler {
+    uint64_t frameStart;
+    uint64_t current[PROFILE_PHASE_COUNT];              // Nanoseconds spent in each phase this frame
+    float history[PROFILE_PHASE_COUNT][PROFILE_HISTORY]; // Per-frame totals in milliseconds
+    int historyHead;
+    int historyCount;
+    uint64_t frameIndex;
+    FILE* csv;
+} Profiler;
+
+typedef struct ProfileStats {
+    float min;
+    float avg;
+    float p99;
+} ProfileStats;
+
+extern thread_local Profiler* activeProfiler;
+
+uint64_t profiler_now_ns(void);
+void profiler_init(Profiler* profiler);
+void profiler_begin_frame(Profiler* profiler);
+void profiler_end_frame(Profiler* profiler);
+bool profiler_start_csv(Profiler* profiler, const char* fileName);
+void profiler_stop_csv(Profiler* profiler);
+ProfileStats profiler_stats(const Profiler* profiler, ProfilePhase phase);
+const char* profiler_phase_name(ProfilePhase phase);
+
+struct ProfileScope {
+    ProfilePhase phase;
+    uint64_t start;
+
+    explicit ProfileScope(ProfilePhase scopePhase) : phase(scopePhase), start(activeProfiler ? profiler_now_ns() : 0) {}
+    ~ProfileScope() {
+        if (activeProfiler && start) activeProfiler->current[phase] += profiler_now_ns() - start;
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PACMAN_NO_PROFILER
+#define PROFILE_SCOPE(phase) ((void)0)
+#else
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#endif
+
+#endif
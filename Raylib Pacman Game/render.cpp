@@ -0,0 +1,400 @@
+#include "render.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void DrawMazeTile(const MazeBits* maze, int tileSize, int x, int y) { // Paints one tile of the layer: wall, pellet or empty floor.
+    int size = tileSize;
+    if (maze_is_wall(maze, x, y)) {
+        DrawRectangle(x * size, y * size, size, size, BLUE);
+        return;
+    }
+    DrawRectangle(x * size, y * size, size, size, BLACK);
+    if (maze_has_pellet(maze, x, y)) {
+        DrawCircle(x * size + size / 2, y * size + size / 2, size * 0.15f, WHITE);
+    }
+}
+
+MazeLayer LoadMazeLayer(int width, int height, int tileSize) { // Allocates the render texture; its contents are built by the first UpdateMazeLayer.
+    MazeLayer layer;
+    memset(&layer, 0, sizeof(layer));
+    layer.width = width;
+    layer.height = height;
+    layer.rowWords = (width + 63) / 64;
+    layer.tileSize = tileSize;
+    layer.valid = false;
+
+    if ((long long)width * tileSize > MAZE_LAYER_MAX_PIXELS || (long long)height * tileSize > MAZE_LAYER_MAX_PIXELS) {
+        return layer;
+    }
+
+    layer.drawnPellets = (uint64_t*)malloc((size_t)height * layer.rowWords * sizeof(uint64_t));
+    if (!layer.drawnPellets) return layer;
+
+    layer.target = LoadRenderTexture(width * tileSize, height * tileSize);
+    if (layer.target.id <= 0) {
+        TraceLog(LOG_ERROR, "Failed to create maze render texture!");
+    }
+    return layer;
+}
+
+void UnloadMazeLayer(MazeLayer* layer) { // Frees the render texture and the pellet copy.
+    if (layer->target.id > 0) UnloadRenderTexture(layer->target);
+    free(layer->drawnPellets);
+    memset(layer, 0, sizeof(*layer));
+}
+
+void UpdateMazeLayer(MazeLayer* layer, const MazeBits* maze) { // Brings the texture in line with the board, redrawing only what changed.
+    if (layer->target.id <= 0 || maze->width != layer->width || maze->height != layer->height) return;
+
+    size_t planeBytes = (size_t)maze->height * maze->rowWords * sizeof(uint64_t);
+    bool wallsChanged = !layer->valid || layer->drawnWalls != maze->walls;
+
+    if (!wallsChanged && memcmp(layer->drawnPellets, maze->pellets, planeBytes) == 0) {
+        return;
+    }
+
+    BeginTextureMode(layer->target);
+
+    if (wallsChanged) {
+        ClearBackground(BLACK);
+        for (int y = 0; y < maze->height; y++) {
+            for (int x = 0; x < maze->width; x++) {
+                if (maze_is_wall(maze, x, y) || maze_has_pellet(maze, x, y)) {
+                    DrawMazeTile(maze, layer->tileSize, x, y);
+                }
+            }
+        }
+    } else {
+        for (int y = 0; y < maze->height; y++) {
+            for (int w = 0; w < maze->rowWords; w++) {
+                size_t word = (size_t)y * maze->rowWords + w;
+                uint64_t changed = layer->drawnPellets[word] ^ maze->pellets[word];
+                while (changed) {
+                    int x = w * 64 + __builtin_ctzll(changed);
+                    changed &= changed - 1;
+                    DrawMazeTile(maze, layer->tileSize, x, y);
+                }
+            }
+        }
+    }
+
+    EndTextureMode();
+
+    layer->drawnWalls = maze->walls;
+    memcpy(layer->drawnPellets, maze->pellets, planeBytes);
+    layer->valid = true;
+}
+
+void DrawMazeLayer(const MazeLayer* layer, Rectangle view) { // Blits the part of the maze inside the view (world pixels) as one textured quad.
+    Texture2D texture = layer->target.texture;
+    float left = fmaxf(view.x, 0.0f);
+    float top = fmaxf(view.y, 0.0f);
+    float right = fminf(view.x + view.width, (float)texture.width);
+    float bottom = fminf(view.y + view.height, (float)texture.height);
+    if (right <= left || bottom <= top) return;
+
+    // Render textures are stored upside down: flip the row range and use a negative source height.
+    Rectangle source = { left, texture.height - bottom, right - left, -(bottom - top) };
+    DrawTextureRec(texture, source, (Vector2){ left, top }, WHITE);
+}
+
+void DrawMazeView(const MazeBits* maze, int tileSize, Rectangle view) { // Draws walls and pellets of the tiles inside the view, scanning the bit planes word by word.
+    int firstX = (int)floorf(view.x / tileSize);
+    int firstY = (int)floorf(view.y / tileSize);
+    int lastX = (int)floorf((view.x + view.width) / tileSize);
+    int lastY = (int)floorf((view.y + view.height) / tileSize);
+    if (firstX < 0) firstX = 0;
+    if (firstY < 0) firstY = 0;
+    if (lastX >= maze->width) lastX = maze->width - 1;
+    if (lastY >= maze->height) lastY = maze->height - 1;
+    if (firstX > lastX || firstY > lastY) return;
+
+    for (int y = firstY; y <= lastY; y++) {
+        const uint64_t* walls = maze->walls + (size_t)y * maze->rowWords;
+        const uint64_t* pellets = maze->pellets + (size_t)y * maze->rowWords;
+
+        for (int w = firstX >> 6; w <= lastX >> 6; w++) {
+            // Mask the word down to the visible columns, then visit only the set bits.
+            uint64_t mask = ~0ull;
+            if (w == firstX >> 6) mask &= ~0ull << (firstX & 63);
+            if (w == lastX >> 6 && (lastX & 63) != 63) mask &= (1ull << ((lastX & 63) + 1)) - 1;
+
+            uint64_t bits = walls[w] & mask;
+            while (bits) {
+                int x = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                DrawRectangle(x * tileSize, y * tileSize, tileSize, tileSize, BLUE);
+            }
+
+            bits = pellets[w] & mask;
+            while (bits) {
+                int x = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                DrawCircle(x * tileSize + tileSize / 2, y * tileSize + tileSize / 2, tileSize * 0.15f, WHITE);
+            }
+        }
+    }
+}
+
+static const char* spriteFiles[SPRITE_COUNT] = { // Under the resource directory; archive regions take the file names
+    "textures/pacman.png",
+    "textures/pacman1.png",
+    "textures/blinky.png",
+    "textures/pinky.png",
+    "textures/inky.png",
+    "textures/clyde.png"
+};
+
+static const char* SPRITE_ATLAS_ASSET = "sprites";
+
+const int ATLAS_PADDING = 2; // Transparent gap between sprites so filtering never bleeds a neighbour in
+
+static Image BuildSpriteAtlasImage(const char* directory, Rectangle sources[SPRITE_COUNT]) { // Loads every sprite image and packs them side by side into one RGBA8 image.
+    Image images[SPRITE_COUNT];
+    int atlasWidth = ATLAS_PADDING;
+    int atlasHeight = 0;
+
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        const char* fileName = TextFormat("%s%s", directory, spriteFiles[i]);
+        images[i] = LoadImage(fileName);
+        if (images[i].data == NULL) {
+            TraceLog(LOG_ERROR, TextFormat("Failed to load sprite: %s", fileName));
+        }
+        atlasWidth += images[i].width + ATLAS_PADDING;
+        if (images[i].height > atlasHeight) atlasHeight = images[i].height;
+    }
+    atlasHeight += 2 * ATLAS_PADDING;
+
+    Image packed = GenImageColor(atlasWidth, atlasHeight, BLANK);
+    int x = ATLAS_PADDING;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        Rectangle source = { 0.0f, 0.0f, (float)images[i].width, (float)images[i].height };
+        sources[i] = (Rectangle){ (float)x, (float)ATLAS_PADDING, (float)images[i].width, (float)images[i].height };
+        if (images[i].data != NULL) {
+            ImageDraw(&packed, images[i], source, sources[i], WHITE);
+        }
+        x += images[i].width + ATLAS_PADDING;
+        UnloadImage(images[i]);
+    }
+    ImageFormat(&packed, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    return packed;
+}
+
+static bool FindPackedAtlas(const AssetArchive* archive, Image* image, Rectangle sources[SPRITE_COUNT]) { // Points an image at the archived atlas pixels and reads the sprite regions.
+    const AssetEntry* atlas = asset_find(archive, SPRITE_ATLAS_ASSET, ASSET_TEXTURE);
+    if (!atlas || atlas->size != (uint64_t)atlas->info[0] * atlas->info[1] * 4) return false;
+
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        const AssetEntry* region = asset_find(archive, GetFileName(spriteFiles[i]), ASSET_REGION);
+        if (!region) return false;
+        sources[i] = (Rectangle){ (float)region->info[0], (float)region->info[1], (float)region->info[2], (float)region->info[3] };
+    }
+
+    // raylib only reads the pixels while uploading, so the image can borrow the mapping.
+    image->data = (void*)asset_data(archive, atlas);
+    image->width = (int)atlas->info[0];
+    image->height = (int)atlas->info[1];
+    image->mipmaps = 1;
+    image->format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    return true;
+}
+
+SpriteAtlas LoadSpriteAtlas(const AssetArchive* archive, const char* directory) { // Uploads the archived atlas as is, or builds it from the loose images.
+    SpriteAtlas atlas;
+    memset(&atlas, 0, sizeof(atlas));
+
+    Image packed;
+    if (archive && FindPackedAtlas(archive, &packed, atlas.sources)) {
+        atlas.texture = LoadTextureFromImage(packed);
+    } else {
+        if (archive) TraceLog(LOG_WARNING, "Asset archive has no sprite atlas, loading the sprite images");
+        packed = BuildSpriteAtlasImage(directory, atlas.sources);
+        atlas.texture = LoadTextureFromImage(packed);
+        UnloadImage(packed);
+    }
+    if (atlas.texture.id <= 0) {
+        TraceLog(LOG_ERROR, "Failed to create sprite atlas texture!");
+    }
+
+    return atlas;
+}
+
+bool PackSpriteAssets(AssetWriter* writer, const char* directory) { // Stores the finished atlas and one region per sprite.
+    Rectangle sources[SPRITE_COUNT];
+    Image packed = BuildSpriteAtlasImage(directory, sources);
+    uint32_t size[4] = { (uint32_t)packed.width, (uint32_t)packed.height, 0, 0 };
+    bool ok = packed.data && asset_writer_add(writer, SPRITE_ATLAS_ASSET, ASSET_TEXTURE, size, packed.data, (size_t)packed.width * packed.height * 4);
+    UnloadImage(packed);
+
+    for (int i = 0; ok && i < SPRITE_COUNT; i++) {
+        uint32_t region[4] = { (uint32_t)sources[i].x, (uint32_t)sources[i].y, (uint32_t)sources[i].width, (uint32_t)sources[i].height };
+        ok = asset_writer_add(writer, GetFileName(spriteFiles[i]), ASSET_REGION, region, NULL, 0);
+    }
+    return ok;
+}
+
+void UnloadSpriteAtlas(SpriteAtlas* atlas) { // Frees the atlas texture.
+    UnloadTexture(atlas->texture);
+    atlas->texture.id = 0;
+}
+
+void DrawSprite(const SpriteAtlas* atlas, SpriteId sprite, Rectangle dest, Vector2 origin, float rotation) { // Draws one sprite; consecutive calls share a texture and stay in one draw batch.
+    DrawTexturePro(atlas->texture, atlas->sources[sprite], dest, origin, rotation, WHITE);
+}
+
+static void LayoutFrameTarget(FrameTarget* frame) { // Fits the design size into the window and sizes the rendered part.
+    float scaleX = (float)frame->windowWidth / frame->designWidth;
+    float scaleY = (float)frame->windowHeight / frame->designHeight;
+    frame->layoutScale = scaleX < scaleY ? scaleX : scaleY;
+    frame->layoutWidth = (int)(frame->windowWidth / frame->layoutScale + 0.5f);
+    frame->layoutHeight = (int)(frame->windowHeight / frame->layoutScale + 0.5f);
+
+    // Measured against the texture rather than the window, so a resize whose texture couldn't be made
+    // still stretches the old one over the window.
+    frame->scale = (float)frame->scaleSteps / FRAME_SCALE_STEPS;
+    frame->width = (int)ceilf(frame->target.texture.width * frame->scale);
+    frame->height = (int)ceilf(frame->target.texture.height * frame->scale);
+}
+
+bool LoadFrameTarget(FrameTarget* frame, int designWidth, int designHeight, float budget) { // Creates the texture at the window size, rendering at full resolution to start with.
+    memset(frame, 0, sizeof(*frame));
+    frame->designWidth = designWidth;
+    frame->designHeight = designHeight;
+    frame->windowWidth = GetScreenWidth();
+    frame->windowHeight = GetScreenHeight();
+    frame->scaleSteps = FRAME_SCALE_STEPS;
+    frame->budget = budget;
+    frame->averageTime = budget;
+    frame->settleFrames = FRAME_SETTLE_FRAMES;
+    frame->probeFrames = FRAME_PROBE_FRAMES;
+
+    frame->target = LoadRenderTexture(frame->windowWidth, frame->windowHeight);
+    if (frame->target.id <= 0) return false;
+    SetTextureFilter(frame->target.texture, TEXTURE_FILTER_BILINEAR);
+    LayoutFrameTarget(frame);
+    return true;
+}
+
+void UnloadFrameTarget(FrameTarget* frame) { // Frees the render texture.
+    if (frame->target.id > 0) UnloadRenderTexture(frame->target);
+    frame->target.id = 0;
+}
+
+static void AdjustFrameScale(FrameTarget* frame, float frameTime) { // Moves the scale toward the budget; see render.h.
+    frame->averageTime += (frameTime - frame->averageTime) * 0.1f;
+    if (frame->settleFrames > 0) {
+        frame->settleFrames--;
+        return;
+    }
+
+    if (frame->averageTime > frame->budget * 1.1f) {
+        frame->calmFrames = 0;
+        if (frame->probing && frame->probeFrames < FRAME_PROBE_FRAMES_MAX) frame->probeFrames *= 2;
+        frame->probing = false;
+        if (frame->scaleSteps <= FRAME_SCALE_MIN_STEPS) return;
+
+        int steps = (int)(frame->scaleSteps * sqrtf(frame->budget / frame->averageTime));
+        if (steps >= frame->scaleSteps) steps = frame->scaleSteps - 1;
+        if (steps < FRAME_SCALE_MIN_STEPS) steps = FRAME_SCALE_MIN_STEPS;
+        frame->scaleSteps = steps;
+        frame->settleFrames = FRAME_SETTLE_FRAMES;
+        return;
+    }
+
+    frame->calmFrames++;
+    if (frame->calmFrames < frame->probeFrames) return;
+    if (frame->probing) frame->probeFrames = FRAME_PROBE_FRAMES; // The last step up held
+    frame->probing = false;
+    frame->calmFrames = 0;
+    if (frame->scaleSteps < FRAME_SCALE_STEPS) {
+        frame->scaleSteps++;
+        frame->probing = true;
+        frame->settleFrames = FRAME_SETTLE_FRAMES;
+    }
+}
+
+bool UpdateFrameTarget(FrameTarget* frame, float frameTime) { // Follows the window size, then the frame time.
+    int layoutWidth = frame->layoutWidth;
+    int layoutHeight = frame->layoutHeight;
+
+    int windowWidth = GetScreenWidth();
+    int windowHeight = GetScreenHeight();
+    // Minimised windows report a zero size; keep the old one until they come back.
+    if (windowWidth > 0 && windowHeight > 0 && (windowWidth != frame->windowWidth || windowHeight != frame->windowHeight)) {
+        frame->windowWidth = windowWidth;
+        frame->windowHeight = windowHeight;
+        RenderTexture2D target = LoadRenderTexture(windowWidth, windowHeight);
+        if (target.id > 0) {
+            UnloadRenderTexture(frame->target);
+            frame->target = target;
+            SetTextureFilter(frame->target.texture, TEXTURE_FILTER_BILINEAR);
+        } else {
+            TraceLog(LOG_WARNING, "Failed to resize the frame texture to %dx%d", windowWidth, windowHeight);
+        }
+        // Resizing stalls a frame or two; that says nothing about the scale.
+        frame->settleFrames = FRAME_SETTLE_FRAMES;
+    }
+
+    if (frame->budget > 0.0f && frameTime > 0.0f) AdjustFrameScale(frame, frameTime);
+    LayoutFrameTarget(frame);
+    return frame->layoutWidth != layoutWidth || frame->layoutHeight != layoutHeight;
+}
+
+Camera2D FrameTargetCamera(const FrameTarget* frame, Camera2D camera) { // Scales a layout-pixel camera down to the rendered part of the target.
+    float zoom = frame->layoutScale * frame->target.texture.width * frame->scale / frame->windowWidth;
+    camera.offset.x *= zoom;
+    camera.offset.y *= zoom;
+    camera.zoom *= zoom;
+    return camera;
+}
+
+void BeginFrameTarget(const FrameTarget* frame) { // Draws into the target; the scissor keeps the clear to the part in use.
+    BeginTextureMode(frame->target);
+    BeginScissorMode(0, 0, frame->width, frame->height);
+    ClearBackground(BLACK);
+}
+
+void EndFrameTarget(void) { // Back to drawing on the window.
+    EndScissorMode();
+    EndTextureMode();
+}
+
+void DrawFrameTarget(const FrameTarget* frame) { // One bilinear quad from the rendered part to the whole window.
+    // Render textures are stored bottom-up, so the rendered top-left part sits at the top of the texture
+    // and is read with a negative height.
+    float width = frame->target.texture.width * frame->scale;
+    float height = frame->target.texture.height * frame->scale;
+    Rectangle source = { 0.0f, frame->target.texture.height - height, width, -height };
+    Rectangle dest = { 0.0f, 0.0f, (float)frame->windowWidth, (float)frame->windowHeight };
+    DrawTexturePro(frame->target.texture, source, dest, (Vector2){ 0.0f, 0.0f }, 0.0f, WHITE);
+}
+
+void DrawProfilerOverlay(const Profiler* profiler, const EventTally* events, const FrameTarget* frame, int x, int y) { // Rolling min/avg/p99 per phase in milliseconds.
+    const int lineHeight = 20;
+    int lines = PROFILE_PHASE_COUNT + 2 + (events ? 1 : 0) + (frame ? 1 : 0);
+    int height = lines * lineHeight + 10;
+
+    DrawRectangle(x, y, 420, height, Fade(BLACK, 0.8f));
+    DrawRectangleLines(x, y, 420, height, DARKGRAY);
+    DrawText(TextFormat("%-14s %7s %7s %7s", "phase (ms)", "min", "avg", "p99"), x + 8, y + 6, 18, YELLOW);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        ProfileStats stats = profiler_stats(profiler, (ProfilePhase)p);
+        DrawText(TextFormat("%-14s %7.3f %7.3f %7.3f", profiler_phase_name((ProfilePhase)p), stats.min, stats.avg, stats.p99),
+            x + 8, y + 6 + (p + 1) * lineHeight, 18, (p == PROFILE_FRAME) ? WHITE : LIGHTGRAY);
+    }
+
+    DrawText(profiler->csv ? "CSV: recording  [F4]" : "CSV: off  [F4]", x + 8, y + 6 + (PROFILE_PHASE_COUNT + 1) * lineHeight, 18, profiler->csv ? RED : GRAY);
+
+    int line = PROFILE_PHASE_COUNT + 2;
+    if (events) {
+        DrawText(TextFormat("events: %lld eaten %lld reversed %lld died", events->counts[SIM_EVENT_TYPE_PELLET_EATEN],
+            events->counts[SIM_EVENT_TYPE_GHOST_REVERSED], events->counts[SIM_EVENT_TYPE_PACMAN_DIED]),
+            x + 8, y + 6 + line++ * lineHeight, 18, SKYBLUE);
+    }
+    if (frame) {
+        DrawText(TextFormat("render %dx%d (%d%%) of %dx%d", frame->width, frame->height, frame->scaleSteps * 100 / FRAME_SCALE_STEPS,
+            frame->windowWidth, frame->windowHeight), x + 8, y + 6 + line++ * lineHeight, 18, frame->scaleSteps < FRAME_SCALE_STEPS ? ORANGE : GRAY);
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include "sim.h"
+#include "profiler.h"
+#include "events.h"
+#include "assets.h"
+
+// Cached maze drawing: walls and pellets live in one render texture, and the part inside the camera view
+// is drawn as a single quad. The layer remembers which board it shows and only touches the tiles whose
+// pellet bit changed. Mazes too large for one texture have no layer (target.id == 0) and are drawn
+// directly with DrawMazeView, which only visits the tiles in view.
+
+#define MAZE_LAYER_MAX_PIXELS 4096
+
+typedef struct MazeLayer {
+    RenderTexture2D target;
+    const uint64_t* drawnWalls; // Wall plane baked into the texture
+    uint64_t* drawnPellets;     // Copy of the pellet plane baked into the texture
+    int width;                  // Maze size in tiles
+    int height;
+    int rowWords;
+    int tileSize;
+    bool valid;
+} MazeLayer;
+
+// All entity sprites packed into one texture, so every entity draws from the same texture in one batch.
+
+typedef enum {
+    SPRITE_PACMAN_OPEN,
+    SPRITE_PACMAN_CLOSED,
+    SPRITE_BLINKY,
+    SPRITE_PINKY,
+    SPRITE_INKY,
+    SPRITE_CLYDE,
+    SPRITE_COUNT
+} SpriteId;
+
+typedef struct SpriteAtlas {
+    Texture2D texture;
+    Rectangle sources[SPRITE_COUNT]; // Source rectangle of each sprite inside the atlas
+} SpriteAtlas;
+
+MazeLayer LoadMazeLayer(int width, int height, int tileSize);
+void UnloadMazeLayer(MazeLayer* layer);
+void UpdateMazeLayer(MazeLayer* layer, const MazeBits* maze);
+void DrawMazeLayer(const MazeLayer* layer, Rectangle view);
+void DrawMazeView(const MazeBits* maze, int tileSize, Rectangle view);
+
+// Uploads the atlas straight from the archive when it has one (archive may be NULL), otherwise builds it
+// from the images under directory.
+SpriteAtlas LoadSpriteAtlas(const AssetArchive* archive, const char* directory);
+void UnloadSpriteAtlas(SpriteAtlas* atlas);
+void DrawSprite(const SpriteAtlas* atlas, SpriteId sprite, Rectangle dest, Vector2 origin, float rotation);
+// Packer side: builds the atlas from the images under directory and adds it to the archive.
+bool PackSpriteAssets(AssetWriter* writer, const char* directory);
+
+// Dynamic resolution: a frame is drawn into the top-left part of a window-sized render texture and scaled up
+// to the window. Everything is laid out in layout pixels, a space at least as large as the design size on both
+// axes that the window shows whole; one layout pixel covers layoutScale window pixels. The fraction of the
+// window resolution actually rendered, `scale`, follows the measured frame time: a frame average over budget
+// shrinks it at once by the square root of the overrun (fill cost goes with pixel count), and a long enough run
+// under budget grows it one step. A step up that overruns again makes the next attempt wait twice as long, so
+// a machine that can't hold the higher resolution settles instead of stuttering every few seconds.
+
+#define FRAME_SCALE_STEPS 20         // The scale moves in twentieths of the window resolution
+#define FRAME_SCALE_MIN_STEPS 8      // 40%
+#define FRAME_SETTLE_FRAMES 15       // Frames after a change before it is judged
+#define FRAME_PROBE_FRAMES 120       // Frames under budget before stepping up
+#define FRAME_PROBE_FRAMES_MAX 1920
+
+typedef struct FrameTarget {
+    RenderTexture2D target;  // Window-sized; a frame uses its top-left scale x size part
+    int windowWidth;
+    int windowHeight;
+    int designWidth;
+    int designHeight;
+    int layoutWidth;         // Window size in layout pixels
+    int layoutHeight;
+    float layoutScale;       // Window pixels per layout pixel
+    int scaleSteps;          // FRAME_SCALE_MIN_STEPS..FRAME_SCALE_STEPS
+    float scale;             // Rendered fraction of the window resolution
+    int width;               // Pixels cleared and drawn this frame
+    int height;
+    float budget;            // Target frame time in seconds; 0 always renders at full resolution
+    float averageTime;       // Smoothed frame time
+    int settleFrames;
+    int calmFrames;          // Frames in a row under budget
+    int probeFrames;         // Calm frames needed before the next step up
+    bool probing;            // The last change was a step up that hasn't proven itself yet
+} FrameTarget;
+
+// Sizes the target to the current window. False when the render texture can't be created.
+bool LoadFrameTarget(FrameTarget* frame, int designWidth, int designHeight, float budget);
+void UnloadFrameTarget(FrameTarget* frame);
+// Call once per frame with the last frame's time. Follows window resizes and adjusts the scale; true when the
+// layout size changed and anything laid out in layout pixels needs building again.
+bool UpdateFrameTarget(FrameTarget* frame, float frameTime);
+// Maps a camera in layout pixels onto the target; pass a default camera for screen-space layout drawing.
+Camera2D FrameTargetCamera(const FrameTarget* frame, Camera2D camera);
+// Brackets the frame's drawing: renders into the target, clearing only the part in use.
+void BeginFrameTarget(const FrameTarget* frame);
+void EndFrameTarget(void);
+// Scales the frame up to fill the window; call between BeginDrawing and EndDrawing.
+void DrawFrameTarget(const FrameTarget* frame);
+
+// events and frame may be NULL; otherwise lines of gameplay event counts and the render resolution are added
+// under the timings.
+void DrawProfilerOverlay(const Profiler* profiler, const EventTally* events, const FrameTarget* frame, int x, int y);
+
+#endif
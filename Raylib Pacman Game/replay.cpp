@@ -0,0 +1,210 @@
+#include "replay.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t REPLAY_BUFFER_SIZE = 64 * 1024;
+static const int REPLAY_HEADER_SIZE = 32;
+
+static void put_u16(uint8_t* out, uint16_t value) { // Little-endian store.
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) { // Little-endian store.
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void put_u64(uint8_t* out, uint64_t value) { // Little-endian store.
+    for (int i = 0; i < 8; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t get_u16(const uint8_t* in) { // Little-endian load.
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) { // Little-endian load.
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t* in) { // Little-endian load.
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+static void write_header(FILE* file, Difficulty difficulty, uint32_t seed, uint32_t tickCount, int32_t finalScore, uint64_t finalHash, uint32_t runCount) { // Writes the fixed-size header at the current position.
+    uint8_t header[REPLAY_HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, 4);
+    put_u16(header + 4, REPLAY_VERSION);
+    header[6] = (uint8_t)difficulty;
+    header[7] = 0;
+    put_u32(header + 8, seed);
+    put_u32(header + 12, tickCount);
+    put_u32(header + 16, (uint32_t)finalScore);
+    put_u64(header + 20, finalHash);
+    put_u32(header + 28, runCount);
+    fwrite(header, 1, sizeof(header), file);
+}
+
+static void flush_run(ReplayWriter* writer) { // Emits the pending run as a direction byte and a LEB128 length.
+    if (writer->runLength == 0) return;
+
+    uint8_t bytes[6];
+    int count = 0;
+    bytes[count++] = writer->runDirection;
+    uint32_t length = writer->runLength;
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        bytes[count++] = byte | (length ? 0x80 : 0);
+    } while (length);
+
+    fwrite(bytes, 1, count, writer->file);
+    writer->runCount++;
+    writer->runLength = 0;
+}
+
+bool replay_writer_open(ReplayWriter* writer, const char* fileName, Difficulty difficulty, uint32_t seed) { // Opens the file and reserves room for the header.
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(fileName, "wb");
+    if (!writer->file) return false;
+    setvbuf(writer->file, NULL, _IOFBF, REPLAY_BUFFER_SIZE);
+
+    writer->difficulty = difficulty;
+    writer->seed = seed;
+    write_header(writer->file, difficulty, seed, 0, 0, 0, 0);
+    return true;
+}
+
+void replay_writer_record(ReplayWriter* writer, SimInput input) { // Appends the input of one tick, extending the current run when unchanged.
+    if (!writer->file) return;
+
+    uint8_t direction = (uint8_t)input.direction;
+    if (writer->runLength > 0 && direction != writer->runDirection) flush_run(writer);
+    writer->runDirection = direction;
+    writer->runLength++;
+    writer->tickCount++;
+}
+
+bool replay_writer_close(ReplayWriter* writer, const SimState* finalState) { // Flushes the last run, patches the header and closes the file.
+    if (!writer->file) return false;
+    flush_run(writer);
+
+    fseek(writer->file, 0, SEEK_SET);
+    write_header(writer->file, writer->difficulty, writer->seed, writer->tickCount, finalState->score, sim_state_hash(finalState), writer->runCount);
+
+    bool ok = !ferror(writer->file);
+    if (fclose(writer->file) != 0) ok = false;
+    writer->file = NULL;
+    return ok;
+}
+
+bool replay_load(Replay* replay, const char* fileName) { // Reads and decodes a whole replay file into memory.
+    memset(replay, 0, sizeof(*replay));
+
+    FILE* file = fopen(fileName, "rb");
+    if (!file) return false;
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, REPLAY_MAGIC, 4) != 0 ||
+        get_u16(header + 4) != REPLAY_VERSION || header[6] > HARD) {
+        fclose(file);
+        return false;
+    }
+
+    replay->difficulty = (Difficulty)header[6];
+    replay->seed = get_u32(header + 8);
+    replay->tickCount = get_u32(header + 12);
+    replay->finalScore = (int32_t)get_u32(header + 16);
+    replay->finalHash = get_u64(header + 20);
+    uint32_t maxRuns = get_u32(header + 28);
+    if (maxRuns > replay->tickCount) {
+        fclose(file);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    size_t size = end > REPLAY_HEADER_SIZE ? (size_t)(end - REPLAY_HEADER_SIZE) : 0;
+    fseek(file, REPLAY_HEADER_SIZE, SEEK_SET);
+
+    uint8_t* data = (uint8_t*)malloc(size ? size : 1);
+    replay->runDirections = (uint8_t*)malloc(maxRuns ? maxRuns : 1);
+    replay->runLengths = (uint32_t*)malloc((maxRuns ? maxRuns : 1) * sizeof(uint32_t));
+    bool ok = data && replay->runDirections && replay->runLengths && fread(data, 1, size, file) == size;
+    fclose(file);
+
+    size_t pos = 0;
+    uint64_t ticks = 0;
+    while (ok && pos < size) {
+        if ((uint32_t)replay->runCount >= maxRuns || data[pos] > SIM_DIR_DOWN) { ok = false; break; }
+        uint8_t direction = data[pos++];
+
+        uint32_t length = 0;
+        int shift = 0;
+        for (;;) {
+            if (pos >= size || shift > 28) { ok = false; break; }
+            uint8_t byte = data[pos++];
+            length |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+        if (!ok || length == 0) { ok = false; break; }
+
+        replay->runDirections[replay->runCount] = direction;
+        replay->runLengths[replay->runCount] = length;
+        replay->runCount++;
+        ticks += length;
+    }
+    free(data);
+
+    if (!ok || ticks != replay->tickCount) {
+        replay_free(replay);
+        return false;
+    }
+    return true;
+}
+
+void replay_free(Replay* replay) { // Releases the decoded runs.
+    free(replay->runDirections);
+    free(replay->runLengths);
+    memset(replay, 0, sizeof(*replay));
+}
+
+void replay_cursor_init(ReplayCursor* cursor, const Replay* replay) { // Rewinds a cursor to the first tick.
+    cursor->replay = replay;
+    cursor->run = 0;
+    cursor->usedInRun = 0;
+}
+
+bool replay_next_input(ReplayCursor* cursor, SimInput* input) { // Returns the recorded input for the next tick.
+    const Replay* replay = cursor->replay;
+    if (cursor->run >= replay->runCount) return false;
+
+    input->direction = (SimDir)replay->runDirections[cursor->run];
+    if (++cursor->usedInRun >= replay->runLengths[cursor->run]) {
+        cursor->run++;
+        cursor->usedInRun = 0;
+    }
+    return true;
+}
+
+bool replay_matches(const Replay* replay, const SimState* state) { // Compares a finished playback against the recorded outcome.
+    return state->tick == replay->tickCount && state->score == replay->finalScore && sim_state_hash(state) == replay->finalHash;
+}
+
+bool replay_play(const Replay* replay, const MazeMap* map, NavCache* nav, SimState* finalState) { // Steps the simulation through every recorded tick without rendering.
+    ReplayCursor cursor;
+    SimInput input;
+
+    replay_cursor_init(&cursor, replay);
+    if (!sim_init(finalState, map, replay->difficulty, replay->seed, nav)) return false;
+    while (replay_next_input(&cursor, &input)) {
+        if (finalState->status == SIM_WON && !sim_next_level(finalState)) break;
+        if (finalState->status != SIM_PLAYING) break;
+        sim_step(finalState, input);
+    }
+    return replay_matches(replay, finalState);
+}
@@ -0,0 +1,63 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Input replays.
+// The simulation is a pure function of (difficulty, seed, per-tick input), so a replay stores only those:
+// a fixed header followed by the input stream as runs of { direction byte, LEB128 run length }.
+// The header also carries the tick count and sim_state_hash() of the final state so playback can prove
+// it reproduced the original game bit for bit.
+
+#define REPLAY_MAGIC "PMRP"
+#define REPLAY_VERSION 4 // Bumped whenever a change to the simulation would make older recordings diverge
+
+typedef struct ReplayWriter {
+    FILE* file;
+    Difficulty difficulty;
+    uint32_t seed;
+    uint32_t tickCount;
+    uint32_t runCount;
+    uint8_t runDirection;
+    uint32_t runLength;
+} ReplayWriter;
+
+typedef struct Replay {
+    Difficulty difficulty;
+    uint32_t seed;
+    uint32_t tickCount;
+    int32_t finalScore;
+    uint64_t finalHash;
+    int runCount;
+    uint8_t* runDirections;
+    uint32_t* runLengths;
+} Replay;
+
+typedef struct ReplayCursor {
+    const Replay* replay;
+    int run;
+    uint32_t usedInRun;
+} ReplayCursor;
+
+// Streams a replay to disk through a buffered file; the header is patched in on close.
+bool replay_writer_open(ReplayWriter* writer, const char* fileName, Difficulty difficulty, uint32_t seed);
+void replay_writer_record(ReplayWriter* writer, SimInput input);
+bool replay_writer_close(ReplayWriter* writer, const SimState* finalState);
+
+bool replay_load(Replay* replay, const char* fileName);
+void replay_free(Replay* replay);
+
+void replay_cursor_init(ReplayCursor* cursor, const Replay* replay);
+bool replay_next_input(ReplayCursor* cursor, SimInput* input); // false once every recorded tick is used
+
+// Replays a whole game as fast as possible; returns true if it ended in the recorded state.
+// Replays don't name their maze, so the caller passes the map the game was recorded on; later levels are
+// regenerated from the seed, and a cleared level only moves on if the recording has more input.
+// finalState is left initialized for inspection and must be released with sim_free().
+bool replay_play(const Replay* replay, const MazeMap* map, NavCache* nav, SimState* finalState);
+bool replay_matches(const Replay* replay, const SimState* state);
+
+#endif
@@ -0,0 +1,79 @@
+#include "rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool rewind_init(Rewind* rewind, const SimState* shape, int seconds, int interval) { // Allocates both rings for `seconds` of play.
+    memset(rewind, 0, sizeof(*rewind));
+    if (interval < 1) interval = 1;
+    int keyframeCount = (seconds * SIM_TICKS_PER_SECOND + interval - 1) / interval;
+    if (keyframeCount < 2) keyframeCount = 2;
+
+    rewind->interval = interval;
+    rewind->inputCapacity = keyframeCount * interval;
+    rewind->inputs = (uint8_t*)malloc(rewind->inputCapacity);
+    if (!rewind->inputs || !sim_arena_init(&rewind->keyframes, shape, keyframeCount)) {
+        rewind_free(rewind);
+        return false;
+    }
+    rewind_reset(rewind, shape);
+    return true;
+}
+
+void rewind_free(Rewind* rewind) { // Releases both rings.
+    sim_arena_free(&rewind->keyframes);
+    free(rewind->inputs);
+    memset(rewind, 0, sizeof(*rewind));
+}
+
+void rewind_reset(Rewind* rewind, const SimState* state) { // History becomes the single keyframe at state.
+    rewind->baseTick = state->tick;
+    rewind->endTick = state->tick;
+    rewind->oldestKeyframe = 0;
+    sim_arena_store(&rewind->keyframes, 0, state);
+}
+
+void rewind_record(Rewind* rewind, const SimState* state, SimInput input) { // Keyframes on interval boundaries, one input byte per tick.
+    if (state->tick != rewind->endTick || state->tick < rewind->baseTick) rewind_reset(rewind, state);
+
+    uint32_t offset = state->tick - rewind->baseTick;
+    if (offset % rewind->interval == 0) {
+        uint32_t keyframe = offset / rewind->interval;
+        uint32_t capacity = (uint32_t)rewind->keyframes.capacity;
+        sim_arena_store(&rewind->keyframes, (int)(keyframe % capacity), state);
+        if (keyframe >= capacity && keyframe - capacity + 1 > rewind->oldestKeyframe) rewind->oldestKeyframe = keyframe - capacity + 1;
+    }
+    rewind->inputs[offset % rewind->inputCapacity] = (uint8_t)input.direction;
+    rewind->endTick = state->tick + 1;
+}
+
+static uint32_t newest_keyframe(const Rewind* rewind) { // Index of the last keyframe stored; the state at endTick itself may not be one yet.
+    uint32_t span = rewind->endTick - rewind->baseTick;
+    return span ? (span - 1) / rewind->interval : 0;
+}
+
+uint32_t rewind_oldest(const Rewind* rewind) { // First tick of the oldest keyframe the ring still holds.
+    return rewind->baseTick + rewind->oldestKeyframe * rewind->interval;
+}
+
+bool rewind_seek(const Rewind* rewind, uint32_t tick, SimState* state) { // Restores the keyframe at or before tick and steps the recorded inputs from there.
+    if (tick < rewind_oldest(rewind) || tick > rewind->endTick) return false;
+
+    uint32_t keyframe = (tick - rewind->baseTick) / rewind->interval;
+    uint32_t newest = newest_keyframe(rewind);
+    if (keyframe > newest) keyframe = newest;
+    sim_arena_load(&rewind->keyframes, (int)(keyframe % rewind->keyframes.capacity), state);
+
+    // These ticks were already heard and scored once; re-stepping them must not raise their events again.
+    struct SimEventBuffer* events = state->events;
+    state->events = NULL;
+    for (uint32_t t = rewind->baseTick + keyframe * rewind->interval; t < tick; t++) {
+        SimInput input = { (SimDir)rewind->inputs[(t - rewind->baseTick) % rewind->inputCapacity] };
+        sim_step(state, input);
+    }
+    state->events = events;
+    return true;
+}
+
+void rewind_truncate(Rewind* rewind, uint32_t tick) { // Later inputs are simply overwritten as play goes on.
+    if (tick >= rewind_oldest(rewind) && tick < rewind->endTick) rewind->endTick = tick;
+}
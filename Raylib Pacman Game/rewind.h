@@ -0,0 +1,44 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "sim.h"
+
+// Rewind history for the current level.
+// The simulation is deterministic, so the difference between one tick and the next is fully described by
+// that tick's input: the history is a ring of one input byte per tick plus a ring of full keyframes (arena
+// snapshots) every `interval` ticks. Reaching any kept tick means restoring the keyframe at or before it and
+// stepping at most interval - 1 recorded inputs, a few microseconds. A minute at the defaults costs 3.6 KB of
+// inputs and 120 keyframes; everything is allocated by rewind_init and nothing during play.
+// Keyframes share the level's map, so history starts over on every new game and level (rewind_reset).
+// The stress swarm isn't part of a snapshot; don't rewind games that have one attached.
+
+#define REWIND_SECONDS 60
+#define REWIND_KEYFRAME_TICKS 30
+
+typedef struct Rewind {
+    SimArena keyframes;  // Ring; keyframe k (tick baseTick + k * interval) lives in slot k % capacity
+    uint8_t* inputs;     // Ring of SimDir bytes; tick t lives at (t - baseTick) % inputCapacity
+    int interval;
+    int inputCapacity;   // keyframes.capacity * interval ticks
+    uint32_t baseTick;   // Tick history starts at
+    uint32_t endTick;    // Newest reachable tick: the state after the last recorded input
+    uint32_t oldestKeyframe; // Index of the oldest keyframe the ring still holds
+} Rewind;
+
+bool rewind_init(Rewind* rewind, const SimState* shape, int seconds, int interval);
+void rewind_free(Rewind* rewind);
+// Drops all history and starts it again at state.
+void rewind_reset(Rewind* rewind, const SimState* state);
+// Call with the state about to be stepped and the input it is stepped with. A state that doesn't continue
+// the history (a new game, or play resumed without rewind_truncate) starts it over.
+void rewind_record(Rewind* rewind, const SimState* state, SimInput input);
+
+// Oldest tick still reachable.
+uint32_t rewind_oldest(const Rewind* rewind);
+// Rebuilds the state at a tick in [rewind_oldest, endTick] into the live game state, which keeps its own
+// pellet plane and map. False when the tick is out of range.
+bool rewind_seek(const Rewind* rewind, uint32_t tick, SimState* state);
+// Forgets everything after tick, so play can resume from there.
+void rewind_truncate(Rewind* rewind, uint32_t tick);
+
+#endif
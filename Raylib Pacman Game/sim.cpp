@@ -0,0 +1,705 @@
+#include "sim.h"
+#include "events.h"
+#include "mazegen.h"
+#include "profiler.h"
+#include "swarm.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const GhostType ghostTypes[MAX_GHOSTS] = { BLINKY, PINKY, INKY, CLYDE };
+// Ghost spawns relative to the map's ghost tile; offsets that land on a wall fall back to the tile itself.
+static const int ghostStartOffsets[MAX_GHOSTS] = { 0, 0, -1, 1 };
+
+// Speeds and radii in maze units: 0.1 and 1/15 of a tile per tick, and 0.4 of a tile. Both speeds are even,
+// so every position the simulation produces is too.
+static const int32_t PACMAN_SPEED = 102;
+static const int32_t GHOST_SPEED = 68;
+static const int32_t ACTOR_RADIUS = SIM_TILE_SIZE * 2 / 5;
+
+static uint32_t sim_rand(SimState* state) { // Per-game xorshift32 generator, so games never share rand() state.
+    uint32_t x = state->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->rng = x;
+    return x;
+}
+
+static SimVec2 dir_to_vector(SimDir dir) { // Converts an input direction into a unit movement vector.
+    switch (dir) {
+        case SIM_DIR_RIGHT: return (SimVec2){ 1, 0 };
+        case SIM_DIR_LEFT: return (SimVec2){ -1, 0 };
+        case SIM_DIR_UP: return (SimVec2){ 0, -1 };
+        case SIM_DIR_DOWN: return (SimVec2){ 0, 1 };
+        default: return (SimVec2){ 0, 0 };
+    }
+}
+
+int sim_ghost_count(Difficulty difficulty) { // Number of ghosts that hunt Pac-Man at a given difficulty.
+    return (difficulty == EASY) ? 2 : (difficulty == NORMAL) ? 3 : 4;
+}
+
+bool sim_init_nav(NavCache* nav, const MazeMap* map) { // Builds the ghost distance fields for a map's walls.
+    uint8_t* walls = (uint8_t*)malloc((size_t)map->width * map->height);
+    if (!walls) return false;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            walls[(size_t)y * map->width + x] = maze_map_is_wall(map, x, y);
+        }
+    }
+    bool ok = nav_init(nav, map->width, map->height, walls, NAV_DEFAULT_BUDGET);
+    free(walls);
+    nav->mapWalls = map->walls;
+    return ok;
+}
+
+static void sync_nav(NavCache* nav, const MazeMap* map) { // Copies a same-sized map's walls into the cache; stale fields rebuild on their next use.
+    if (!nav || nav->mapWalls == map->walls) return;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            nav_set_wall(nav, x, y, maze_map_is_wall(map, x, y));
+        }
+    }
+    nav_update_graph(nav);
+    nav->mapWalls = map->walls;
+}
+
+static void spawn_pacman(const MazeMap* map, SimPacman* pacman) { // A fresh Pac-Man on the map's spawn tile.
+    pacman->position = (SimVec2){ sim_tile_center(map->pacmanX), sim_tile_center(map->pacmanY) };
+    pacman->speed = PACMAN_SPEED;
+    pacman->direction = (SimVec2){ 1, 0 };
+    pacman->nextDirection = (SimVec2){ 0, 0 };
+    pacman->radius = ACTOR_RADIUS;
+    pacman->frameCounter = 0;
+    pacman->framesSpeed = 8;
+    pacman->mouthOpen = true;
+}
+
+static void place_actors(SimState* state) { // Puts Pac-Man and the ghosts on the current map's spawn tiles.
+    const MazeMap* map = state->map;
+    spawn_pacman(map, &state->pacman);
+
+    for (int i = 0; i < MAX_GHOSTS; i++) {
+        int ghostTileX = map->ghostX + ghostStartOffsets[i];
+        if (maze_map_is_wall(map, ghostTileX, map->ghostY)) ghostTileX = map->ghostX;
+        state->ghosts[i].position = (SimVec2){ sim_tile_center(ghostTileX), sim_tile_center(map->ghostY) };
+        state->ghosts[i].speed = GHOST_SPEED;
+        state->ghosts[i].direction = (SimVec2){ 0, 0 };
+        state->ghosts[i].untilNode = 0;
+        state->ghosts[i].radius = ACTOR_RADIUS;
+        state->ghosts[i].type = ghostTypes[i];
+    }
+}
+
+bool sim_init(SimState* state, const MazeMap* map, Difficulty difficulty, uint32_t seed, NavCache* nav) { // Resets maze, Pac-Man and ghosts for a fresh game; false if the pellet plane can't be allocated.
+    size_t planeWords = (size_t)map->height * map->rowWords;
+    state->map = map;
+    state->generated = NULL;
+    state->maze.width = map->width;
+    state->maze.height = map->height;
+    state->maze.rowWords = map->rowWords;
+    state->maze.walls = map->walls;
+    state->maze.pellets = (uint64_t*)malloc(planeWords * sizeof(uint64_t));
+    state->maze.pelletsLeft = map->pelletCount;
+    if (!state->maze.pellets) return false;
+    memcpy(state->maze.pellets, map->pellets, planeWords * sizeof(uint64_t));
+
+    place_actors(state);
+    state->activeGhostsCount = sim_ghost_count(difficulty);
+    state->difficulty = difficulty;
+    state->level = 1;
+    state->score = 0;
+    state->tick = 0;
+    state->seed = seed;
+    state->rng = seed ? seed : 0x9E3779B9u;
+    state->status = SIM_PLAYING;
+    state->nav = nav;
+    state->swarm = NULL;
+    state->events = NULL;
+    sync_nav(nav, map); // A previous game on this cache may have left it on a generated level
+    return true;
+}
+
+void sim_free(SimState* state) { // Releases the pellet plane and generated map; safe on a zeroed or already freed state.
+    free(state->maze.pellets);
+    state->maze.pellets = NULL;
+    if (state->generated) {
+        maze_unload(state->generated);
+        free(state->generated);
+        state->generated = NULL;
+    }
+}
+
+bool sim_next_level(SimState* state) { // Generates the next level's maze and restarts the board on it.
+    MazeMap* next = (MazeMap*)malloc(sizeof(MazeMap));
+    uint32_t levelSeed = state->seed ^ ((uint32_t)(state->level + 1) * 0x9E3779B9u);
+    if (!next || !maze_generate(next, state->maze.width, state->maze.height, levelSeed)) {
+        free(next);
+        return false;
+    }
+
+    // Same size as before, so the pellet plane is reused and the nav cache only needs its walls replaced.
+    sync_nav(state->nav, next);
+    memcpy(state->maze.pellets, next->pellets, (size_t)next->height * next->rowWords * sizeof(uint64_t));
+    state->maze.walls = next->walls;
+    state->maze.pelletsLeft = next->pelletCount;
+
+    if (state->generated) {
+        maze_unload(state->generated);
+        free(state->generated);
+    }
+    state->generated = next;
+    state->map = next;
+
+    place_actors(state);
+    state->level++;
+    state->status = SIM_PLAYING;
+    if (state->swarm) swarm_reset(state->swarm, state, levelSeed ^ 0xA5A5A5A5u);
+    return true;
+}
+
+bool sim_clone(SimState* clone, const SimState* source) { // Copies a state into a fresh pellet plane it owns.
+    size_t planeBytes = (size_t)source->maze.height * source->maze.rowWords * sizeof(uint64_t);
+    *clone = *source;
+    clone->generated = NULL;
+    clone->swarm = NULL;
+    clone->events = NULL;
+    clone->maze.pellets = (uint64_t*)malloc(planeBytes);
+    if (!clone->maze.pellets) return false;
+    memcpy(clone->maze.pellets, source->maze.pellets, planeBytes);
+    return true;
+}
+
+bool sim_arena_init(SimArena* arena, const SimState* shape, int capacity) { // Allocates capacity slots sized for shape's maze.
+    memset(arena, 0, sizeof(*arena));
+    arena->planeBytes = (size_t)shape->maze.height * shape->maze.rowWords * sizeof(uint64_t);
+    arena->slotBytes = (sizeof(SimState) + arena->planeBytes + 63) & ~(size_t)63;
+    arena->slots = (uint8_t*)malloc(arena->slotBytes * capacity);
+    if (!arena->slots) return false;
+    arena->capacity = capacity;
+    return true;
+}
+
+void sim_arena_free(SimArena* arena) { // Releases every slot.
+    free(arena->slots);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void sim_arena_clear(SimArena* arena) { // Forgets every snapshot; the memory is kept for reuse.
+    arena->count = 0;
+}
+
+void sim_arena_store(SimArena* arena, int slot, const SimState* state) { // The struct, then its pellet plane.
+    uint8_t* data = arena->slots + arena->slotBytes * slot;
+    memcpy(data, state, sizeof(SimState));
+    memcpy(data + sizeof(SimState), state->maze.pellets, arena->planeBytes);
+}
+
+int sim_arena_save(SimArena* arena, const SimState* state) { // Stores into the next free slot.
+    if (arena->count >= arena->capacity) return -1;
+    sim_arena_store(arena, arena->count, state);
+    return arena->count++;
+}
+
+void sim_arena_load(const SimArena* arena, int slot, SimState* state) { // Overwrites state with a snapshot, keeping what state owns.
+    const uint8_t* data = arena->slots + arena->slotBytes * slot;
+    uint64_t* pellets = state->maze.pellets;
+    MazeMap* generated = state->generated;
+    struct Swarm* swarm = state->swarm;
+    struct SimEventBuffer* events = state->events;
+    memcpy(state, data, sizeof(SimState));
+    state->maze.pellets = pellets;
+    state->generated = generated;
+    state->swarm = swarm;
+    state->events = events;
+    memcpy(pellets, data + sizeof(SimState), arena->planeBytes);
+}
+
+bool sim_all_pellets_eaten(const SimState* state) { // Checks if all pellets in the maze have been eaten.
+    return state->maze.pelletsLeft == 0;
+}
+
+int sim_pellets_left(const SimState* state) { // Number of pellets still on the board.
+    return state->maze.pelletsLeft;
+}
+
+uint64_t sim_pellet_hash(const SimState* state) { // FNV-1a over the pellet plane words, cheap enough to run every tick.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t planeWords = (size_t)state->maze.height * state->maze.rowWords;
+    for (size_t w = 0; w < planeWords; w++) {
+        hash ^= state->maze.pellets[w];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) { // Folds raw bytes into an FNV-1a hash.
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t sim_state_hash(const SimState* state) { // Pellets, score, tick, status and the entity positions; equal hashes mean equal games.
+    uint64_t hash = sim_pellet_hash(state);
+    hash = hash_bytes(hash, &state->score, sizeof(state->score));
+    hash = hash_bytes(hash, &state->tick, sizeof(state->tick));
+    hash = hash_bytes(hash, &state->rng, sizeof(state->rng));
+    hash = hash_bytes(hash, &state->status, sizeof(state->status));
+    hash = hash_bytes(hash, &state->pacman.position, sizeof(state->pacman.position));
+    hash = hash_bytes(hash, &state->pacman.direction, sizeof(state->pacman.direction));
+    hash = hash_bytes(hash, &state->pacman.nextDirection, sizeof(state->pacman.nextDirection));
+    for (int i = 0; i < state->activeGhostsCount; i++) {
+        hash = hash_bytes(hash, &state->ghosts[i].position, sizeof(state->ghosts[i].position));
+        hash = hash_bytes(hash, &state->ghosts[i].direction, sizeof(state->ghosts[i].direction));
+    }
+    return hash;
+}
+
+static bool blocked(const MazeBits* maze, int tileX, int tileY) { // Walls, and everything off the board.
+    if (tileX < 0 || tileX >= maze->width || tileY < 0 || tileY >= maze->height) {
+        return true;
+    }
+    return maze_is_wall(maze, tileX, tileY);
+}
+
+bool is_wall_tile(const SimState* state, int tileX, int tileY) { // Checks if a given tile coordinate corresponds to a wall.
+    return blocked(&state->maze, tileX, tileY);
+}
+
+// Movement walks the tile grid along each entity's heading: every tick's displacement is cut at the tile
+// centres it passes, and the only decisions (turning, stopping at a wall, ghost steering) are made there.
+// Entities never leave a centre towards a wall tile, so no step size can carry them through one, and a
+// centre is never skipped however far a single step goes.
+
+static int32_t next_center(SimVec2 position, SimVec2 direction, SimVec2* center) { // Distance along an axis heading to the next tile centre, 0 when standing on one.
+    *center = (SimVec2){ sim_tile_center(sim_tile(position.x)), sim_tile_center(sim_tile(position.y)) };
+
+    int32_t offset = (center->x - position.x) * direction.x + (center->y - position.y) * direction.y;
+    if (offset < 0) {
+        // Already past this tile's centre; the next one is a tile further on.
+        center->x += direction.x * SIM_TILE_SIZE;
+        center->y += direction.y * SIM_TILE_SIZE;
+        offset += SIM_TILE_SIZE;
+    }
+    return offset;
+}
+
+static bool heading_open(const MazeBits* maze, SimVec2 position, SimVec2 direction) { // True when the tile next to position's tile along direction is open.
+    return !blocked(maze, sim_tile(position.x) + direction.x, sim_tile(position.y) + direction.y);
+}
+
+static bool is_stopped(SimVec2 direction) { // Zero heading.
+    return direction.x == 0 && direction.y == 0;
+}
+
+SimVec2 calculate_ghost_target(const SimState* state, const SimGhost* ghost, const SimGhost* blinky) { // Calculates the target tile for a ghost based on its type and Pacman's position/direction.
+    const SimPacman* pacman = &state->pacman;
+    SimVec2 targetTile = { 0, 0 };
+
+    int pacmanTileX = sim_tile(pacman->position.x);
+    int pacmanTileY = sim_tile(pacman->position.y);
+
+    switch (ghost->type) {
+        case BLINKY:
+            targetTile = (SimVec2){ pacmanTileX, pacmanTileY };
+            break;
+        case PINKY: {
+            SimVec2 targetOffset = { pacman->direction.x * 4, pacman->direction.y * 4 };
+            if (pacman->direction.y < 0 && pacman->direction.x == 0) {
+                targetOffset.x = -4;
+            }
+            targetTile = (SimVec2){ pacmanTileX + targetOffset.x, pacmanTileY + targetOffset.y };
+
+            if (targetTile.x < 0) targetTile.x = 0;
+            if (targetTile.x >= state->maze.width) targetTile.x = state->maze.width - 1;
+            if (targetTile.y < 0) targetTile.y = 0;
+            if (targetTile.y >= state->maze.height) targetTile.y = state->maze.height - 1;
+
+            break;
+        }
+        case INKY: {
+            SimVec2 pacmanAhead = { pacmanTileX + pacman->direction.x * 2, pacmanTileY + pacman->direction.y * 2 };
+            SimVec2 blinkyTile = { sim_tile(blinky->position.x), sim_tile(blinky->position.y) };
+
+            SimVec2 vectorBlinkyToPacmanAhead = { pacmanAhead.x - blinkyTile.x, pacmanAhead.y - blinkyTile.y };
+
+            targetTile = (SimVec2){ blinkyTile.x + 2 * vectorBlinkyToPacmanAhead.x, blinkyTile.y + 2 * vectorBlinkyToPacmanAhead.y };
+
+            if (targetTile.x < 0) targetTile.x = 0;
+            if (targetTile.x >= state->maze.width) targetTile.x = state->maze.width - 1;
+            if (targetTile.y < 0) targetTile.y = 0;
+            if (targetTile.y >= state->maze.height) targetTile.y = state->maze.height - 1;
+
+            break;
+        }
+        case CLYDE: {
+            int64_t dx = ghost->position.x - pacman->position.x;
+            int64_t dy = ghost->position.y - pacman->position.y;
+            int64_t scatterDistance = SIM_TILE_SIZE * 8;
+
+            if (dx * dx + dy * dy > scatterDistance * scatterDistance) {
+                targetTile = (SimVec2){ pacmanTileX, pacmanTileY };
+            } else {
+                targetTile = (SimVec2){ 1, state->maze.height - 2 };
+            }
+            break;
+        }
+    }
+
+    return targetTile;
+}
+
+static uint32_t manhattan_distance(SimVec2 tile1, SimVec2 tile2) { // Calculates the Manhattan distance between two tile coordinates.
+    return (uint32_t)(abs(tile1.x - tile2.x) + abs(tile1.y - tile2.y));
+}
+
+static int eat_pellet(MazeBits* maze, const SimPacman* pacman, int* score, SimEventBuffer* events, int actor);
+
+static int walk_pacman(MazeBits* maze, SimPacman* pacman, SimInput input, int ticks, int* score, SimEventBuffer* events, int actor) { // Walks a Pac-Man centre to centre, turning onto the wanted heading at the first centre that allows it; eats only when score is given.
+    if (input.direction != SIM_DIR_NONE) pacman->nextDirection = dir_to_vector(input.direction);
+
+    int eaten = 0;
+    int32_t remaining = pacman->speed * ticks;
+    while (remaining > 0) {
+        SimVec2 center = pacman->position;
+        int32_t toCenter = is_stopped(pacman->direction) ? 0 : next_center(pacman->position, pacman->direction, &center);
+        SimVec2 wanted = pacman->nextDirection;
+
+        if (toCenter == 0) {
+            if (!is_stopped(wanted) && heading_open(maze, pacman->position, wanted)) {
+                pacman->direction = wanted;
+            } else if (!heading_open(maze, pacman->position, pacman->direction)) {
+                pacman->direction = (SimVec2){ 0, 0 };
+            }
+            if (is_stopped(pacman->direction)) break;
+            toCenter = next_center(pacman->position, pacman->direction, &center);
+            if (toCenter == 0) {
+                toCenter = SIM_TILE_SIZE;
+                center.x += pacman->direction.x * SIM_TILE_SIZE;
+                center.y += pacman->direction.y * SIM_TILE_SIZE;
+            }
+        } else if (wanted.x == -pacman->direction.x && wanted.y == -pacman->direction.y) {
+            // Reversing is allowed anywhere; the centre behind becomes the next one.
+            pacman->direction = wanted;
+            toCenter = next_center(pacman->position, pacman->direction, &center);
+        }
+
+        if (remaining >= toCenter) {
+            pacman->position = center;
+            remaining -= toCenter;
+        } else {
+            pacman->position.x += pacman->direction.x * remaining;
+            pacman->position.y += pacman->direction.y * remaining;
+            remaining = 0;
+        }
+        if (score) eaten |= eat_pellet(maze, pacman, score, events, actor);
+    }
+
+    pacman->frameCounter += ticks;
+    while (pacman->frameCounter >= (SIM_TICKS_PER_SECOND/pacman->framesSpeed)) {
+        pacman->frameCounter -= SIM_TICKS_PER_SECOND/pacman->framesSpeed;
+        pacman->mouthOpen = !pacman->mouthOpen;
+    }
+    return eaten;
+}
+
+static const SimVec2 exitVectors[4] = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 } }; // NAV_EXIT_* bit order
+
+static int exit_of(SimVec2 direction) { // NAV_EXIT_* bit of a heading, 0 when stopped.
+    if (direction.x > 0) return NAV_EXIT_RIGHT;
+    if (direction.x < 0) return NAV_EXIT_LEFT;
+    if (direction.y < 0) return NAV_EXIT_UP;
+    if (direction.y > 0) return NAV_EXIT_DOWN;
+    return 0;
+}
+
+static int reverse_exit(int exit) { // Swaps right with left and up with down.
+    return ((exit & (NAV_EXIT_RIGHT | NAV_EXIT_UP)) << 1) | ((exit & (NAV_EXIT_LEFT | NAV_EXIT_DOWN)) >> 1);
+}
+
+static int tile_exits(const SimState* state, int tileX, int tileY) { // Open neighbours from the junction graph, or four wall tests without one.
+    const NavCache* nav = state->nav;
+    if (nav && nav->edges && nav->graphVersion == nav->wallVersion) return nav->exits[(size_t)tileY * nav->width + tileX];
+    int exits = 0;
+    if (!blocked(&state->maze, tileX + 1, tileY)) exits |= NAV_EXIT_RIGHT;
+    if (!blocked(&state->maze, tileX - 1, tileY)) exits |= NAV_EXIT_LEFT;
+    if (!blocked(&state->maze, tileX, tileY - 1)) exits |= NAV_EXIT_UP;
+    if (!blocked(&state->maze, tileX, tileY + 1)) exits |= NAV_EXIT_DOWN;
+    return exits;
+}
+
+static int steer_ghost(SimState* state, const SimGhost* ghost, const SimGhost* blinkyGhost, int tileX, int tileY, int choices) { // Picks the exit among choices closest to the ghost's target, 0 if none is in reach.
+    SimVec2 targetTile = calculate_ghost_target(state, ghost, blinkyGhost);
+
+    // Path distance through the maze when a distance field is available; a target walled off
+    // from the ghost (e.g. clamped into a border corner) falls back to straight-line steering.
+    const uint32_t* field = NULL;
+    if (state->nav) {
+        field = nav_field(state->nav, targetTile.x, targetTile.y);
+        if (field[(size_t)tileY * state->maze.width + tileX] == NAV_UNREACHABLE) field = NULL;
+    }
+
+    int order[4] = { 0, 1, 2, 3 };
+    for (int s = 3; s > 0; s--) {
+        int j = sim_rand(state) % (s + 1);
+        int temp = order[s];
+        order[s] = order[j];
+        order[j] = temp;
+    }
+
+    // Tiles beyond a bounded field's reach read as unreachable and are never picked.
+    int best = 0;
+    uint32_t minDistance = NAV_UNREACHABLE;
+    for (int d = 0; d < 4; d++) {
+        int e = order[d];
+        if (!(choices & (1 << e))) continue;
+
+        SimVec2 nextTile = { tileX + exitVectors[e].x, tileY + exitVectors[e].y };
+        uint32_t distance = field ? field[(size_t)nextTile.y * state->maze.width + nextTile.x] : manhattan_distance(nextTile, targetTile);
+        if (distance < minDistance) {
+            minDistance = distance;
+            best = 1 << e;
+        }
+    }
+    return best;
+}
+
+static void turn_ghost(SimState* state, SimGhost* ghost, const SimGhost* blinkyGhost) { // At a graph node: steer at junctions, follow corners, turn back at dead ends.
+    int tileX = sim_tile(ghost->position.x);
+    int tileY = sim_tile(ghost->position.y);
+
+    int exits = tile_exits(state, tileX, tileY);
+    int back = reverse_exit(exit_of(ghost->direction));
+    int exit = exits & ~back;
+    // Only a real choice looks at Pac-Man; corners and corridors have one way on.
+    if (exit & (exit - 1)) exit = steer_ghost(state, ghost, blinkyGhost, tileX, tileY, exit);
+    if (!exit && (exits & back)) {
+        exit = back;
+        if (state->events) sim_event_push(state->events, SIM_EVENT_TYPE_GHOST_REVERSED, (int)(ghost - state->ghosts), tileX, tileY, 0);
+    }
+
+    if (!exit) {
+        ghost->direction = (SimVec2){ 0, 0 };
+        ghost->untilNode = 0;
+        return;
+    }
+    // The next node's distance is known now, so nothing looks at the maze again until the ghost stands on it.
+    ghost->direction = exitVectors[nav_exit_index(exit)];
+    ghost->untilNode = SIM_TILE_SIZE * (state->nav ? nav_run_length(state->nav, tileX, tileY, exit) : 1);
+}
+
+static int eat_pellet(MazeBits* maze, const SimPacman* pacman, int* score, SimEventBuffer* events, int actor) { // Clears the pellet under Pac-Man, if any, and scores it.
+    int pacmanTileX = sim_tile(pacman->position.x);
+    int pacmanTileY = sim_tile(pacman->position.y);
+
+    if (pacmanTileX >= 0 && pacmanTileX < maze->width && pacmanTileY >= 0 && pacmanTileY < maze->height) {
+        if (maze_has_pellet(maze, pacmanTileX, pacmanTileY)) {
+            maze->pellets[(size_t)pacmanTileY * maze->rowWords + (pacmanTileX >> 6)] &= ~(1ull << (pacmanTileX & 63));
+            maze->pelletsLeft--;
+            *score += 10;
+            if (events) sim_event_push(events, SIM_EVENT_TYPE_PELLET_EATEN, actor, pacmanTileX, pacmanTileY, 10);
+            return SIM_EVENT_PELLET_EATEN;
+        }
+    }
+    return 0;
+}
+
+static const SimGhost* find_blinky(const SimState* state) { // The ghost Inky's targeting leans on, NULL if it isn't hunting.
+    for (int j = 0; j < state->activeGhostsCount; j++) {
+        if (state->ghosts[j].type == BLINKY) return &state->ghosts[j];
+    }
+    return NULL;
+}
+
+static void walk_ghost(SimState* state, SimGhost* ghost, const SimGhost* blinkyGhost, int ticks) { // Walks one ghost along the junction graph's straight runs, turning only on nodes.
+    int32_t remaining = ghost->speed * ticks;
+    while (remaining > 0) {
+        if (ghost->untilNode <= 0) {
+            turn_ghost(state, ghost, blinkyGhost);
+            if (is_stopped(ghost->direction)) break;
+        }
+
+        int32_t move = (remaining < ghost->untilNode) ? remaining : ghost->untilNode;
+        ghost->position.x += ghost->direction.x * move;
+        ghost->position.y += ghost->direction.y * move;
+        ghost->untilNode -= move;
+        remaining -= move;
+    }
+}
+
+static void move_ghosts(SimState* state, int ticks) { // Walks every ghost in turn.
+    const SimGhost* blinkyGhost = find_blinky(state);
+    for (int i = 0; i < state->activeGhostsCount; i++) walk_ghost(state, &state->ghosts[i], blinkyGhost, ticks);
+}
+
+// Relative motion a sweep is tested in one piece; up to this, and with the reject below, the products stay in 64 bits.
+static const int64_t SWEEP_SPLIT = 16 * SIM_TILE_SIZE;
+
+static bool segments_meet(SimVec2 from1, SimVec2 to1, SimVec2 from2, SimVec2 to2, int32_t reach) { // Closest approach of two points moving in straight lines over the same interval.
+    int64_t dx = from1.x - from2.x;
+    int64_t dy = from1.y - from2.y;
+    int64_t vx = (to1.x - from1.x) - (to2.x - from2.x);
+    int64_t vy = (to1.y - from1.y) - (to2.y - from2.y);
+    // Too far apart to meet however the relative motion goes; this also keeps the products below in range.
+    if (llabs(dx) > reach + llabs(vx) || llabs(dy) > reach + llabs(vy)) return false;
+    if (llabs(vx) + llabs(vy) > SWEEP_SPLIT) {
+        SimVec2 mid1 = { from1.x + (to1.x - from1.x) / 2, from1.y + (to1.y - from1.y) / 2 };
+        SimVec2 mid2 = { from2.x + (to2.x - from2.x) / 2, from2.y + (to2.y - from2.y) / 2 };
+        return segments_meet(from1, mid1, from2, mid2, reach) || segments_meet(mid1, to1, mid2, to2, reach);
+    }
+
+    // The closest point is at t = -(d.v) / (v.v), clamped to [0, 1]; compared exactly by scaling through by v.v.
+    int64_t reachSq = (int64_t)reach * reach;
+    int64_t along = -(dx * vx + dy * vy);
+    int64_t speedSq = vx * vx + vy * vy;
+    if (along <= 0 || speedSq == 0) return dx * dx + dy * dy <= reachSq;
+    if (along >= speedSq) return (dx + vx) * (dx + vx) + (dy + vy) * (dy + vy) <= reachSq;
+    return (dx * dx + dy * dy) * speedSq - along * along <= reachSq * speedSq;
+}
+
+static bool ghost_caught_pacman(const SimState* state, SimVec2 pacmanFrom, const SimVec2* ghostsFrom) { // Swept circle test between Pac-Man and every active ghost, then the swarm grid.
+    // Testing only where a step ends would let a long step carry Pac-Man and a ghost through each other.
+    for (int i = 0; i < state->activeGhostsCount; i++) {
+        if (segments_meet(pacmanFrom, state->pacman.position, ghostsFrom[i], state->ghosts[i].position,
+                state->pacman.radius + state->ghosts[i].radius)) {
+            return true;
+        }
+    }
+    if (state->swarm && swarm_hits(state->swarm, state->pacman.position, state->pacman.radius)) {
+        state->swarm->contacts++;
+        return state->swarm->lethal;
+    }
+    return false;
+}
+
+static void push_outcome(SimEventBuffer* buffer, int events, int actor, const SimPacman* pacman) { // Death or a cleared board, once the step has settled which.
+    int tileX = sim_tile(pacman->position.x);
+    int tileY = sim_tile(pacman->position.y);
+    if (events & SIM_EVENT_PACMAN_DIED) sim_event_push(buffer, SIM_EVENT_TYPE_PACMAN_DIED, actor, tileX, tileY, 0);
+    if (events & SIM_EVENT_LEVEL_CLEARED) sim_event_push(buffer, SIM_EVENT_TYPE_LEVEL_CLEARED, actor, tileX, tileY, 0);
+}
+
+static int step_tick(SimState* state, SimInput input) { // One tick: Pac-Man moves and eats, the ghosts move, then the swept catch test.
+    int events = 0;
+    state->tick++;
+    if (state->events) state->events->tick = state->tick;
+
+    SimVec2 pacmanFrom = state->pacman.position;
+    SimVec2 ghostsFrom[MAX_GHOSTS];
+    for (int i = 0; i < state->activeGhostsCount; i++) ghostsFrom[i] = state->ghosts[i].position;
+
+    {
+        PROFILE_SCOPE(PROFILE_SIM_PACMAN);
+        events |= walk_pacman(&state->maze, &state->pacman, input, 1, &state->score, state->events, 0);
+    }
+
+    if (sim_all_pellets_eaten(state)) {
+        state->status = SIM_WON;
+        events |= SIM_EVENT_LEVEL_CLEARED;
+    }
+
+    {
+        PROFILE_SCOPE(PROFILE_SIM_GHOST_AI);
+        move_ghosts(state, 1);
+        if (state->swarm) swarm_step(state->swarm, &state->maze, state->nav);
+    }
+
+    {
+        PROFILE_SCOPE(PROFILE_SIM_COLLISION);
+        if (ghost_caught_pacman(state, pacmanFrom, ghostsFrom)) {
+            state->status = SIM_DEAD;
+            events &= ~SIM_EVENT_LEVEL_CLEARED;
+            events |= SIM_EVENT_PACMAN_DIED;
+        }
+    }
+
+    if (state->events) push_outcome(state->events, events, 0, &state->pacman);
+    return events;
+}
+
+int sim_step(SimState* state, SimInput input) { // Advances the game by one tick and returns the SIM_EVENT_* flags raised during it.
+    if (state->status != SIM_PLAYING) return 0;
+    return step_tick(state, input);
+}
+
+int sim_step_ticks(SimState* state, SimInput input, int ticks) { // Advances the game by up to `ticks` ticks, stopping on the tick that ends it.
+    // Ghost steering reads where Pac-Man is on the tick a ghost reaches a node, and catches are swept tick by
+    // tick, so folding ticks together would change outcomes; each tick runs whole and only the call is shared.
+    int events = 0;
+    for (int t = 0; t < ticks && state->status == SIM_PLAYING; t++) events |= step_tick(state, input);
+    return events;
+}
+
+void sim_walk_pacman(const MazeBits* maze, SimPacman* pacman, SimInput input, int ticks) { // Movement only: the maze is read, never eaten from.
+    walk_pacman((MazeBits*)maze, pacman, input, ticks, NULL, NULL, 0);
+}
+
+void sim_place_players(SimState* state, SimPlayer* players, int count) { // Everyone starts on the map's Pac-Man spawn.
+    for (int i = 0; i < count; i++) {
+        spawn_pacman(state->map, &players[i].pacman);
+        players[i].alive = true;
+    }
+}
+
+int sim_step_players(SimState* state, SimPlayer* players, int count, const SimInput* inputs) { // One tick of a shared board: every living Pac-Man moves and eats, then the ghosts hunt the nearest of them.
+    if (state->status != SIM_PLAYING) return 0;
+
+    int events = 0;
+    state->tick++;
+    if (state->events) state->events->tick = state->tick;
+
+    SimVec2 pacmenFrom[SIM_MAX_PLAYERS];
+    SimVec2 ghostsFrom[MAX_GHOSTS];
+    for (int i = 0; i < state->activeGhostsCount; i++) ghostsFrom[i] = state->ghosts[i].position;
+
+    for (int p = 0; p < count; p++) {
+        pacmenFrom[p] = players[p].pacman.position;
+        if (players[p].alive) events |= walk_pacman(&state->maze, &players[p].pacman, inputs[p], 1, &players[p].score, state->events, p);
+    }
+    if (sim_all_pellets_eaten(state)) {
+        state->status = SIM_WON;
+        events |= SIM_EVENT_LEVEL_CLEARED;
+    }
+
+    // Ghost targeting reads state->pacman, so it stands in for whichever player each ghost is closest to.
+    const SimGhost* blinkyGhost = find_blinky(state);
+    for (int i = 0; i < state->activeGhostsCount; i++) {
+        SimGhost* ghost = &state->ghosts[i];
+        int nearest = -1;
+        int32_t nearestDistance = 0;
+        for (int p = 0; p < count; p++) {
+            if (!players[p].alive) continue;
+            int32_t distance = abs(players[p].pacman.position.x - ghost->position.x) + abs(players[p].pacman.position.y - ghost->position.y);
+            if (nearest < 0 || distance < nearestDistance) {
+                nearest = p;
+                nearestDistance = distance;
+            }
+        }
+        if (nearest >= 0) state->pacman = players[nearest].pacman;
+        walk_ghost(state, ghost, blinkyGhost, 1);
+    }
+
+    int alive = 0;
+    for (int p = 0; p < count; p++) {
+        if (!players[p].alive) continue;
+        for (int i = 0; i < state->activeGhostsCount; i++) {
+            if (segments_meet(pacmenFrom[p], players[p].pacman.position, ghostsFrom[i], state->ghosts[i].position,
+                    players[p].pacman.radius + state->ghosts[i].radius)) {
+                players[p].alive = false;
+                events |= SIM_EVENT_PACMAN_DIED;
+                if (state->events) push_outcome(state->events, SIM_EVENT_PACMAN_DIED, p, &players[p].pacman);
+                break;
+            }
+        }
+        if (players[p].alive) alive++;
+    }
+    if (alive == 0) {
+        state->status = SIM_DEAD;
+        events &= ~SIM_EVENT_LEVEL_CLEARED;
+    }
+    if (state->events && (events & SIM_EVENT_LEVEL_CLEARED)) push_outcome(state->events, SIM_EVENT_LEVEL_CLEARED, -1, &state->pacman);
+    return events;
+}
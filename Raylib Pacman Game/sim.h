@@ -0,0 +1,184 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "maze.h"
+#include "nav.h"
+
+// Headless Pac-Man simulation core.
+// Everything a running game needs lives in SimState and is advanced one tick at a time by sim_step().
+// Nothing in here touches raylib, so it runs without a window, audio device or frame clock.
+
+// Positions are fixed-point maze units, SIM_TILE_SIZE to a tile. The size is a power of two, so the tile under
+// a position is a shift, tile centres are exact, and every step is integer arithmetic that comes out the same
+// on every compiler and floating-point setting. Headings are unit vectors of the same type. Nothing in here
+// knows about pixels: the renderer scales maze units to the screen when it draws.
+#define SIM_TILE_SHIFT 10
+const int SIM_TILE_SIZE = 1 << SIM_TILE_SHIFT;
+const int SIM_TICKS_PER_SECOND = 60;
+
+#define MAX_GHOSTS 4
+
+typedef struct SimVec2 {
+    int32_t x;
+    int32_t y;
+} SimVec2;
+
+inline int sim_tile(int32_t units) { // Tile holding a coordinate; positions are never negative.
+    return units >> SIM_TILE_SHIFT;
+}
+
+inline int32_t sim_tile_center(int tile) { // Coordinate of a tile's centre.
+    return ((int32_t)tile << SIM_TILE_SHIFT) + SIM_TILE_SIZE / 2;
+}
+
+typedef enum {
+    BLINKY,
+    PINKY,
+    INKY,
+    CLYDE
+} GhostType;
+
+typedef enum {
+    EASY,
+    NORMAL,
+    HARD
+} Difficulty;
+
+#define DIFFICULTY_COUNT 3
+
+typedef struct SimPacman {
+    SimVec2 position;
+    int32_t speed;         // Units per tick
+    SimVec2 direction;
+    SimVec2 nextDirection; // Last direction asked for; taken at the first tile centre where it is open
+    int32_t radius;
+    int frameCounter;
+    int framesSpeed;
+    bool mouthOpen;
+} SimPacman;
+
+typedef struct SimGhost {
+    SimVec2 position;
+    int32_t speed;
+    SimVec2 direction;
+    int32_t untilNode;     // Distance left to the next junction graph node on its heading, 0 when standing on one
+    int32_t radius;
+    GhostType type;
+} SimGhost;
+
+typedef enum {
+    SIM_PLAYING,
+    SIM_WON,
+    SIM_DEAD
+} SimStatus;
+
+typedef enum {
+    SIM_DIR_NONE,
+    SIM_DIR_RIGHT,
+    SIM_DIR_LEFT,
+    SIM_DIR_UP,
+    SIM_DIR_DOWN
+} SimDir;
+
+typedef struct SimInput {
+    SimDir direction; // Direction held this tick, SIM_DIR_NONE keeps the current heading.
+} SimInput;
+
+// Flags returned by sim_step() so the caller can change screens; the details, one event per occurrence, go
+// to the state's event buffer when one is attached.
+#define SIM_EVENT_PELLET_EATEN 0x1
+#define SIM_EVENT_LEVEL_CLEARED 0x2
+#define SIM_EVENT_PACMAN_DIED 0x4
+
+struct Swarm;
+struct SimEventBuffer;
+
+// A SimState owns its pellet plane and any generated level map: sim_init allocates the plane, sim_next_level
+// the map, and sim_free releases both. A plain struct copy shares them with the original, which is enough for
+// render interpolation.
+typedef struct SimState {
+    const MazeMap* map;      // Current level's map: the one passed to sim_init, or `generated` from level 2 on
+    MazeMap* generated;      // Owned procedural map of the current level, NULL on level 1
+    MazeBits maze;
+    SimPacman pacman;
+    SimGhost ghosts[MAX_GHOSTS];
+    int activeGhostsCount;
+    Difficulty difficulty;
+    int level;
+    int score;
+    uint32_t tick;
+    uint32_t seed;           // Game seed; each later level's maze is generated from it
+    uint32_t rng;
+    SimStatus status;
+    NavCache* nav; // Shared distance fields and junction graph for ghost steering, NULL falls back to Manhattan distance and a decision at every tile centre
+    struct Swarm* swarm; // Optional stress-test swarm stepped alongside the ghosts, NULL when off
+    struct SimEventBuffer* events; // Optional sink for typed gameplay events (events.h), NULL when nothing listens
+} SimState;
+
+bool sim_init_nav(NavCache* nav, const MazeMap* map);
+bool sim_init(SimState* state, const MazeMap* map, Difficulty difficulty, uint32_t seed, NavCache* nav);
+void sim_free(SimState* state);
+// Moves a won game on to a freshly generated maze of the same size, keeping score, tick count and the
+// generator state so replays stay exact. The nav cache is updated in place. False if generation failed.
+bool sim_next_level(SimState* state);
+int sim_step(SimState* state, SimInput input);
+// Exactly `ticks` calls to sim_step with the input held, stopping early once the game ends (headless checks
+// this with --check-step). Movement inside a tick is swept along the tile grid, so no speed tunnels through walls.
+int sim_step_ticks(SimState* state, SimInput input, int ticks);
+
+// Shared boards for several Pac-Men (the network server, see net.h).
+// The maze, ghosts, tick and rng are the SimState's; each player brings its own Pac-Man and score. The state's
+// own pacman is only a stand-in for whichever player a ghost is chasing, and its score is unused. A caught
+// player sits out the rest of the level; the board is lost when nobody is left and won when the pellets run
+// out, exactly as for one player.
+#define SIM_MAX_PLAYERS 4
+
+typedef struct SimPlayer {
+    SimPacman pacman;
+    int score;
+    bool alive;
+} SimPlayer;
+
+// Puts every player on the spawn; call after sim_init and sim_next_level. Scores are left alone.
+void sim_place_players(SimState* state, SimPlayer* players, int count);
+// One tick, inputs[p] for players[p]. Returns the SIM_EVENT_* flags raised by any of them.
+int sim_step_players(SimState* state, SimPlayer* players, int count, const SimInput* inputs);
+// Moves one Pac-Man exactly as a step would, without eating; clients predict their own player with it.
+void sim_walk_pacman(const MazeBits* maze, SimPacman* pacman, SimInput input, int ticks);
+
+// Snapshots.
+// Apart from its pellet plane a SimState is plain data, so a snapshot is the struct followed by a copy of the
+// plane in one flat arena slot, and saving or restoring one is two memcpys. The map, nav cache and swarm are
+// shared, not copied, so a snapshot is only meaningful on the level it was taken on. Restoring keeps the
+// target's own plane, generated map, swarm and event buffer pointers; use a state from sim_clone as the target.
+typedef struct SimArena {
+    uint8_t* slots;
+    size_t slotBytes;    // sizeof(SimState) plus the plane, rounded up to a cache line
+    size_t planeBytes;
+    int capacity;
+    int count;
+} SimArena;
+
+bool sim_arena_init(SimArena* arena, const SimState* shape, int capacity);
+void sim_arena_free(SimArena* arena);
+void sim_arena_clear(SimArena* arena);
+// Copies a state into the next free slot; returns the slot, or -1 when the arena is full.
+int sim_arena_save(SimArena* arena, const SimState* state);
+// Overwrites one slot directly, for arenas used as rings; count is left alone.
+void sim_arena_store(SimArena* arena, int slot, const SimState* state);
+void sim_arena_load(const SimArena* arena, int slot, SimState* state);
+// A working copy with its own pellet plane that shares everything else (but no swarm or event buffer); free it
+// with sim_free.
+bool sim_clone(SimState* clone, const SimState* source);
+
+int sim_ghost_count(Difficulty difficulty);
+bool sim_all_pellets_eaten(const SimState* state);
+int sim_pellets_left(const SimState* state);
+uint64_t sim_pellet_hash(const SimState* state);
+uint64_t sim_state_hash(const SimState* state);
+bool is_wall_tile(const SimState* state, int tileX, int tileY);
+SimVec2 calculate_ghost_target(const SimState* state, const SimGhost* ghost, const SimGhost* blinky);
+
+#endif
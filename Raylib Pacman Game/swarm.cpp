@@ -0,0 +1,249 @@
+#include "swarm.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int SWARM_SAFE_DISTANCE = 6; // Tiles (Manhattan) kept clear around Pac-Man's start
+
+static uint32_t swarm_rand(Swarm* swarm) { // Swarm-side xorshift32, separate from the game's generator.
+    uint32_t x = swarm->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    swarm->rng = x;
+    return x;
+}
+
+static int clamp_tile(int value, int limit) { // Keeps a tile coordinate inside [0, limit).
+    if (value < 0) return 0;
+    if (value >= limit) return limit - 1;
+    return value;
+}
+
+static bool open_tile(const MazeBits* maze, int tileX, int tileY) { // Out-of-maze tiles count as walls.
+    if (tileX < 0 || tileX >= maze->width || tileY < 0 || tileY >= maze->height) return false;
+    return !maze_is_wall(maze, tileX, tileY);
+}
+
+bool swarm_init(Swarm* swarm, int count) { // Allocates storage for count entities.
+    memset(swarm, 0, sizeof(*swarm));
+    swarm->count = count;
+    swarm->capacity = (count + SWARM_LANES - 1) / SWARM_LANES * SWARM_LANES;
+    swarm->radius = SIM_TILE_SIZE * 2 / 5;
+    swarm->lethal = false;
+
+    size_t bytes = (size_t)swarm->capacity * sizeof(int32_t);
+    swarm->x = (int32_t*)malloc(bytes);
+    swarm->y = (int32_t*)malloc(bytes);
+    swarm->prevX = (int32_t*)malloc(bytes);
+    swarm->prevY = (int32_t*)malloc(bytes);
+    swarm->dirX = (int32_t*)malloc(bytes);
+    swarm->dirY = (int32_t*)malloc(bytes);
+    swarm->speed = (int32_t*)malloc(bytes);
+    swarm->untilCenter = (int32_t*)malloc(bytes);
+    swarm->cellItems = (int*)malloc((size_t)count * sizeof(int));
+
+    if (!swarm->x || !swarm->y || !swarm->prevX || !swarm->prevY || !swarm->dirX || !swarm->dirY ||
+        !swarm->speed || !swarm->untilCenter || !swarm->cellItems) {
+        swarm_free(swarm);
+        return false;
+    }
+
+    for (int i = count; i < swarm->capacity; i++) {
+        swarm->x[i] = swarm->y[i] = 0;
+        swarm->dirX[i] = swarm->dirY[i] = 0;
+        swarm->speed[i] = 0;
+        swarm->untilCenter[i] = SIM_TILE_SIZE;
+    }
+    return true;
+}
+
+void swarm_free(Swarm* swarm) { // Releases everything swarm_init allocated.
+    free(swarm->x);
+    free(swarm->y);
+    free(swarm->prevX);
+    free(swarm->prevY);
+    free(swarm->dirX);
+    free(swarm->dirY);
+    free(swarm->speed);
+    free(swarm->untilCenter);
+    free(swarm->cellStart);
+    free(swarm->cellItems);
+    memset(swarm, 0, sizeof(*swarm));
+}
+
+static int cell_of(const Swarm* swarm, int i) { // Grid cell an entity stands in.
+    int tileX = clamp_tile(sim_tile(swarm->x[i]), swarm->mazeWidth);
+    int tileY = clamp_tile(sim_tile(swarm->y[i]), swarm->mazeHeight);
+    return (tileY >> swarm->cellShift) * swarm->gridWidth + (tileX >> swarm->cellShift);
+}
+
+static void build_grid(Swarm* swarm) { // Counting sort of entity indices by the tile they stand on.
+    int cellCount = swarm->gridWidth * swarm->gridHeight;
+    int* start = swarm->cellStart;
+    memset(start, 0, (cellCount + 1) * sizeof(int));
+
+    for (int i = 0; i < swarm->count; i++) {
+        start[cell_of(swarm, i) + 1]++;
+    }
+    for (int c = 0; c < cellCount; c++) {
+        start[c + 1] += start[c];
+    }
+
+    // Fill from the back so each cell ends up in ascending entity order without a second cursor array.
+    for (int i = swarm->count - 1; i >= 0; i--) {
+        swarm->cellItems[--start[cell_of(swarm, i) + 1]] = i;
+    }
+    // Each start[cell + 1] now points at the beginning of its cell; shift back so start[c]..start[c + 1] spans cell c.
+    memmove(start, start + 1, cellCount * sizeof(int));
+    start[cellCount] = swarm->count;
+}
+
+static void choose_direction(Swarm* swarm, int i, const MazeBits* maze, const NavCache* nav) { // Snaps an entity to its tile centre and picks a random open exit, avoiding reversals.
+    int tileX = clamp_tile(sim_tile(swarm->x[i]), maze->width);
+    int tileY = clamp_tile(sim_tile(swarm->y[i]), maze->height);
+    swarm->x[i] = sim_tile_center(tileX);
+    swarm->y[i] = sim_tile_center(tileY);
+
+    static const int exits[4][2] = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 } }; // NAV_EXIT_* bit order
+    int open = 0;
+    if (nav && nav->edges && nav->graphVersion == nav->wallVersion) {
+        open = nav->exits[(size_t)tileY * nav->width + tileX];
+    } else {
+        for (int e = 0; e < 4; e++) {
+            if (open_tile(maze, tileX + exits[e][0], tileY + exits[e][1])) open |= 1 << e;
+        }
+    }
+
+    int reverse = 0;
+    for (int e = 0; e < 4; e++) {
+        if (exits[e][0] == -swarm->dirX[i] && exits[e][1] == -swarm->dirY[i] && (swarm->dirX[i] != 0 || swarm->dirY[i] != 0)) reverse = 1 << e;
+    }
+    int options[4];
+    int optionCount = 0;
+    for (int e = 0; e < 4; e++) {
+        if ((open & ~reverse) & (1 << e)) options[optionCount++] = e;
+    }
+    if (optionCount == 0 && (open & reverse)) options[optionCount++] = nav_exit_index(reverse); // Dead end
+
+    if (optionCount == 0) {
+        swarm->dirX[i] = 0;
+        swarm->dirY[i] = 0;
+        swarm->untilCenter[i] = SIM_TILE_SIZE;
+        return;
+    }
+
+    // Corners and corridors leave one option and cost no draw.
+    int pick = options[optionCount > 1 ? swarm_rand(swarm) % optionCount : 0];
+    swarm->dirX[i] = exits[pick][0];
+    swarm->dirY[i] = exits[pick][1];
+    swarm->untilCenter[i] = SIM_TILE_SIZE * (nav ? nav_run_length(nav, tileX, tileY, 1 << pick) : 1);
+}
+
+bool swarm_reset(Swarm* swarm, const SimState* state, uint32_t seed) { // Places every entity on a random open tile outside Pac-Man's safe zone.
+    const MazeBits* maze = &state->maze;
+    if (!swarm->cellStart || swarm->mazeWidth != maze->width || swarm->mazeHeight != maze->height) {
+        // Grow cells until there are no more than about four per entity.
+        int shift = 0;
+        long long maxCells = (long long)swarm->count * 4 > 1024 ? (long long)swarm->count * 4 : 1024;
+        while ((long long)(((maze->width - 1) >> shift) + 1) * (((maze->height - 1) >> shift) + 1) > maxCells) shift++;
+
+        free(swarm->cellStart);
+        swarm->mazeWidth = maze->width;
+        swarm->mazeHeight = maze->height;
+        swarm->cellShift = shift;
+        swarm->gridWidth = ((maze->width - 1) >> shift) + 1;
+        swarm->gridHeight = ((maze->height - 1) >> shift) + 1;
+        swarm->cellStart = (int*)malloc(((size_t)swarm->gridWidth * swarm->gridHeight + 1) * sizeof(int));
+    }
+    int* candidates = (int*)malloc((size_t)maze->width * maze->height * sizeof(int));
+    if (!swarm->cellStart || !candidates) {
+        free(candidates);
+        return false;
+    }
+
+    swarm->rng = seed ? seed : 0x9E3779B9u;
+    swarm->contacts = 0;
+
+    int candidateCount = 0;
+    int pacmanX = sim_tile(state->pacman.position.x);
+    int pacmanY = sim_tile(state->pacman.position.y);
+    for (int y = 0; y < maze->height; y++) {
+        for (int x = 0; x < maze->width; x++) {
+            if (open_tile(maze, x, y) && abs(x - pacmanX) + abs(y - pacmanY) >= SWARM_SAFE_DISTANCE) {
+                candidates[candidateCount++] = y * maze->width + x;
+            }
+        }
+    }
+
+    static const int32_t speeds[4] = { 51, 60, 68, 77 }; // 0.75 to 1.1 times a ghost's
+    for (int i = 0; i < swarm->count; i++) {
+        int tile = candidateCount ? candidates[swarm_rand(swarm) % candidateCount] : 0;
+        swarm->x[i] = sim_tile_center(tile % maze->width);
+        swarm->y[i] = sim_tile_center(tile / maze->width);
+        swarm->dirX[i] = 0;
+        swarm->dirY[i] = 0;
+        swarm->speed[i] = speeds[swarm_rand(swarm) % 4];
+        choose_direction(swarm, i, maze, state->nav);
+    }
+    free(candidates);
+
+    memcpy(swarm->prevX, swarm->x, swarm->count * sizeof(int32_t));
+    memcpy(swarm->prevY, swarm->y, swarm->count * sizeof(int32_t));
+    build_grid(swarm);
+    return true;
+}
+
+static void integrate(int32_t* __restrict x, int32_t* __restrict y, int32_t* __restrict untilCenter,
+    const int32_t* __restrict dirX, const int32_t* __restrict dirY, const int32_t* __restrict speed, int capacity) { // Straight-line movement for every lane.
+    // Fixed-width inner blocks over non-aliasing arrays vectorize even under -O2's cheapest cost model.
+    for (int base = 0; base < capacity; base += SWARM_LANES) {
+        for (int k = base; k < base + SWARM_LANES; k++) {
+            x[k] += dirX[k] * speed[k];
+            y[k] += dirY[k] * speed[k];
+            untilCenter[k] -= speed[k];
+        }
+    }
+}
+
+void swarm_step(Swarm* swarm, const MazeBits* maze, const NavCache* nav) { // Moves every entity one tick and rebuilds the collision grid.
+    memcpy(swarm->prevX, swarm->x, swarm->count * sizeof(int32_t));
+    memcpy(swarm->prevY, swarm->y, swarm->count * sizeof(int32_t));
+
+    integrate(swarm->x, swarm->y, swarm->untilCenter, swarm->dirX, swarm->dirY, swarm->speed, swarm->capacity);
+
+    // Speeds stay well under half a tile, so an entity can pass at most one node per tick. The distance run
+    // past the node carries on along the new heading, as a ghost's does, so turning costs no time.
+    for (int i = 0; i < swarm->count; i++) {
+        if (swarm->untilCenter[i] > 0) continue;
+        int32_t overshoot = -swarm->untilCenter[i];
+        choose_direction(swarm, i, maze, nav);
+        swarm->x[i] += swarm->dirX[i] * overshoot;
+        swarm->y[i] += swarm->dirY[i] * overshoot;
+        swarm->untilCenter[i] -= overshoot;
+    }
+
+    build_grid(swarm);
+}
+
+bool swarm_hits(const Swarm* swarm, SimVec2 position, int32_t radius) { // Circle test against the entities in the 3x3 cells around a position.
+    if (swarm->count == 0 || !swarm->cellStart) return false;
+
+    // Both radii are under half a tile, so any touching entity stands in one of the 3x3 cells around this one.
+    int cellX = clamp_tile(sim_tile(position.x), swarm->mazeWidth) >> swarm->cellShift;
+    int cellY = clamp_tile(sim_tile(position.y), swarm->mazeHeight) >> swarm->cellShift;
+    int64_t reach = radius + swarm->radius;
+    int64_t reachSq = reach * reach;
+
+    for (int cy = clamp_tile(cellY - 1, swarm->gridHeight); cy <= clamp_tile(cellY + 1, swarm->gridHeight); cy++) {
+        for (int cx = clamp_tile(cellX - 1, swarm->gridWidth); cx <= clamp_tile(cellX + 1, swarm->gridWidth); cx++) {
+            int cell = cy * swarm->gridWidth + cx;
+            for (int k = swarm->cellStart[cell]; k < swarm->cellStart[cell + 1]; k++) {
+                int i = swarm->cellItems[k];
+                int64_t dx = swarm->x[i] - position.x;
+                int64_t dy = swarm->y[i] - position.y;
+                if (dx * dx + dy * dy <= reachSq) return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+#ifndef SWARM_H
+#define SWARM_H
+
+#include "sim.h"
+
+#define SWARM_LANES 8 // Arrays are padded to a multiple of this so the movement loop needs no scalar tail
+
+// Swarm stress mode: thousands of wandering ghosts on top of the regular game.
+// Entities are stored as parallel arrays so the per-tick movement is one flat, vectorizable loop;
+// only entities that reach a junction graph node (nav.h) take the scalar path that picks a new direction, so
+// a straight corridor costs nothing past the one add per tick.
+// Collisions with Pac-Man go through a uniform grid aligned to the maze tiles, rebuilt every tick with a
+// counting sort, so a query only looks at the 3x3 cells around Pac-Man. A cell is one tile on normal
+// mazes; on maps with far more tiles than entities it grows to a power-of-two block of tiles so the
+// per-tick rebuild stays proportional to the swarm, not the map.
+// Swarms are harmless by default so a load test keeps a constant workload; contacts are still
+// detected and counted, and a lethal swarm ends the game like a regular ghost.
+
+typedef struct Swarm {
+    int count;
+    int capacity;       // count rounded up to SWARM_LANES; padding entries never move
+    int32_t* x;         // Maze units, like every simulation position
+    int32_t* y;
+    int32_t* prevX;     // Positions one tick ago, for render interpolation
+    int32_t* prevY;
+    int32_t* dirX;
+    int32_t* dirY;
+    int32_t* speed;
+    int32_t* untilCenter; // Distance left before the next node centre (every tile centre without a graph)
+    int32_t radius;
+    bool lethal;
+    uint64_t contacts;  // Ticks on which Pac-Man touched any entity
+    uint32_t rng;
+    int mazeWidth;      // Maze size the grid was built for, in tiles
+    int mazeHeight;
+    int cellShift;      // A cell spans (1 << cellShift) tiles per side
+    int gridWidth;      // Grid size in cells
+    int gridHeight;
+    int* cellStart;     // gridWidth * gridHeight + 1 offsets into cellItems
+    int* cellItems;     // Entity indices grouped by tile
+} Swarm;
+
+bool swarm_init(Swarm* swarm, int count);
+void swarm_free(Swarm* swarm);
+
+// Scatters the entities over open tiles away from Pac-Man's start, sizing the grid to the state's maze.
+bool swarm_reset(Swarm* swarm, const SimState* state, uint32_t seed);
+// nav supplies the junction graph and may be NULL.
+void swarm_step(Swarm* swarm, const MazeBits* maze, const NavCache* nav);
+bool swarm_hits(const Swarm* swarm, SimVec2 position, int32_t radius);
+
+#endif
@@ -0,0 +1,68 @@
+#include "ui.h"
+#include <limits.h>
+#include <string.h>
+
+static void LayoutUiText(UiText* text) { // Measures centred texts and works out where drawing starts.
+    if (text->align == UI_ALIGN_CENTER) {
+        text->width = MeasureText(text->text, text->fontSize);
+        text->drawX = text->x - text->width / 2;
+    } else {
+        text->width = 0;
+        text->drawX = text->x;
+    }
+}
+
+void ClearUiScreen(UiScreen* screen) { // Empties a screen so it can be built again.
+    screen->panelCount = 0;
+    screen->textCount = 0;
+}
+
+int AddUiText(UiScreen* screen, const char* text, int x, int y, int fontSize, Color color, UiAlign align) { // Appends a text element and lays it out once.
+    if (screen->textCount >= UI_SCREEN_MAX_TEXTS) return -1;
+    UiText* element = &screen->texts[screen->textCount];
+    memset(element, 0, sizeof(*element));
+    strncpy(element->text, text, UI_TEXT_CAPACITY - 1);
+    element->x = x;
+    element->y = y;
+    element->fontSize = fontSize;
+    element->align = align;
+    element->color = color;
+    element->keyA = INT_MIN;
+    element->keyB = INT_MIN;
+    element->visible = true;
+    LayoutUiText(element);
+    return screen->textCount++;
+}
+
+int AddUiPanel(UiScreen* screen, Rectangle bounds, Color fill, Color border) { // Appends a filled, outlined box.
+    if (screen->panelCount >= UI_SCREEN_MAX_PANELS) return -1;
+    screen->panels[screen->panelCount] = (UiPanel){ bounds, fill, border };
+    return screen->panelCount++;
+}
+
+bool SetUiText(UiText* text, const char* value) { // Copies and re-lays out the string only when it differs.
+    if (strncmp(text->text, value, UI_TEXT_CAPACITY - 1) == 0) return false;
+    strncpy(text->text, value, UI_TEXT_CAPACITY - 1);
+    text->text[UI_TEXT_CAPACITY - 1] = '\0';
+    LayoutUiText(text);
+    return true;
+}
+
+bool UiTextKeyChanged(UiText* text, int a, int b) { // Compares against the values the text was built from.
+    if (text->keyA == a && text->keyB == b) return false;
+    text->keyA = a;
+    text->keyB = b;
+    return true;
+}
+
+void DrawUiScreen(const UiScreen* screen) { // Panels, then texts, with no measuring or formatting.
+    for (int i = 0; i < screen->panelCount; i++) {
+        const UiPanel* panel = &screen->panels[i];
+        DrawRectangleRec(panel->bounds, panel->fill);
+        DrawRectangleLinesEx(panel->bounds, 1.0f, panel->border);
+    }
+    for (int i = 0; i < screen->textCount; i++) {
+        const UiText* text = &screen->texts[i];
+        if (text->visible) DrawText(text->text, text->drawX, text->y, text->fontSize, text->color);
+    }
+}
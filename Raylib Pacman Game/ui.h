@@ -0,0 +1,59 @@
+#ifndef UI_H
+#define UI_H
+
+#include "raylib.h"
+
+// Retained UI: a screen is a fixed list of panels and text elements built once. Each text keeps its string
+// and its laid-out position, and is only re-measured when SetUiText is handed a string that differs, so a
+// static menu costs nothing but its draw calls. Texts that show numbers record the values they were built
+// from (UiTextKeyChanged) and skip formatting entirely while those stay the same.
+
+#define UI_TEXT_CAPACITY 96
+#define UI_SCREEN_MAX_TEXTS 24
+#define UI_SCREEN_MAX_PANELS 2
+
+typedef enum {
+    UI_ALIGN_LEFT,   // x is the left edge
+    UI_ALIGN_CENTER  // x is the centre
+} UiAlign;
+
+typedef struct UiText {
+    char text[UI_TEXT_CAPACITY];
+    int x;           // Anchor, see align
+    int y;
+    int fontSize;
+    UiAlign align;
+    Color color;
+    int drawX;       // Left edge after layout
+    int width;       // Measured width; 0 for left-aligned texts, which never need it
+    int keyA;        // Values the text was last built from
+    int keyB;
+    bool visible;
+} UiText;
+
+typedef struct UiPanel {
+    Rectangle bounds;
+    Color fill;
+    Color border;
+} UiPanel;
+
+typedef struct UiScreen {
+    UiPanel panels[UI_SCREEN_MAX_PANELS]; // Drawn first, under every text
+    int panelCount;
+    UiText texts[UI_SCREEN_MAX_TEXTS];
+    int textCount;
+} UiScreen;
+
+void ClearUiScreen(UiScreen* screen);
+// Both return the new element's index, or -1 when the screen is full.
+int AddUiText(UiScreen* screen, const char* text, int x, int y, int fontSize, Color color, UiAlign align);
+int AddUiPanel(UiScreen* screen, Rectangle bounds, Color fill, Color border);
+
+// Replaces a text's string, laying it out again only if it changed; returns true when it did.
+bool SetUiText(UiText* text, const char* value);
+// True (and records the new values) when a or b differ from what the text was last built from.
+bool UiTextKeyChanged(UiText* text, int a, int b);
+
+void DrawUiScreen(const UiScreen* screen);
+
+#endif